@@ -55,6 +55,15 @@ void WriteStream::write(const void* in, int bytes)
 	}
 }
 
+void WriteStream::reserve(int bytes)
+{
+	if(bytes > capacity_ && !is_external_buffer_)
+	{
+		capacity_ = bytes;
+		buffer_ = (uchar*)realloc(buffer_, capacity_);
+	}
+}
+
 void WriteStream::write8(const void* val)
 {
 	if(current_size_ < capacity_)
@@ -14,6 +14,9 @@ public:
 
 	void write(const void* in, int bytes);
 
+	// Makes sure the stream can hold the given total amount of bytes without reallocating.
+	void reserve(int bytes);
+
 	void write8(const void* val);
 	void write16(const void* val);
 	void write32(const void* val);
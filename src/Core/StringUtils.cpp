@@ -8,6 +8,13 @@
 
 # pragma warning(disable : 4996) // stricmp.
 
+#ifndef _WIN32
+#include <strings.h>
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+#define _snprintf snprintf
+#endif
+
 namespace Vortex {
 
 inline int min(int a, int b) { return (a > b) ? b : a; }
@@ -5,6 +5,7 @@
 
 #include <Managers/TempoMan.h>
 #include <Managers/SimfileMan.h>
+#include <Managers/NoteMan.h>
 #include <Simfile/SegmentGroup.h>
 
 #include <Editor/View.h>
@@ -12,6 +13,7 @@
 #include <Editor/Common.h>
 #include <Editor/Editing.h>
 #include <Editor/History.h>
+#include <Editor/Music.h>
 
 namespace Vortex {
 
@@ -31,6 +33,7 @@ enum Actions
 DialogAdjustSync::~DialogAdjustSync()
 {
 	delete myTempoDetector;
+	delete myOffsetEstimator;
 }
 
 DialogAdjustSync::DialogAdjustSync()
@@ -39,6 +42,8 @@ DialogAdjustSync::DialogAdjustSync()
 	, myInitialBPM(0)
 	, myTempoDetector(nullptr)
 	, myDetectionRow(0)
+	, myOffsetEstimator(nullptr)
+	, myEstimatedOffset(0)
 {
 	setTitle("ADJUST SYNC");
 	myCreateWidgets();
@@ -121,6 +126,25 @@ void DialogAdjustSync::myCreateWidgets()
 	myFindBPM->text.set("{g:calculate} Find BPM");
 	myFindBPM->onPress.bind(this, &DialogAdjustSync::onFindBPM);
 	myFindBPM->setTooltip("Estimate the music BPM by analyzing the audio");
+
+	myLayout.row().col(240);
+	myLayout.add<WgSeperator>();
+
+	myOffsetLabel = myLayout.add<WgLabel>();
+	myDriftLabel = myLayout.add<WgLabel>();
+	myDriftLabel->setTooltip("Range of the offsets estimated for separate parts of the chart");
+
+	myLayout.row().col(118).col(118);
+	myApplyOffset = myLayout.add<WgButton>();
+	myApplyOffset->text.set("Apply offset");
+	myApplyOffset->onPress.bind(this, &DialogAdjustSync::onApplyOffset);
+	myApplyOffset->setTooltip("Apply the estimated music offset");
+	myApplyOffset->setEnabled(false);
+
+	myFindOffset = myLayout.add<WgButton>();
+	myFindOffset->text.set("{g:calculate} Find offset");
+	myFindOffset->onPress.bind(this, &DialogAdjustSync::onFindOffset);
+	myFindOffset->setTooltip("Estimate the music offset by comparing the notes to the audio");
 }
 
 void DialogAdjustSync::onChanges(int changes)
@@ -142,6 +166,10 @@ void DialogAdjustSync::onChanges(int changes)
 		}
 		myResetBPMDetection();
 	}
+	if(changes & (VCM_FILE_CHANGED | VCM_CHART_CHANGED | VCM_NOTES_CHANGED | VCM_TEMPO_CHANGED))
+	{
+		myResetOffsetEstimation();
+	}
 }
 
 void DialogAdjustSync::onTick()
@@ -182,6 +210,13 @@ void DialogAdjustSync::onTick()
 			myTempoDetector = nullptr;
 		}
 	}
+
+	if(myOffsetEstimator && myOffsetEstimator->hasResult())
+	{
+		myShowOffsetResult();
+		delete myOffsetEstimator;
+		myOffsetEstimator = nullptr;
+	}
 }
 
 void DialogAdjustSync::onAction(int id)
@@ -246,16 +281,90 @@ void DialogAdjustSync::onFindBPM()
 			myDetectionRow = region.beginRow;
 			double time = gTempo->rowToTime(region.beginRow);
 			double len = gTempo->rowToTime(region.endRow) - time;
-			myTempoDetector = TempoDetector::New(time, len);
+			myTempoDetector = TempoDetector::New(gMusic->getSamples(), gMusic->getOnsets(), time, len);
 		}
 		else
 		{
 			myDetectionRow = 0;
-			myTempoDetector = TempoDetector::New(0, 600.0);
+			myTempoDetector = TempoDetector::New(gMusic->getSamples(), gMusic->getOnsets(), 0, 600.0);
 		}
 	}
 }
 
+void DialogAdjustSync::onApplyOffset()
+{
+	gTempo->setOffset(myEstimatedOffset);
+}
+
+void DialogAdjustSync::onFindOffset()
+{
+	if(!myOffsetEstimator)
+	{
+		myResetOffsetEstimation();
+
+		// Collect the times of the notes that the player has to hit.
+		Vector<double> times;
+		for(auto note : *gNotes)
+		{
+			if(!note.isMine && !note.isWarped && note.type != NOTE_FAKE)
+			{
+				times.push_back(note.time);
+			}
+		}
+
+		myEstimatedOffset = gTempo->getOffset();
+		myOffsetEstimator = OffsetEstimator::New(gMusic->getOnsets(), times);
+		if(myOffsetEstimator)
+		{
+			myOffsetLabel->text.set("Estimating offset...");
+		}
+	}
+}
+
+void DialogAdjustSync::myShowOffsetResult()
+{
+	// The notes move later when the offset decreases.
+	auto& result = myOffsetEstimator->getResult();
+	myEstimatedOffset -= result.shift;
+
+	Str::fmt fmt("Offset %1 :: %2 ms :: %3%");
+	fmt.arg(myEstimatedOffset, 3, 3).arg(-result.shift * 1000.0, 1, 1);
+	fmt.arg(result.confidence * 100, 0, 0);
+	myOffsetLabel->text.set(fmt.str);
+
+	auto& sections = myOffsetEstimator->getSections();
+	if(sections.size() >= 2)
+	{
+		double lo = sections[0].shift, hi = sections[0].shift;
+		for(auto& section : sections)
+		{
+			lo = min(lo, section.shift);
+			hi = max(hi, section.shift);
+		}
+		Str::fmt drift("Drift %1 ms over %2 sections");
+		drift.arg((hi - lo) * 1000.0, 1, 1).arg(sections.size());
+		myDriftLabel->text.set(drift.str);
+	}
+	else
+	{
+		myDriftLabel->text.set("Not enough notes to measure drift");
+	}
+
+	myApplyOffset->setEnabled(true);
+}
+
+void DialogAdjustSync::myResetOffsetEstimation()
+{
+	if(myOffsetEstimator)
+	{
+		delete myOffsetEstimator;
+		myOffsetEstimator = nullptr;
+	}
+	myOffsetLabel->text.set("Automatic Offset Estimation");
+	myDriftLabel->text.set("");
+	myApplyOffset->setEnabled(false);
+}
+
 void DialogAdjustSync::myResetBPMDetection()
 {
 	if(myTempoDetector)
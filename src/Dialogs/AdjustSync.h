@@ -6,6 +6,7 @@
 #include <Core/WidgetsLayout.h>
 
 #include <Editor/FindTempo.h>
+#include <Editor/FindOffset.h>
 
 namespace Vortex {
 
@@ -21,12 +22,16 @@ public:
 	void onAction(int id);	
 	void onApplyBPM();
 	void onFindBPM();
+	void onApplyOffset();
+	void onFindOffset();
 
 private:
 	WgSpinner* myCreateWidgetRow(StringRef, double&, int, int, const char*, const char*);
 	void myCreateWidgets();
 
 	void myResetBPMDetection();
+	void myResetOffsetEstimation();
+	void myShowOffsetResult();
 
 	int mySelectedResult;
 	double myOffset, myInitialBPM;
@@ -36,6 +41,10 @@ private:
 	TempoDetector* myTempoDetector;
 	Vector<TempoResult> myDetectionResults;
 	int myDetectionRow;
+	WgLabel* myOffsetLabel, *myDriftLabel;
+	WgButton* myApplyOffset, *myFindOffset;
+	OffsetEstimator* myOffsetEstimator;
+	double myEstimatedOffset;
 };
 
 }; // namespace Vortex
@@ -48,8 +48,8 @@ struct FeetPlanner
 {
 	enum { BOTH = -1, LF = 0, RF = 1 };
 
-	void setFoot(const ExpandedNote* n, int foot, vec2i pos);
-	void setFeet(const ExpandedNote* l, const ExpandedNote* r, vec2i posL, vec2i posR);
+	void setFoot(ExpandedNotePtr n, int foot, vec2i pos);
+	void setFeet(ExpandedNotePtr l, ExpandedNotePtr r, vec2i posL, vec2i posR);
 
 	void planFootswitch(int foot, vec2i pos);
 	void planCrossover(int foot, vec2i pos);
@@ -58,18 +58,18 @@ struct FeetPlanner
 	void planJump();
 	void plan(int pn);
 
-	struct NotePair { const ExpandedNote* a, *b; };
+	struct NotePair { ExpandedNotePtr a, b; };
 	bool footswitch, crossover;
 	NotePair curNote, nextNote[4];
 	uint* outBits;
 	const Style* style;
-	const ExpandedNote* noteBegin;
+	ExpandedNotePtr noteBegin;
 	vec2i curFeetPos[2];
 	int lastUsedFoot;
 	int skipNotes;
 };
 
-void FeetPlanner::setFoot(const ExpandedNote* n, int foot, vec2i pos)
+void FeetPlanner::setFoot(ExpandedNotePtr n, int foot, vec2i pos)
 {
 	int i = n - noteBegin;
 	outBits[i >> 5] |= foot << (i & 31);
@@ -77,7 +77,7 @@ void FeetPlanner::setFoot(const ExpandedNote* n, int foot, vec2i pos)
 	curFeetPos[foot] = pos;
 }
 
-void FeetPlanner::setFeet(const ExpandedNote* l, const ExpandedNote* r, vec2i posL, vec2i posR)
+void FeetPlanner::setFeet(ExpandedNotePtr l, ExpandedNotePtr r, vec2i posL, vec2i posR)
 {
 	int il = l - noteBegin;
 	int ir = r - noteBegin;
@@ -266,7 +266,7 @@ void FeetPlanner::plan(int pn)
 	skipNotes = 0;
 
 	// Fill up the next note array.
-	memset(nextNote, 0, sizeof(NotePair) * 4);
+	for(auto& pair : nextNote) pair = {nullptr, nullptr};
 	auto n = noteBegin, end = gNotes->end();
 	while(n != end && nextNote[0].a == nullptr)
 	{
@@ -20,6 +20,7 @@ enum DialogId
 	DIALOG_WAVEFORM_SETTINGS,
 	DIALOG_ZOOM,
 	DIALOG_CUSTOM_SNAP,
+	DIALOG_SONG_LIST,
 	NUM_DIALOG_IDS
 };
 
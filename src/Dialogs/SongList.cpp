@@ -0,0 +1,289 @@
+#include <Dialogs/SongList.h>
+
+#include <Core/StringUtils.h>
+#include <Core/Gui.h>
+#include <Core/Draw.h>
+#include <Core/GuiDraw.h>
+
+#include <Simfile/Chart.h>
+
+#include <Editor/Common.h>
+#include <Editor/Editor.h>
+#include <Editor/Library.h>
+
+namespace Vortex {
+
+static const int MaxSongs = 500;
+static const int ButtonH = 36;
+
+// ================================================================================================
+// SongButton
+
+struct DialogSongList::SongButton : public GuiWidget {
+
+SongButton(GuiContext* gui, const Vector<Library::Song>* songs, int index)
+	: GuiWidget(gui)
+	, mySongs(songs)
+	, mySongIndex(index)
+{
+}
+
+void onMousePress(MousePress& evt) override
+{
+	if(isMouseOver())
+	{
+		if(isEnabled() && evt.button == Mouse::LMB && evt.unhandled())
+		{
+			startCapturingMouse();
+			String path = mySongs->at(mySongIndex).path;
+			gEditor->openSimfile(path);
+		}
+		evt.setHandled();
+	}
+}
+
+void onMouseRelease(MouseRelease& evt) override
+{
+	if(isCapturingMouse() && evt.button == Mouse::LMB)
+	{
+		stopCapturingMouse();
+	}
+}
+
+void onTick() override
+{
+	GuiWidget::onTick();
+	if(isMouseOver())
+	{
+		GuiMain::setTooltip("Open this simfile in the editor");
+	}
+}
+
+void onDraw() override
+{
+	recti r = rect_;
+
+	TextStyle textStyle;
+	textStyle.textFlags = Text::ELLIPSES;
+
+	// Draw the button graphic.
+	auto& button = GuiDraw::getButton();
+	button.base.draw(r, 0);
+
+	auto& song = mySongs->at(mySongIndex);
+
+	// Draw the BPM range and the title on the top line.
+	String bpm = Str::val(song.minBpm, 0, 0);
+	if(song.maxBpm > song.minBpm)
+	{
+		Str::append(bpm, "-");
+		Str::append(bpm, Str::val(song.maxBpm, 0, 0));
+	}
+	Text::arrange(Text::MR, textStyle, bpm.str());
+	Text::draw(vec2i{r.x + r.w - 6, r.y + 10});
+
+	String title = song.title;
+	if(song.subtitle.len())
+	{
+		Str::append(title, " ");
+		Str::append(title, song.subtitle);
+	}
+	int maxW = r.w - Text::getSize().x - 18;
+	Text::arrange(Text::ML, textStyle, maxW, title.str());
+	Text::draw(vec2i{r.x + 6, r.y + 10});
+
+	// Draw the chart meters, colored by difficulty, and the artist on the bottom line.
+	int x = r.x + r.w - 6;
+	for(int i = song.charts.size() - 1; i >= 0 && x > r.x + r.w / 2; --i)
+	{
+		auto& chart = song.charts[i];
+		textStyle.textColor = ToColor(chart.difficulty);
+		Text::arrange(Text::MR, textStyle, Str::val(chart.meter).str());
+		Text::draw(vec2i{x, r.y + 26});
+		x -= Text::getSize().x + 6;
+	}
+	textStyle.textColor = Colors::white;
+
+	maxW = x - r.x - 12;
+	Text::arrange(Text::ML, textStyle, maxW, song.artist.str());
+	Text::draw(vec2i{r.x + 6, r.y + 26});
+
+	// Interaction effects.
+	if(isCapturingMouse())
+	{
+		button.pressed.draw(r, 0);
+	}
+	else if(isMouseOver())
+	{
+		button.hover.draw(r, 0);
+	}
+}
+
+const Vector<Library::Song>* mySongs;
+int mySongIndex;
+
+};
+
+// ================================================================================================
+// SongList
+
+struct DialogSongList::SongList : public WgScrollRegion {
+
+Vector<Library::Song> mySongs;
+Vector<SongButton*> myButtons;
+
+~SongList()
+{
+	for(auto button : myButtons)
+	{
+		delete button;
+	}
+}
+
+SongList(GuiContext* gui)
+	: WgScrollRegion(gui)
+{
+	setScrollType(SCROLL_NEVER, SCROLL_WHEN_NEEDED);
+}
+
+int getListH() const
+{
+	return max(24, mySongs.size() * (ButtonH + 1));
+}
+
+void onUpdateSize() override
+{
+	scroll_height_ = getListH();
+	ClampScrollPositions();
+}
+
+void onTick() override
+{
+	PreTick();
+
+	int viewW = getViewWidth() - 2 * is_vertical_scrollbar_active_;
+
+	// Only the buttons that are in view are updated.
+	int y = rect_.y - scroll_position_y_;
+	for(auto button : myButtons)
+	{
+		if(y + ButtonH >= rect_.y && y < rect_.y + rect_.h)
+		{
+			button->arrange({rect_.x, y, viewW, ButtonH});
+			button->tick();
+		}
+		y += ButtonH + 1;
+	}
+
+	PostTick();
+}
+
+void onDraw() override
+{
+	TextStyle textStyle;
+	int w = getViewWidth() - 2 * is_vertical_scrollbar_active_;
+	int h = getViewHeight();
+	int x = rect_.x;
+	int y = rect_.y - scroll_position_y_;
+
+	Renderer::pushScissorRect({rect_.x, rect_.y, w, h});
+	if(myButtons.empty())
+	{
+		const char* text = gLibrary->isScanning() ? "- indexing songs -" : "- no songs -";
+		Text::arrange(Text::MC, textStyle, text);
+		Text::draw(vec2i{x + w / 2, y + rect_.h / 2});
+	}
+	else for(auto button : myButtons)
+	{
+		if(y + ButtonH >= rect_.y && y < rect_.y + h)
+		{
+			button->draw();
+		}
+		y += ButtonH + 1;
+	}
+	Renderer::popScissorRect();
+
+	WgScrollRegion::onDraw();
+}
+
+void setSongs(Vector<Library::Song> songs)
+{
+	mySongs.swap(songs);
+	while(myButtons.size() < mySongs.size())
+	{
+		myButtons.push_back(new SongButton(getGui(), &mySongs, myButtons.size()));
+	}
+	while(myButtons.size() > mySongs.size())
+	{
+		delete myButtons.back();
+		myButtons.pop_back();
+	}
+}
+
+};
+
+// ================================================================================================
+// DialogSongList
+
+DialogSongList::~DialogSongList()
+{
+	delete mySearch;
+	delete myList;
+}
+
+DialogSongList::DialogSongList()
+	: myRevision(-1)
+{
+	setTitle("LIST OF SONGS");
+
+	setWidth(320);
+
+	setMinimumWidth(160);
+	setMaximumWidth(1024);
+	setMinimumHeight(64);
+	setHeight(400);
+
+	setResizeable(true, true);
+
+	mySearch = new WgLineEdit(getGui());
+	mySearch->text.bind(&myQuery);
+	mySearch->onChange.bind(this, &DialogSongList::onSearch);
+	mySearch->setTooltip("Search the songs of opened packs by title, artist or folder name");
+
+	myList = new SongList(getGui());
+}
+
+void DialogSongList::onSearch()
+{
+	myRevision = gLibrary->getRevision();
+	myList->setSongs(gLibrary->search(myQuery, MaxSongs));
+}
+
+void DialogSongList::onUpdateSize()
+{
+	myList->updateSize();
+	setMaximumHeight(min(1024, myList->getScrollHeight() + 28));
+}
+
+void DialogSongList::onTick()
+{
+	// Update the results when songs were added to the library.
+	if(myRevision != gLibrary->getRevision())
+	{
+		onSearch();
+	}
+
+	recti r = getInnerRect();
+	mySearch->arrange({r.x + 4, r.y + 4, r.w - 8, 20});
+	mySearch->tick();
+	myList->arrange({r.x, r.y + 28, r.w, r.h - 28});
+	myList->tick();
+}
+
+void DialogSongList::onDraw()
+{
+	mySearch->draw();
+	myList->draw();
+}
+
+}; // namespace Vortex
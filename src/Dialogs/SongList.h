@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Dialogs/Dialog.h>
+#include <Core/Draw.h>
+#include <Core/Widgets.h>
+
+namespace Vortex {
+
+class DialogSongList : public EditorDialog
+{
+public:
+	void onUpdateSize() override;
+	void onTick() override;
+	void onDraw() override;
+
+	~DialogSongList();
+	DialogSongList();
+
+private:
+	void onSearch();
+
+	struct SongButton;
+	struct SongList;
+	SongList* myList;
+	WgLineEdit* mySearch;
+	String myQuery;
+	int myRevision;
+};
+
+}; // namespace Vortex
@@ -74,6 +74,8 @@ void Action::perform(Type action)
 		gEditor->openDialog(DIALOG_ZOOM);
 	CASE(OPEN_DIALOG_CUSTOM_SNAP)
 		gEditor->openDialog(DIALOG_CUSTOM_SNAP);
+	CASE(OPEN_DIALOG_SONG_LIST)
+		gEditor->openDialog(DIALOG_SONG_LIST);
 
 	CASE(EDIT_UNDO)
 		gSystem->getEvents().addKeyPress(Key::Z, Keyflag::CTRL, false);
@@ -359,6 +361,8 @@ void Action::perform(Type action)
 		gStatusbar->toggleTime();
 	CASE(TOGGLE_STATUS_TIMING_MODE)
 		gStatusbar->toggleTimingMode();
+	CASE(TOGGLE_STATUS_HISTORY)
+		gStatusbar->toggleHistory();
 
 	CASE(SHOW_SHORTCUTS)
 		gTextOverlay->show(TextOverlay::SHORTCUTS);
@@ -42,6 +42,7 @@ namespace Action {
 	OPEN_DIALOG_WAVEFORM_SETTINGS,
 	OPEN_DIALOG_ZOOM,
 	OPEN_DIALOG_CUSTOM_SNAP,
+	OPEN_DIALOG_SONG_LIST,
 	
 	EDIT_UNDO,
 	EDIT_REDO,
@@ -200,6 +201,7 @@ namespace Action {
 	TOGGLE_STATUS_MEASURE,
 	TOGGLE_STATUS_TIME,
 	TOGGLE_STATUS_TIMING_MODE,
+	TOGGLE_STATUS_HISTORY,
 	
 	SHOW_SHORTCUTS,
 	SHOW_MESSAGE_LOG,
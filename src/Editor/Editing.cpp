@@ -253,7 +253,7 @@ void turnIntoTriplets()
 	// Reselect the scaled notes.
 	if(gSelection->isNotes())
 	{
-		gNotes->select(SELECT_SET, add.begin(), add.size());
+		gNotes->select(SELECT_SET, add);
 	}*/
 }
 
@@ -434,7 +434,7 @@ void changeHoldsToRolls()
 		// Reselect the notes.
 		if(gSelection->getType() == Selection::NOTES)
 		{
-			gNotes->select(SELECT_SET, edit.add.begin(), edit.add.size());
+			gNotes->select(SELECT_SET, edit.add);
 		}
 	}
 	else
@@ -458,6 +458,7 @@ void changeHoldsToType(NoteType type)
 			++numHolds;
 		}
 	}
+	edit.add.invalidateHolds();
 	if(numHolds > 0)
 	{
 		static const NotesMan::EditDescription descs[NUM_NOTE_TYPES] = {
@@ -472,7 +473,7 @@ void changeHoldsToType(NoteType type)
 		// Reselect the notes.
 		if(gSelection->getType() == Selection::NOTES)
 		{
-			gNotes->select(SELECT_SET, edit.add.begin(), edit.add.size());
+			gNotes->select(SELECT_SET, edit.add);
 		}
 	}
 	else
@@ -502,6 +503,7 @@ void changeNoteTypeToType(NoteType before, NoteType after, const NotesMan::EditD
 			++numNotes;
 		}
 	}
+	edit.add.invalidateHolds();
 	if(numNotes > 0)
 	{
 		gNotes->modify(edit, false, desc);
@@ -509,7 +511,7 @@ void changeNoteTypeToType(NoteType before, NoteType after, const NotesMan::EditD
 		// Reselect the notes.
 		if(gSelection->getType() == Selection::NOTES)
 		{
-			gNotes->select(SELECT_SET, edit.add.begin(), edit.add.size());
+			gNotes->select(SELECT_SET, edit.add);
 		}
 	}
 	else
@@ -678,6 +680,7 @@ static void switchColumns(NoteList& notes, const int* table)
 		{
 			note.col = table[note.col];
 		}
+		notes.invalidateHolds();
 	}
 }
 
@@ -726,7 +729,7 @@ void mirrorNotes(MirrorType type)
 	// Reselect the mirrored notes.
 	if(gSelection->getType() == Selection::NOTES)
 	{
-		gNotes->select(SELECT_SET, edit.add.begin(), edit.rem.size());
+		gNotes->select(SELECT_SET, edit.add);
 	}
 }
 
@@ -770,7 +773,7 @@ void scaleNotes(int numerator, int denominator)
 	// Reselect the scaled notes.
 	if(gSelection->getType() == Selection::NOTES)
 	{
-		gNotes->select(SELECT_SET, edit.add.begin(), edit.add.size());
+		gNotes->select(SELECT_SET, edit.add);
 	}
 }
 
@@ -864,6 +867,7 @@ void convertRoutineToCouples()
 	const char* title = "Convert Routine to ITG Couples";
 
 	// Find all routine charts.
+	gSimfile->loadNotes();
 	Vector<const Chart*> charts;
 	for(int i = 0; i < gSimfile->getNumCharts(); ++i)
 	{
@@ -944,6 +948,7 @@ void convertCouplesToRoutine()
 	auto segments = gTempo->getSegments();
 
 	// Find all doubles charts.
+	gSimfile->loadNotes();
 	Vector<const Chart*> charts;
 	for(int i = 0; i < gSimfile->getNumCharts(); ++i)
 	{
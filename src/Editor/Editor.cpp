@@ -27,6 +27,7 @@
 #include <Editor/TextOverlay.h>
 #include <Editor/Statusbar.h>
 #include <Editor/History.h>
+#include <Editor/Library.h>
 #include <Editor/StreamGenerator.h>
 
 #include <Managers/StyleMan.h>
@@ -50,6 +51,7 @@
 #include <Dialogs/WaveformSettings.h>
 #include <Dialogs/Zoom.h>
 #include <Dialogs/CustomSnap.h>
+#include <Dialogs/SongList.h>
 
 namespace Vortex {
 
@@ -64,11 +66,12 @@ struct DialogEntry
 };
 
 static const char loadFilters[] =
-	"Supported Media (*.sm, *.ssc, *.dwi, *.osu, *.osz, *.ogg, *.mp3, *.wav)\0*.sm;*.ssc;*.dwi;*.osu;*.osz;*.ogg;*.mp3;*.wav\0"
+	"Supported Media (*.sm, *.ssc, *.dwi, *.osu, *.osz, *.avproj, *.ogg, *.mp3, *.wav)\0*.sm;*.ssc;*.dwi;*.osu;*.osz;*.avproj;*.ogg;*.mp3;*.wav\0"
 	"Stepmania/ITG (*.sm)\0*.sm\0"
 	"Stepmania 5 (*.ssc)\0*.ssc\0"
 	"Dance With Intensity (*.dwi)\0*.dwi\0"
 	"Osu!mania (*.osu, *.osz)\0*.osu;*.osz\0"
+	"ArrowVortex project (*.avproj)\0*.avproj\0"
 	"Ogg Vorbis (*.ogg)\0*.ogg\0"
 	"MP3 Audio (*.mp3)\0*.mp3\0"
 	"Waveform (*.wav)\0*.wav\0"
@@ -78,6 +81,7 @@ static const char saveFilters[] =
 	"Stepmania/ITG (*.sm)\0*.sm\0"
 	"Stepmania 5 (*.ssc)\0*.ssc\0"
 	"Osu!mania (*.osu)\0*.osu\0"
+	"ArrowVortex project (*.avproj)\0*.avproj\0"
 	"All Files (*.*)\0*.*\0";
 
 static const int MAX_RECENT_FILES = 10;
@@ -203,7 +207,10 @@ void init()
 	TextOverlay::create();
 
 	// Create the history, because simfile components have to register their callbacks.
-	History::create();
+	History::create(settings);
+
+	// Create the library, which indexes the packs of opened simfiles in the background.
+	Library::create();
 
 	// Create the simfile components.
 	StyleMan::create();
@@ -249,6 +256,7 @@ void shutdown()
 	XmrDoc settings;
 	saveGeneralSettings(settings);
 	gStatusbar->saveSettings(settings);
+	gHistory->saveSettings(settings);
 	gEditing->saveSettings(settings);
 	gWaveform->saveSettings(settings);
 	gTempoBoxes->saveSettings(settings);
@@ -271,6 +279,7 @@ void shutdown()
 	Selection::destroy();
 	Music::destroy();
 	History::destroy();
+	Library::destroy();
 	Menubar::destroy();
 	Shortcuts::destroy();
 	TextOverlay::destroy();
@@ -398,9 +407,10 @@ static String findSimfile(const Path& path, bool ignoreAudio)
 {
 	String out;
 
-	// Make a list of loadable extensions, from high priority to low priority.
-	static const char* extList[] = {"ssc", "sm", "dwi", "osu", "ogg", "mp3", "wav"};
-	const char** extEnd = extList + (ignoreAudio ? 4 : 7);
+	// Make a list of loadable extensions, from high priority to low priority. A project holds the
+	// work in progress on the simfile next to it, so it is opened instead of the simfile.
+	static const char* extList[] = {"avproj", "ssc", "sm", "dwi", "osu", "ogg", "mp3", "wav"};
+	const char** extEnd = extList + (ignoreAudio ? 5 : 8);
 
 	// Check if the path is a directory.
 	if(path.attributes() & File::ATR_DIR)
@@ -481,6 +491,11 @@ bool openSimfile(StringRef path)
 		if(gSimfile->load(path))
 		{
 			addToRecentfiles(path);
+
+			// Index the pack of the simfile, for navigating to the next and previous simfile.
+			Path packDir = gSimfile->getDir();
+			packDir.pop();
+			gLibrary->scanPack(packDir);
 			result = true;
 		}
 		gView->setCursorTime(0.0);
@@ -503,10 +518,32 @@ bool openNextSimfile(bool iterateForward)
 	// Check if a simfile is currently open.
 	if(gSimfile->isClosed()) return false;
 
-	// Make a list of all simfiles in the current pack.
 	Path packDir = gSimfile->getDir();
 	String curDir = packDir.dirWithoutSlash();
 	packDir.pop();
+
+	// If the pack is indexed by the library, the simfile paths are already known.
+	auto songs = gLibrary->getPack(packDir);
+	for(int i = 0; i < songs.size(); ++i)
+	{
+		if(songs[i].dir == curDir)
+		{
+			int next = iterateForward ? (i + 1) : (i - 1);
+			if(next == songs.size())
+			{
+				HudInfo("This is the last simfile.");
+				return false;
+			}
+			if(next < 0)
+			{
+				HudInfo("This is the first simfile.");
+				return false;
+			}
+			return openSimfile(songs[next].path);
+		}
+	}
+
+	// Otherwise, make a list of all simfiles in the current pack.
 	auto songDirs = File::findDirs(packDir, false);
 
 	// Find the current simfile.
@@ -581,6 +618,10 @@ bool saveSimfile(bool showSaveAsDialog)
 	{
 		saveFmt = SIM_OSU;
 	}
+	else if(fmt == SIM_AVPROJ)
+	{
+		saveFmt = SIM_AVPROJ;
+	}
 
 	// If the path is empty, ask a path from the user.
 	if(file.empty() || showSaveAsDialog)
@@ -596,6 +637,8 @@ bool saveSimfile(bool showSaveAsDialog)
 			filterIndex = 2; break;
 		case SIM_OSU:
 			filterIndex = 3; break;
+		case SIM_AVPROJ:
+			filterIndex = 4; break;
 		};
 
 		// Show the save file dialog.
@@ -621,6 +664,9 @@ bool saveSimfile(bool showSaveAsDialog)
 		case 3:
 			saveFmt = SIM_OSU;
 			break;
+		case 4:
+			saveFmt = SIM_AVPROJ;
+			break;
 		default:
 			if(tmp.hasExt("ssc"))
 			{
@@ -630,6 +676,10 @@ bool saveSimfile(bool showSaveAsDialog)
 			{
 				saveFmt = SIM_OSU;
 			}
+			else if(tmp.hasExt("avproj"))
+			{
+				saveFmt = SIM_AVPROJ;
+			}
 			else
 			{
 				saveFmt = SIM_SM;
@@ -644,9 +694,6 @@ bool saveSimfile(bool showSaveAsDialog)
 		HudError("Could not save %s", file.str());
 	}
 
-	// Signal to the edit history that the current state is the saved state.
-	gHistory->onFileSaved();
-
 	return true;
 }
 
@@ -749,6 +796,8 @@ void handleDialogOpening(DialogId id, recti rect)
 		dlg = new DialogZoom; break;
 	case DIALOG_CUSTOM_SNAP:
 		dlg = new DialogCustomSnap; break;
+	case DIALOG_SONG_LIST:
+		dlg = new DialogSongList; break;
 	};
 
 	dlg->setId(id);
@@ -953,6 +1002,8 @@ void tick()
 		gWaveform->tick();
 	}
 
+	gSimfile->tick();
+
 	updateTitle();
 	notifyChanges();
 
@@ -0,0 +1,304 @@
+#include <Editor/FindOffset.h>
+#include <Editor/FindOnsets.h>
+
+#include <Core/Core.h>
+#include <Core/Utils.h>
+
+#include <System/Thread.h>
+
+#include <math.h>
+#include <algorithm>
+
+namespace Vortex {
+
+extern void rdft(int n, int isgn, float* a, int* ip, float* w);
+
+namespace {
+
+static const double MaxShift = 0.25;        // Largest shift that is considered, in seconds.
+static const double ShiftPrior = 0.1;       // Width of the preference for small shifts, in seconds.
+static const double NoveltyDelay = 0.010;   // Delay of the onset function peaks, in seconds.
+static const double MinPeakDistance = 0.02; // Minimum distance of the runner-up peak, in seconds.
+static const double MeanWindow = 0.1;       // Window of the envelope mean removal, in seconds.
+static const double SectionLength = 20.0;   // Length of the drift sections, in seconds.
+static const int MinSectionNotes = 16;      // Sections with fewer note rows are skipped.
+
+// ================================================================================================
+// Helper functions.
+
+// Removes the local mean from the onset detection function and keeps the positive part, so that
+// only the peaks contribute to the correlation.
+static void PrepareEnvelope(const float* novelty, int size, int window, Vector<float>& out)
+{
+	Vector<double> sum;
+	sum.resize(size + 1);
+	sum[0] = 0.0;
+	for(int i = 0; i < size; ++i)
+	{
+		sum[i + 1] = sum[i] + novelty[i];
+	}
+	Vector<float> peaks;
+	peaks.resize(size);
+	for(int i = 0; i < size; ++i)
+	{
+		int a = max(0, i - window), b = min(size, i + window + 1);
+		double mean = (sum[b] - sum[a]) / (double)(b - a);
+		peaks[i] = (float)max(0.0, novelty[i] - mean);
+	}
+
+	// Smooth the peaks a little, which makes the correlation peak suitable for interpolation.
+	static const float kernel[5] = {1.0f / 16, 4.0f / 16, 6.0f / 16, 4.0f / 16, 1.0f / 16};
+	out.resize(size);
+	for(int i = 0; i < size; ++i)
+	{
+		float v = 0.0f;
+		for(int k = -2; k <= 2; ++k)
+		{
+			int j = clamp(i + k, 0, size - 1);
+			v += peaks[j] * kernel[k + 2];
+		}
+		out[i] = v;
+	}
+}
+
+// Returns the linearly interpolated envelope value at a fractional position.
+static double Sample(const Vector<float>& env, double pos)
+{
+	int i = (int)floor(pos);
+	if(i < 0 || i + 1 >= env.size()) return 0.0;
+	double t = pos - i;
+	return env[i] * (1.0 - t) + env[i + 1] * t;
+}
+
+// Finds the best lag in the correlation, which is indexed from -maxLag to maxLag, and measures
+// how much it stands out from the best peak that is at least minDistance values away. Since the
+// correlation of rhythmic music repeats every beat, peaks are weighted by a preference for small
+// shifts; charts are rarely more than a fraction of a beat out of sync.
+static void FindPeak(const Vector<float>& corr, int maxLag, int minDistance, double secondsPerValue,
+	double& outShift, double& outConfidence)
+{
+	Vector<double> weighted;
+	weighted.resize(corr.size());
+	double priorScale = secondsPerValue / ShiftPrior;
+	for(int i = 0; i < corr.size(); ++i)
+	{
+		double x = (i - maxLag) * priorScale;
+		weighted[i] = corr[i] * exp(-0.5 * x * x);
+	}
+
+	int best = maxLag;
+	for(int i = 0; i < weighted.size(); ++i)
+	{
+		if(weighted[i] > weighted[best]) best = i;
+	}
+
+	double runnerUp = 0.0;
+	for(int i = 1; i < weighted.size() - 1; ++i)
+	{
+		bool isPeak = (weighted[i] >= weighted[i - 1] && weighted[i] >= weighted[i + 1]);
+		if(isPeak && abs(i - best) >= minDistance)
+		{
+			runnerUp = max(runnerUp, weighted[i]);
+		}
+	}
+
+	// Refine the best lag by fitting a parabola through the neighbouring values.
+	double pos = best;
+	if(best > 0 && best < corr.size() - 1)
+	{
+		double a = corr[best - 1], b = corr[best], c = corr[best + 1];
+		double d = a - 2.0 * b + c;
+		if(d < 0.0) pos += clamp(0.5 * (a - c) / d, -0.5, 0.5);
+	}
+
+	double peak = weighted[best];
+	outShift = (pos - maxLag) * secondsPerValue - NoveltyDelay;
+	outConfidence = (peak > 0.0) ? clamp(1.0 - runnerUp / peak, 0.0, 1.0) : 0.0;
+}
+
+// Cross-correlates the note impulses with the envelope over the entire chart, using the FFT.
+static void CorrelateGlobal(const Vector<float>& env, const Vector<double>& notePos, int maxLag,
+	Vector<float>& out)
+{
+	int n = 2;
+	while(n < env.size() + maxLag + 2) n *= 2;
+
+	Vector<float> a, b, w;
+	Vector<int> ip;
+	a.resize(n, 0.0f);
+	b.resize(n, 0.0f);
+	w.resize(n / 2);
+	ip.resize(2 + (int)sqrt((double)n));
+	ip[0] = 0;
+
+	// The note impulses are spread over the two nearest values to keep sub-hop precision.
+	for(double pos : notePos)
+	{
+		int i = (int)floor(pos);
+		if(i < 0 || i + 1 >= env.size()) continue;
+		float t = (float)(pos - i);
+		a[i] += 1.0f - t;
+		a[i + 1] += t;
+	}
+	for(int i = 0; i < env.size(); ++i)
+	{
+		b[i] = env[i];
+	}
+
+	// The spectrum of the correlation is the conjugate of the note spectrum times the envelope
+	// spectrum. The real parts of the DC and Nyquist terms are stored in the first two values.
+	rdft(n, 1, a.data(), ip.data(), w.data());
+	rdft(n, 1, b.data(), ip.data(), w.data());
+	a[0] *= b[0];
+	a[1] *= b[1];
+	for(int k = 2; k < n; k += 2)
+	{
+		float re = a[k] * b[k] + a[k + 1] * b[k + 1];
+		float im = a[k] * b[k + 1] - a[k + 1] * b[k];
+		a[k] = re, a[k + 1] = im;
+	}
+	rdft(n, -1, a.data(), ip.data(), w.data());
+
+	// Negative lags are wrapped around to the end of the buffer.
+	float scale = 2.0f / (float)n;
+	out.resize(maxLag * 2 + 1);
+	for(int lag = -maxLag; lag <= maxLag; ++lag)
+	{
+		out[lag + maxLag] = a[(lag + n) % n] * scale;
+	}
+}
+
+// Cross-correlates a range of note impulses with the envelope directly.
+static void CorrelateSection(const Vector<float>& env, const double* notePos, int numNotes,
+	int maxLag, Vector<float>& out)
+{
+	out.resize(maxLag * 2 + 1);
+	for(int lag = -maxLag; lag <= maxLag; ++lag)
+	{
+		double sum = 0.0;
+		for(int i = 0; i < numNotes; ++i)
+		{
+			sum += Sample(env, notePos[i] + lag);
+		}
+		out[lag + maxLag] = (float)sum;
+	}
+}
+
+// ================================================================================================
+// OffsetEstimatorImp.
+
+class OffsetEstimatorImp : public OffsetEstimator, public BackgroundThread
+{
+public:
+	OffsetEstimatorImp(const OnsetCache& onsets, const Vector<double>& noteTimes);
+	~OffsetEstimatorImp();
+
+	void exec();
+
+	bool hasResult() const { return isDone(); }
+	const OffsetResult& getResult() const { return myResult; }
+	const Vector<OffsetSection>& getSections() const { return mySections; }
+
+private:
+	Vector<float> myNovelty;
+	Vector<double> myNoteTimes;
+	double mySecondsPerValue;
+	OffsetResult myResult;
+	Vector<OffsetSection> mySections;
+};
+
+OffsetEstimatorImp::OffsetEstimatorImp(const OnsetCache& onsets, const Vector<double>& noteTimes)
+	: myNovelty(onsets.novelty)
+	, myNoteTimes(noteTimes)
+	, mySecondsPerValue((double)onsets.hopSize / (double)onsets.samplerate)
+{
+	myResult = {0.0, 0.0};
+	start();
+}
+
+OffsetEstimatorImp::~OffsetEstimatorImp()
+{
+	terminate();
+}
+
+void OffsetEstimatorImp::exec()
+{
+	FindOffset(myNovelty.data(), myNovelty.size(), mySecondsPerValue,
+		myNoteTimes.data(), myNoteTimes.size(), myResult, mySections);
+}
+
+}; // anonymous namespace
+
+// ================================================================================================
+// Public functions.
+
+void FindOffset(const float* novelty, int numValues, double secondsPerValue,
+	const double* noteTimes, int numNotes, OffsetResult& out, Vector<OffsetSection>& sections)
+{
+	out = {0.0, 0.0};
+	sections.clear();
+	if(numValues < 2 || numNotes == 0) return;
+
+	Vector<float> env;
+	PrepareEnvelope(novelty, numValues, max(1, (int)(MeanWindow / secondsPerValue)), env);
+
+	// Convert the note times to envelope positions. Notes on the same row count once.
+	Vector<double> times;
+	times.insert(0, noteTimes, numNotes);
+	std::sort(times.begin(), times.end());
+	Vector<double> pos;
+	for(int i = 0; i < times.size(); ++i)
+	{
+		if(i > 0 && times[i] - times[i - 1] < 0.001) continue;
+		pos.push_back(times[i] / secondsPerValue);
+	}
+
+	int maxLag = max(1, (int)(MaxShift / secondsPerValue));
+	int minDistance = max(1, (int)(MinPeakDistance / secondsPerValue));
+
+	// Estimate the global shift.
+	Vector<float> corr;
+	CorrelateGlobal(env, pos, maxLag, corr);
+	FindPeak(corr, maxLag, minDistance, secondsPerValue, out.shift, out.confidence);
+
+	// Estimate the shift of each section separately.
+	double sectionSize = SectionLength / secondsPerValue;
+	for(int begin = 0; begin < pos.size();)
+	{
+		double sectionEnd = pos[begin] + sectionSize;
+		int end = begin;
+		while(end < pos.size() && pos[end] < sectionEnd) ++end;
+
+		if(end - begin >= MinSectionNotes)
+		{
+			OffsetSection section;
+			section.time = pos[begin] * secondsPerValue;
+			section.numNotes = end - begin;
+			CorrelateSection(env, pos.data() + begin, end - begin, maxLag, corr);
+			FindPeak(corr, maxLag, minDistance, secondsPerValue, section.shift, section.confidence);
+			sections.push_back(section);
+		}
+		begin = end;
+	}
+}
+
+OffsetEstimator* OffsetEstimator::New(const OnsetCache* onsets, const Vector<double>& noteTimes)
+{
+	// Check if the onset analysis of the music is available.
+	if(!onsets || onsets->novelty.empty())
+	{
+		HudInfo("The music is still being analyzed, wait a bit longer before estimating the offset.");
+		return nullptr;
+	}
+
+	// Check if there are notes to compare with the music.
+	if(noteTimes.empty())
+	{
+		HudInfo("There are no notes to estimate the offset with.");
+		return nullptr;
+	}
+
+	return new OffsetEstimatorImp(*onsets, noteTimes);
+}
+
+}; // namespace Vortex
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Core/Vector.h>
+
+namespace Vortex {
+
+struct OnsetCache;
+
+/// Estimated shift between the chart notes and the music.
+struct OffsetResult
+{
+	double shift;      ///< Time the notes have to move to line up with the music, in seconds.
+	double confidence; ///< How clearly the best shift stands out, between zero and one.
+};
+
+/// Shift estimated for a section of the chart, used to expose drift.
+struct OffsetSection
+{
+	double time;       ///< Start time of the section, in seconds.
+	int numNotes;      ///< Number of note rows in the section.
+	double shift;      ///< Time the notes have to move to line up with the music, in seconds.
+	double confidence; ///< How clearly the best shift stands out, between zero and one.
+};
+
+class OffsetEstimator
+{
+public:
+	/// Starts estimating how far the given note times are out of sync with the music in a background
+	/// thread. Returns null and shows a message if the onset analysis is not available yet or if
+	/// there are no notes to compare.
+	static OffsetEstimator* New(const OnsetCache* onsets, const Vector<double>& noteTimes);
+	virtual ~OffsetEstimator() {}
+
+	virtual bool hasResult() const = 0;
+	virtual const OffsetResult& getResult() const = 0;
+	virtual const Vector<OffsetSection>& getSections() const = 0;
+};
+
+/// Estimates the shift between the note times and the onset detection function of the music by
+/// cross-correlating them. The note times do not have to be sorted. Runs on the calling thread.
+void FindOffset(const float* novelty, int numValues, double secondsPerValue,
+	const double* noteTimes, int numNotes, OffsetResult& out, Vector<OffsetSection>& sections);
+
+}; // namespace Vortex
@@ -1113,4 +1113,72 @@ void FindOnsets(const float* samples, int samplerate, int numFrames, int numThre
 	}
 }
 
-}; // namespace Vortex
\ No newline at end of file
+bool FindOnsets(const short* samplesL, const short* samplesR, int samplerate, int numFrames,
+	const uchar* terminate, OnsetCache& out)
+{
+	static const int windowlen = 256;
+	static const int bufsize = windowlen * 4;
+	static const int blocksize = 32;
+	static char* method = "complex";
+
+	out.onsets.clear();
+	out.novelty.clear();
+	out.amplitude.clear();
+	out.samplerate = samplerate;
+	out.hopSize = windowlen;
+	out.blockSize = blocksize;
+
+	auto onset = new_aubio_onset(method, bufsize, windowlen, samplerate);
+	fvec_t* samplevec = new_fvec(windowlen), *beatvec = new_fvec(2);
+	out.novelty.reserve(max(0, numFrames / windowlen));
+	out.amplitude.reserve(max(0, (numFrames + blocksize - 1) / blocksize));
+
+	bool completed = true;
+	for(int i = 0; i < numFrames; i += windowlen)
+	{
+		if(*terminate)
+		{
+			completed = false;
+			break;
+		}
+
+		// Downmix the next hop to mono, the same way the tempo detector does.
+		int n = min(windowlen, numFrames - i);
+		const short* l = samplesL + i;
+		const short* r = samplesR + i;
+		for(int j = 0; j < n; ++j)
+		{
+			samplevec->data[j] = (float)((int)l[j] + (int)r[j]) / 65536.0f;
+		}
+
+		// Record the mean absolute amplitude of each block in the hop.
+		for(int j = 0; j < n; j += blocksize)
+		{
+			int m = min(blocksize, n - j);
+			float sum = 0.0f;
+			for(int k = j; k < j + m; ++k)
+			{
+				sum += fabsf(samplevec->data[k]);
+			}
+			out.amplitude.push_back(sum / (float)m);
+		}
+
+		// The onset tracker only processes complete hops.
+		if(n < windowlen) break;
+
+		aubio_onset_do(onset, samplevec, beatvec);
+		out.novelty.push_back(onset->desc->data[0]);
+		if(beatvec->data[0] > 0)
+		{
+			int pos = aubio_onset_get_last(onset);
+			if(pos >= 0) out.onsets.push_back({pos, 1.0});
+		}
+	}
+	del_fvec(samplevec);
+	del_fvec(beatvec);
+	del_aubio_onset(onset);
+
+	return completed;
+}
+
+}; // namespace Vortex
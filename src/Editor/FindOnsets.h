@@ -8,4 +8,21 @@ struct Onset { int pos; double strength; };
 
 void FindOnsets(const float* samples, int samplerate, int numFrames, int numThreads, Vector<Onset>& out);
 
+/// Onset analysis of an entire song, computed once after the music is loaded.
+struct OnsetCache
+{
+	Vector<Onset> onsets;  ///< Detected onsets, sorted by frame position.
+	Vector<float> novelty; ///< Onset detection function, one value per hop.
+	Vector<float> amplitude; ///< Mean absolute amplitude of the mono signal, one value per block.
+	int samplerate;
+	int hopSize;
+	int blockSize;
+};
+
+/// Runs the onset tracker over a stereo signal, which is downmixed to mono while reading, and
+/// records a reduced-rate amplitude envelope in the same pass. Returns false if the terminate flag
+/// was raised before the analysis was completed.
+bool FindOnsets(const short* samplesL, const short* samplesR, int samplerate, int numFrames,
+	const uchar* terminate, OnsetCache& out);
+
 }; // namespace Vortex
\ No newline at end of file
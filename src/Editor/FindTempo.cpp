@@ -9,7 +9,7 @@
 
 #include <Editor/FindTempo.h>
 #include <Editor/FindOnsets.h>
-#include <Editor/Music.h>
+#include <Editor/Sound.h>
 
 #include <algorithm>
 #include <functional>
@@ -41,12 +41,15 @@ struct TempoSort {
 
 struct SerializedTempo
 {
-	float* samples;
 	int samplerate;
 	int numFrames;
 	int numThreads;
 	uchar* terminate;
 	std::atomic_int progress;
+	Vector<Onset> onsets;
+	Vector<float> amplitude;
+	int amplitudeOffset;
+	int blockSize;
 	TempoResults result;
 };
 
@@ -440,35 +443,41 @@ static void CalculateBPM(SerializedTempo* data, Onset* onsets, int numOnsets)
 // ================================================================================================
 // Offset testing
 
-static void ComputeSlopes(const float* samples, real* out, int numFrames, int samplerate)
+// Returns the summed absolute amplitude of the frames in the range [begin, end).
+static real AmplitudeSum(const SerializedTempo* data, int begin, int end)
 {
-	memset(out, 0, sizeof(real) * numFrames);
-
-	int wh = samplerate / 20;
-	if(numFrames < wh * 2) return;
-
-	// Initial sums of the left/right side of the window.
-	real sumL = 0, sumR = 0;
-	for(int i = 0, j = wh; i < wh; ++i, ++j)
+	const float* amp = data->amplitude.data();
+	int blockSize = data->blockSize, numBlocks = data->amplitude.size();
+	begin += data->amplitudeOffset;
+	end += data->amplitudeOffset;
+
+	// The envelope stores mean values per block, partial blocks are weighted by their overlap.
+	int firstBlock = begin / blockSize, lastBlock = end / blockSize;
+	if(firstBlock == lastBlock)
 	{
-		sumL += abs(samples[i]);
-		sumR += abs(samples[j]);
+		return (firstBlock < numBlocks) ? amp[firstBlock] * (real)(end - begin) : 0.0;
 	}
-
-	// Slide window over the samples.
-	real scalar = 1.0 / (real)wh;
-	for(int i = wh, end = numFrames - wh; i < end; ++i)
+	real sum = amp[firstBlock] * (real)((firstBlock + 1) * blockSize - begin);
+	for(int i = firstBlock + 1; i < lastBlock; ++i)
 	{
-		// Determine slope value.
-		out[i] = std::max(0.0, (real)(sumR - sumL) * scalar);
-
-		// Move window.
-		real cur = abs(samples[i]);
-		sumL -= abs(samples[i - wh]);
-		sumL += cur;
-		sumR -= cur;
-		sumR += abs(samples[i + wh]);
+		sum += amp[i] * (real)blockSize;
 	}
+	if(lastBlock < numBlocks)
+	{
+		sum += amp[lastBlock] * (real)(end - lastBlock * blockSize);
+	}
+	return sum;
+}
+
+// Returns the increase in amplitude from the window before to the window after the given frame.
+static real SlopeAt(const SerializedTempo* data, int pos)
+{
+	int wh = data->samplerate / 20;
+	if(pos < wh || pos >= data->numFrames - wh) return 0.0;
+
+	real sumL = AmplitudeSum(data, pos - wh, pos);
+	real sumR = AmplitudeSum(data, pos, pos + wh);
+	return std::max(0.0, (sumR - sumL) / (real)wh);
 }
 
 // Returns the most promising offset for the given BPM value.
@@ -518,26 +527,21 @@ static real AdjustForOffbeats(SerializedTempo* data, real offset, real bpm)
 	int samplerate = data->samplerate;
 	int numFrames = data->numFrames;
 
-	// Create a slope representation of the waveform.
-	real* slopes = AlignedMalloc<real>(numFrames);
-	ComputeSlopes(data->samples, slopes, numFrames, samplerate);
-
 	// Determine the offbeat sample position.
 	real secondsPerBeat = 60.0 / bpm;
 	real offbeat = offset + secondsPerBeat * 0.5;
 	if(offbeat > secondsPerBeat) offbeat -= secondsPerBeat;
 
-	// Calculate the support for both sample positions.
+	// Calculate the support for both sample positions, evaluating the slope only at the beats.
 	real end = (real)numFrames;
 	real interval = secondsPerBeat * samplerate;
 	real posA = offset * samplerate, sumA = 0.0;
 	real posB = offbeat * samplerate, sumB = 0.0;
 	for(; posA < end && posB < end; posA += interval, posB += interval)
 	{
-		sumA += slopes[(int)posA];
-		sumB += slopes[(int)posB];
+		sumA += SlopeAt(data, (int)posA);
+		sumB += SlopeAt(data, (int)posB);
 	}
-	AlignedFree(slopes);
 
 	// Return the offset with the highest support.
 	return (sumA >= sumB) ? offset : offbeat;
@@ -576,15 +580,71 @@ static const char* sProgressText[]
 	"BPM detection results"
 };
 
+// Slices the input for the given range of frames from the signal and its onset analysis.
+static void SliceInput(SerializedTempo& data, const short* samplesL, const short* samplesR,
+	int samplerate, const OnsetCache& cache, int firstFrame, int numFrames)
+{
+	data.numFrames = numFrames;
+	data.samplerate = samplerate;
+
+	// Slice the onsets in the selected range from the onsets of the entire song.
+	int endFrame = firstFrame + numFrames;
+	const Onset* it = std::lower_bound(cache.onsets.begin(), cache.onsets.end(), firstFrame,
+		[](const Onset& onset, int pos) { return onset.pos < pos; });
+	for(; it != cache.onsets.end() && it->pos < endFrame; ++it)
+	{
+		data.onsets.push_back({it->pos - firstFrame, 1.0});
+	}
+
+	// Use the mean amplitude around the first onsets as their strength.
+	const short* l = samplesL + firstFrame;
+	const short* r = samplesR + firstFrame;
+	for(int i = 0; i < std::min(data.onsets.size(), 100); ++i)
+	{
+		int a = std::max(0, data.onsets[i].pos - 100);
+		int b = std::min(numFrames, data.onsets[i].pos + 100);
+		float v = 0.0f;
+		for(int j = a; j < b; ++j)
+		{
+			v += abs((float)((int)l[j] + (int)r[j]) / 65536.0f);
+		}
+		v /= (float)std::max(1, b - a);
+		data.onsets[i].strength = v;
+	}
+
+	// Copy the part of the amplitude envelope that covers the selected range.
+	int blockSize = cache.blockSize;
+	int firstBlock = std::min(firstFrame / blockSize, cache.amplitude.size());
+	int endBlock = std::min((endFrame + blockSize - 1) / blockSize, cache.amplitude.size());
+	data.amplitude.insert(0, cache.amplitude.data() + firstBlock, endBlock - firstBlock);
+	data.amplitudeOffset = firstFrame - firstBlock * blockSize;
+	data.blockSize = blockSize;
+}
+
+// Finds the BPM and offset candidates for the sliced input.
+static void DetectTempo(SerializedTempo* data)
+{
+	// The note onsets were already sliced from the onset analysis of the song.
+	Vector<Onset>& onsets = data->onsets;
+	MarkProgress(1, "Find onsets");
+
+	// Find BPM values.
+	CalculateBPM(data, onsets.data(), onsets.size());
+	MarkProgress(4, "Find BPM");
+
+	// Find offset values.
+	CalculateOffset(data, onsets.data(), onsets.size());
+	MarkProgress(5, "Find offsets");
+}
+
 class TempoDetectorImp : public TempoDetector, public BackgroundThread
 {
 public:
-	TempoDetectorImp(int firstFrame, int numFrames);
+	TempoDetectorImp(const Sound& sound, const OnsetCache& cache, int firstFrame, int numFrames);
 	~TempoDetectorImp();
 
 	void exec();
 
-	bool hasSamples() { return (data_.samples != nullptr); }
 	const char* getProgress() const { return sProgressText[data_.progress]; }
 	bool hasResult() const { return isDone(); }
 	const Vector<TempoResult>& getResult() const { return data_.result; }
@@ -593,27 +653,15 @@ private:
 	SerializedTempo data_;
 };
 
-TempoDetectorImp::TempoDetectorImp(int firstFrame, int numFrames)
+TempoDetectorImp::TempoDetectorImp(const Sound& sound, const OnsetCache& cache,
+	int firstFrame, int numFrames)
 {
-	auto& music = gMusic->getSamples();
-
 	data_.terminate = &terminationFlag_;
 	data_.progress = 0;
-	
 	data_.numThreads = ParallelThreads::concurrency();
-	data_.numFrames = numFrames;
-	data_.samplerate = music.getFrequency();
 
-	data_.samples = AlignedMalloc<float>(numFrames);
-	if(!data_.samples) return;
-
-	// Copy the input samples.
-	const short* l = music.samplesL() + firstFrame;
-	const short* r = music.samplesR() + firstFrame;
-	for(int i = 0; i < numFrames; ++i, ++l, ++r)
-	{
-		data_.samples[i] = (float)((int)*l + (int)*r) / 65536.0f;
-	}
+	SliceInput(data_, sound.samplesL(), sound.samplesR(), sound.getFrequency(), cache,
+		firstFrame, numFrames);
 
 	start();
 }
@@ -621,47 +669,34 @@ TempoDetectorImp::TempoDetectorImp(int firstFrame, int numFrames)
 TempoDetectorImp::~TempoDetectorImp()
 {
 	terminate();
-
-	AlignedFree(data_.samples);
 }
 
 void TempoDetectorImp::exec()
 {
-	SerializedTempo* data = &data_;
+	DetectTempo(&data_);
+}
 
-	// Run the aubio onset tracker to find note onsets.
-	Vector<Onset> onsets;
-	FindOnsets(data->samples, data->samplerate, data->numFrames, 1, onsets);
-	MarkProgress(1, "Find onsets");
+}; // anonymous namespace
 
-	for(int i = 0; i < std::min(onsets.size(), 100); ++i)
-	{
-		int a = std::max(0, onsets[i].pos - 100);
-		int b = std::min(data->numFrames, onsets[i].pos + 100);
-		float v = 0.0f;
-		for(int j = a; j < b; ++j)
-		{
-			v += abs(data->samples[j]);
-		}
-		v /= (float)std::max(1, b - a);
-		onsets[i].strength = v;
-	}
+void FindTempo(const short* samplesL, const short* samplesR, int samplerate,
+	const OnsetCache& onsets, int firstFrame, int numFrames, int numThreads, Vector<TempoResult>& out)
+{
+	if(firstFrame < 0 || numFrames <= 0) return;
 
-	// Find BPM values.
-	CalculateBPM(data, onsets.data(), onsets.size());
-	MarkProgress(4, "Find BPM");
+	SerializedTempo data;
+	uchar terminate = 0;
+	data.terminate = &terminate;
+	data.progress = 0;
+	data.numThreads = std::max(1, numThreads);
 
-	// Find offset values.
-	CalculateOffset(data, onsets.data(), onsets.size());
-	MarkProgress(5, "Find offsets");
-}
+	SliceInput(data, samplesL, samplesR, samplerate, onsets, firstFrame, numFrames);
+	DetectTempo(&data);
 
-}; // anonymous namespace
+	out.swap(data.result);
+}
 
-TempoDetector* TempoDetector::New(double time, double len)
+TempoDetector* TempoDetector::New(const Sound& music, const OnsetCache* onsets, double time, double len)
 {
-	auto& music = gMusic->getSamples();
-
 	// Check if the music is finished loading first.
 	if(!music.isCompleted())
 	{
@@ -679,16 +714,15 @@ TempoDetector* TempoDetector::New(double time, double len)
 		return nullptr;
 	}
 
-	// If so, we can detect the BPM.
-	auto detector = new TempoDetectorImp(firstFrame, numFrames);
-	if(!detector->hasSamples())
+	// Check if the onset analysis of the music is available.
+	if(!onsets)
 	{
-		HudError("Insufficient memory to perform BPM detection.");
-		delete detector;
-		detector = nullptr;
+		HudInfo("The music is still being analyzed, wait a bit longer before using BPM detection.");
+		return nullptr;
 	}
 
-	return detector;
+	// If so, we can detect the BPM.
+	return new TempoDetectorImp(music, *onsets, firstFrame, numFrames);
 }
 
 }; // namespace Vortex
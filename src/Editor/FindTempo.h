@@ -4,6 +4,9 @@
 
 namespace Vortex {
 
+class Sound;
+struct OnsetCache;
+
 struct TempoResult
 {
 	double bpm, offset, fitness;
@@ -12,7 +15,9 @@ struct TempoResult
 class TempoDetector
 {
 public:
-	static TempoDetector* New(double time, double len);
+	/// Starts tempo detection on a range of the given music in a background thread. Returns null
+	/// and shows a message if the music or its onset analysis is not available yet.
+	static TempoDetector* New(const Sound& music, const OnsetCache* onsets, double time, double len);
 	virtual ~TempoDetector() {}
 
 	virtual const char* getProgress() const = 0;
@@ -20,4 +25,10 @@ public:
 	virtual const Vector<TempoResult>& getResult() const = 0;
 };
 
+/// Performs tempo detection on a range of frames of a stereo signal, using the onset analysis of the
+/// entire signal. The range must lie within the signal. Runs on the calling thread; the results are
+/// sorted from best to worst fitness.
+void FindTempo(const short* samplesL, const short* samplesR, int samplerate,
+	const OnsetCache& onsets, int firstFrame, int numFrames, int numThreads, Vector<TempoResult>& out);
+
 }; // namespace Vortex
\ No newline at end of file
@@ -3,10 +3,19 @@
 #include <Core/Draw.h>
 #include <Core/Text.h>
 #include <Core/Utils.h>
+#include <Core/Xmr.h>
 
 #include <System/System.h>
+#include <System/Debug.h>
+#include <System/File.h>
+
+#include <Simfile/Simfile.h>
+#include <Simfile/Chart.h>
+#include <Simfile/Tempo.h>
+#include <Simfile/SegmentGroup.h>
 
 #include <Editor/Common.h>
+#include <Editor/Journal.h>
 
 #define HISTORY ((HistoryImpl*)gHistory)
 
@@ -15,6 +24,34 @@
 namespace Vortex {
 namespace {
 
+// Size of the memory segments in which the entries are stored. Larger entries get their own segment.
+static const uint SegmentSize = 64 * 1024;
+
+// Default memory limit of the history in megabytes, zero means there is no limit.
+static const int DefaultMemoryLimit = 256;
+
+// Default number of most recent entries that are not compressed, zero means entries are never
+// compressed.
+static const int DefaultUncompressedEntries = 0;
+
+// Number of bits of the hash table that finds repeated byte sequences when compressing entries.
+static const int PackHashBits = 12;
+
+// Entries that follow each other within this many seconds can be merged into a single entry.
+static const double MergeWindow = 1.0;
+
+// Types of the records in the edit journal.
+enum JournalRecord
+{
+	JOURNAL_START, // Describes the simfile to which the journal applies.
+	JOURNAL_ENTRY, // An entry that was added.
+	JOURNAL_MERGE, // An entry that was merged with the previous entry.
+	JOURNAL_CHAIN, // A chain of entries that was added.
+	JOURNAL_UNDO,  // The most recent entry was undone.
+	JOURNAL_REDO,  // The next entry was redone.
+	JOURNAL_STOP,  // An entry could not be written, the journal ends here.
+};
+
 struct HistoryImpl : public History {
 
 // ================================================================================================
@@ -24,11 +61,22 @@ struct Callback
 {
 	History::ApplyFunc apply;
 	History::ReleaseFunc release;
+	History::MergeFunc merge;
+	History::JournalFunc journal;
+	bool journaled;
 };
 
+// An entry in the history. The memory starts with the entry header, followed by the entry data.
+// Packed entries are compressed, and are stored in separate segments.
 struct Entry
 {
-	Entry* next;
+	const uchar* mem;
+	uint size;
+	bool isPacked;
+
+	// The chart and tempo that are bound after the entry.
+	Chart* chart;
+	Tempo* tempo;
 };
 
 struct EntryData
@@ -40,75 +88,41 @@ struct EntryData
 	const uchar* data;
 };
 
-struct EntryList
+// A block of memory in which entries are stored back to back. Entries are only added to the end of
+// the last segment and released from the begin of the first segment or the end of the last segment,
+// so a segment is freed when its last entry is released.
+struct Segment
 {
-	EntryList() : head(nullptr)
-	{
-	}
-	void add(Entry* entry)
-	{
-		if(head)
-		{
-			auto it = head;
-			while(it->next) it = it->next;
-			it->next = entry;
-		}
-		else
-		{
-			head = entry;
-		}
-	}
-	void reverse()
-	{
-		Entry* it = head, *prev = nullptr, *next;
-		while(it)
-		{
-			next = it->next;
-			it->next = prev;
-			prev = it;
-			it = next;
-		}
-		head = prev;
-	}
-	Entry* head;
+	uchar* mem;
+	uint size, used;
+	int numEntries;
 };
 
 // ================================================================================================
 // HistoryImpl :: helper functions.
 
-static Entry* CreateEntry(EditId id, const void* data, uint size, Chart* c, Tempo* t)
+static void WriteEntryHeader(WriteStream& out, EditId id, uint size, Chart* c, Tempo* t)
 {
 	bool hasChart = (c != nullptr);
 	bool hasTempo = (t != nullptr);
 
-	WriteStream header;
-	header.write<Entry>({nullptr});
-
 	uint flags = (id << 2) | (hasTempo << 1) | (hasChart << 0);
-	header.writeNum(flags);
-	if(hasChart) header.write(c);
-	if(hasTempo) header.write(t);
-	header.writeNum(size);
+	out.writeNum(flags);
+	if(hasChart) out.write(c);
+	if(hasTempo) out.write(t);
+	out.writeNum(size);
 
 #ifdef DEBUG
 	HudNote("Creating entry [header=%ib, data=%ib, chart:%c, tempo:%c",
-		header.size(), size,
+		out.size(), size,
 		hasChart ? 'y' : 'n',
 		hasTempo ? 'y' : 'n');
 #endif
-
-	uchar* mem = (uchar*)malloc(header.size() + size);
-	memcpy(mem, header.data(), header.size());
-	memcpy(mem + header.size(), data, size);
-
-	Entry* entry = (Entry*)mem;
-	entry->next = nullptr;
-	return (Entry*)entry;
 }
 
-static EntryData DecodeEntry(const Entry* in)
+static EntryData DecodeEntry(const uchar* in)
 {
-	ReadStream header(in + 1, INT_MAX);
+	ReadStream header(in, INT_MAX);
 
 	EntryData out = {0, nullptr, nullptr, 0, nullptr};
 
@@ -124,19 +138,7 @@ static EntryData DecodeEntry(const Entry* in)
 	return out;
 }
 
-static Entry* Advance(Entry* it, Bindings& bound)
-{
-	ReadStream header(it + 1, INT_MAX);
-
-	uint flags;
-	header.readNum(flags);
-	if(flags & 1) header.read(bound.chart);
-	if(flags & 2) header.read(bound.tempo);
-
-	return it->next;
-}
-
-static void ReleaseEntry(Entry* in, bool hasBeenApplied)
+static void ReleaseEntry(const uchar* in, bool hasBeenApplied)
 {
 	EntryData entry = DecodeEntry(in);
 	auto& callback = HISTORY->myCallbacks[entry.id];
@@ -145,10 +147,89 @@ static void ReleaseEntry(Entry* in, bool hasBeenApplied)
 		ReadStream stream(entry.data, entry.size);
 		callback.release(stream, hasBeenApplied);
 	}
-	free(in);
 }
 
-static String ApplyEntry(const Entry* in, Bindings bound, bool undo, bool redo)
+// Compresses an entry with a simple LZ77 scheme. The compressed data is a sequence of literal runs,
+// each followed by a back reference into the output, and ends with a reference of length zero.
+// Entries that do not get smaller, such as most single note edits, are stored as they are.
+static void PackEntry(const uchar* in, uint size, WriteStream& out)
+{
+	Vector<uint> table(1 << PackHashBits, UINT_MAX);
+	WriteStream packed;
+	packed.writeNum(size);
+
+	uint pos = 0, literals = 0;
+	while(pos + 4 <= size)
+	{
+		uint bytes;
+		memcpy(&bytes, in + pos, 4);
+		uint hash = (bytes * 2654435761u) >> (32 - PackHashBits);
+		uint match = table[hash];
+		table[hash] = pos;
+
+		uint length = 0;
+		if(match != UINT_MAX && pos - match <= 0xFFFF)
+		{
+			while(pos + length < size && in[match + length] == in[pos + length]) ++length;
+		}
+		if(length < 4)
+		{
+			++pos;
+			continue;
+		}
+		packed.writeNum(pos - literals);
+		packed.write(in + literals, pos - literals);
+		packed.writeNum(length);
+		packed.writeNum(pos - match);
+		pos += length;
+		literals = pos;
+	}
+	packed.writeNum(size - literals);
+	packed.write(in + literals, size - literals);
+	packed.writeNum(0);
+
+	bool isCompressed = ((uint)packed.size() < size);
+	out.write<uchar>(isCompressed);
+	if(isCompressed)
+	{
+		out.write(packed.data(), packed.size());
+	}
+	else
+	{
+		out.write(in, size);
+	}
+}
+
+// Decompresses an entry that was compressed with PackEntry.
+static void UnpackEntry(const uchar* in, uint size, Vector<uchar>& out)
+{
+	ReadStream stream(in, size);
+	if(stream.read<uchar>() == 0)
+	{
+		out.resize(size - 1);
+		stream.read(out.data(), size - 1);
+		return;
+	}
+	out.resize(stream.readNum());
+
+	uchar* dst = out.data();
+	while(stream.success())
+	{
+		uint literals = stream.readNum();
+		stream.read(dst, literals);
+		dst += literals;
+
+		uint length = stream.readNum();
+		if(length == 0) break;
+		const uchar* src = dst - stream.readNum();
+		for(uint i = 0; i < length; ++i)
+		{
+			*dst++ = *src++;
+		}
+	}
+}
+
+static String ApplyEntry(const uchar* in, Bindings bound, bool undo, bool redo)
 {
 	EntryData entry = DecodeEntry(in);
 
@@ -163,62 +244,386 @@ static String ApplyEntry(const Entry* in, Bindings bound, bool undo, bool redo)
 // ================================================================================================
 // HistoryImpl :: member data.
 
-EntryList myEntries;
+Vector<Entry> myEntries;
+int myFirstEntry;
+
+Vector<Segment> mySegments;
+size_t myMemoryUse;
+size_t myMemoryLimit;
+
+// The packed entries are the oldest entries, they are stored in their own segments.
+Vector<Segment> myPackedSegments;
+int myPackedEntries;
+int myUncompressedEntries;
+Vector<uchar> myUnpackBuffer;
+
+// The chart and tempo that are bound before the first entry.
+Chart* myBaseChart;
+Tempo* myBaseTempo;
 
 int mySavedEntries;
+int mySavingEntries;
 int myAppliedEntries;
 int myTotalEntries;
 
 Simfile* mySimfile;
 
-EntryList myChain;
+Vector<uchar> myChain;
+int myChainEntries;
 int myOpenChains;
 
 Vector<Callback> myCallbacks;
 
+// Time at which the most recent entry was added, and whether the next entry may be merged with it.
+std::chrono::steady_clock::time_point myLastEntryTime;
+bool myCanMergeEntry;
+
+// The edit journal, which is opened when the first edit after opening or saving the simfile is made.
+Journal myJournal;
+bool myJournalStopped;
+bool myIsReplaying;
+bool myReplayMerge;
+
+// While a snapshot is being saved, the journal start record of the snapshot and the journal records
+// that are written after it, so the journal can be restarted from the saved file.
+bool myIsSaving;
+Vector<uchar> mySavingJournal;
+Vector<uint> mySavingRecords;
+
 // ================================================================================================
 // HistoryImpl :: constructor and destructor.
 
 ~HistoryImpl()
 {
+	myJournal.close(true);
 	clearEverything();
 }
 
 HistoryImpl()
-	: mySavedEntries(0)
+	: myFirstEntry(0)
+	, myMemoryUse(0)
+	, myMemoryLimit((size_t)DefaultMemoryLimit << 20)
+	, myPackedEntries(0)
+	, myUncompressedEntries(DefaultUncompressedEntries)
+	, myBaseChart(nullptr)
+	, myBaseTempo(nullptr)
+	, mySavedEntries(0)
+	, mySavingEntries(NO_SAVED_ENTRIES)
 	, myAppliedEntries(0)
 	, myTotalEntries(0)
+	, mySimfile(nullptr)
+	, myChainEntries(0)
 	, myOpenChains(0)
+	, myCanMergeEntry(false)
+	, myJournalStopped(false)
+	, myIsReplaying(false)
+	, myReplayMerge(false)
+	, myIsSaving(false)
+{
+	myCallbacks.push_back({ApplyChain, ReleaseChain, nullptr, nullptr, false});
+}
+
+// ================================================================================================
+// HistoryImpl :: load / save settings.
+
+void loadSettings(XmrNode& settings)
+{
+	XmrNode* history = settings.child("history");
+	if(history)
+	{
+		int memoryLimit = DefaultMemoryLimit;
+		history->get("memoryLimit", &memoryLimit);
+		myMemoryLimit = (size_t)max(0, memoryLimit) << 20;
+
+		history->get("uncompressedEntries", &myUncompressedEntries);
+		myUncompressedEntries = max(0, myUncompressedEntries);
+	}
+}
+
+void saveSettings(XmrNode& settings)
 {
-	myCallbacks.push_back({ApplyChain, ReleaseChain});
+	XmrNode* history = settings.addChild("history");
+
+	history->addAttrib("memoryLimit", (long)(myMemoryLimit >> 20));
+	history->addAttrib("uncompressedEntries", (long)myUncompressedEntries);
 }
 
 // ================================================================================================
 // HistoryImpl :: adding callbacks.
 
-EditId addCallback(ApplyFunc apply, ReleaseFunc release)
+EditId addCallback(ApplyFunc apply, ReleaseFunc release, MergeFunc merge)
 {
 	EditId out = myCallbacks.size();
-	myCallbacks.push_back({apply, release});
+	myCallbacks.push_back({apply, release, merge, nullptr, false});
+	return out;
+}
+
+void enableJournal(EditId id, JournalFunc func)
+{
+	myCallbacks[id].journaled = true;
+	myCallbacks[id].journal = func;
+}
+
+// ================================================================================================
+// HistoryImpl :: entry storage.
+
+// Returns the bindings after the given number of entries.
+Bindings getBindings(int numEntries) const
+{
+	Bindings out = {mySimfile, myBaseChart, myBaseTempo};
+	if(numEntries > 0)
+	{
+		auto& entry = myEntries[myFirstEntry + numEntries - 1];
+		out.chart = entry.chart;
+		out.tempo = entry.tempo;
+	}
+	return out;
+}
+
+// Returns the memory of the entry. Packed entries are unpacked to a buffer, which is valid until the
+// next entry is unpacked.
+const uchar* getEntryMem(const Entry& entry)
+{
+	if(!entry.isPacked) return entry.mem;
+	UnpackEntry(entry.mem, entry.size, myUnpackBuffer);
+	return myUnpackBuffer.data();
+}
+
+uchar* allocateEntry(Vector<Segment>& segments, uint size)
+{
+	if(segments.empty() || segments.back().size - segments.back().used < size)
+	{
+		Segment segment = {nullptr, max(size, SegmentSize), 0, 0};
+		segment.mem = (uchar*)malloc(segment.size);
+		segments.push_back(segment);
+		myMemoryUse += segment.size;
+	}
+	Segment& segment = segments.back();
+	uchar* out = segment.mem + segment.used;
+	segment.used += size;
+	++segment.numEntries;
 	return out;
 }
 
+void freeSegment(Vector<Segment>& segments, int index)
+{
+	myMemoryUse -= segments[index].size;
+	free(segments[index].mem);
+	segments.erase(index);
+}
+
+// Frees the memory of the most recent entry, without releasing its data. The packed entries precede
+// the regular entries, so the entry is always at the end of the last segment.
+void freeLastEntry()
+{
+	Entry entry = myEntries.back();
+	myEntries.pop_back();
+
+	auto& segments = entry.isPacked ? myPackedSegments : mySegments;
+	Segment& segment = segments.back();
+	segment.used -= entry.size;
+	if(--segment.numEntries == 0)
+	{
+		freeSegment(segments, segments.size() - 1);
+	}
+	if(entry.isPacked)
+	{
+		--myPackedEntries;
+	}
+}
+
+// Releases the most recent entry.
+void popLastEntry(bool hasBeenApplied)
+{
+	ReleaseEntry(getEntryMem(myEntries.back()), hasBeenApplied);
+	freeLastEntry();
+	--myTotalEntries;
+}
+
+// Releases the oldest entry, which must have been applied.
+void popFirstEntry()
+{
+	Entry entry = myEntries[myFirstEntry];
+	ReleaseEntry(getEntryMem(entry), true);
+	myBaseChart = entry.chart;
+	myBaseTempo = entry.tempo;
+
+	// The released slots are removed once they outnumber the remaining entries.
+	++myFirstEntry;
+	if(myFirstEntry * 2 >= myEntries.size())
+	{
+		myEntries.erase(0, myFirstEntry);
+		myFirstEntry = 0;
+	}
+
+	auto& segments = entry.isPacked ? myPackedSegments : mySegments;
+	if(--segments[0].numEntries == 0)
+	{
+		freeSegment(segments, 0);
+	}
+	if(entry.isPacked)
+	{
+		--myPackedEntries;
+	}
+	--myAppliedEntries;
+	--myTotalEntries;
+	if(mySavedEntries != NO_SAVED_ENTRIES)
+	{
+		--mySavedEntries;
+	}
+	if(mySavingEntries != NO_SAVED_ENTRIES)
+	{
+		--mySavingEntries;
+	}
+}
+
+// Compresses the oldest regular entries until only the most recent entries are left uncompressed.
+// The oldest regular entry is always at the begin of the first segment, and it is appended to the
+// packed segments, so the packed entries stay in order.
+void packOldEntries()
+{
+	if(myUncompressedEntries == 0) return;
+
+	int numPacked = 0;
+	uint oldSize = 0, newSize = 0;
+	while(myTotalEntries - myPackedEntries > myUncompressedEntries)
+	{
+		Entry& entry = myEntries[myFirstEntry + myPackedEntries];
+
+		WriteStream packed;
+		PackEntry(entry.mem, entry.size, packed);
+		uchar* mem = allocateEntry(myPackedSegments, packed.size());
+		memcpy(mem, packed.data(), packed.size());
+
+		if(--mySegments[0].numEntries == 0)
+		{
+			freeSegment(mySegments, 0);
+		}
+		oldSize += entry.size;
+		newSize += packed.size();
+
+		entry.mem = mem;
+		entry.size = packed.size();
+		entry.isPacked = true;
+		++myPackedEntries;
+		++numPacked;
+	}
+	if(numPacked > 0)
+	{
+		Debug::log("History compressed %i entries from %u to %u bytes\n", numPacked, oldSize, newSize);
+	}
+}
+
+// Releases the oldest entries until the history fits in the memory limit. The most recent entry is
+// always kept, even if it does not fit by itself.
+void applyMemoryLimit()
+{
+	if(myMemoryLimit == 0) return;
+
+	int numReleased = 0;
+	while(myMemoryUse > myMemoryLimit && myAppliedEntries > 1)
+	{
+		popFirstEntry();
+		++numReleased;
+	}
+	if(numReleased > 0)
+	{
+		Debug::log("History exceeded %i MB, released %i oldest entries\n",
+			(int)(myMemoryLimit >> 20), numReleased);
+	}
+}
+
 // ================================================================================================
 // HistoryImpl :: adding entries.
 
-void pushEntry(Entry* entry)
+void pushEntry(const WriteStream& header, const void* data, uint size)
 {
-	Bindings bound = {mySimfile, nullptr, nullptr};
-	auto it = myEntries.head;
-	while(it) it = Advance(it, bound);
+	Bindings bound = getBindings(myTotalEntries);
 
-	myEntries.add(entry);
+	uint headerSize = header.size();
+	uchar* mem = allocateEntry(mySegments, headerSize + size);
+	memcpy(mem, header.data(), headerSize);
+	memcpy(mem + headerSize, data, size);
+
+	EntryData decoded = DecodeEntry(mem);
+	Chart* chart = decoded.chart ? decoded.chart : bound.chart;
+	Tempo* tempo = decoded.tempo ? decoded.tempo : bound.tempo;
+	myEntries.push_back({mem, headerSize + size, false, chart, tempo});
 	++myAppliedEntries;
 	++myTotalEntries;
 
-	String msg = ApplyEntry(entry, bound, false, false);
+	writeJournalEntry(decoded, bound, JOURNAL_ENTRY);
+
+	String msg = ApplyEntry(mem, bound, false, false);
+
+	if(msg.len() && !myIsReplaying) HudNote("%s", msg.str());
 
-	if(msg.len()) HudNote("%s", msg.str());
+	myLastEntryTime = Debug::getElapsedTime();
+	myCanMergeEntry = true;
+
+	packOldEntries();
+	applyMemoryLimit();
+}
+
+// Applies the entry and merges it with the most recent entry, if both entries are of the same type,
+// have the same target and are added in quick succession. Returns false if the entry can not be
+// merged, in which case nothing is applied.
+bool mergeEntry(EditId id, const WriteStream& header, const void* data, uint size)
+{
+	auto& callback = myCallbacks[id];
+	if(!callback.merge || !myCanMergeEntry || myAppliedEntries == 0) return false;
+
+	// The saved state must stay reachable through undo.
+	if(mySavedEntries == myAppliedEntries) return false;
+
+	// While replaying the journal, entries are merged exactly like they were originally.
+	if(myIsReplaying)
+	{
+		if(!myReplayMerge) return false;
+	}
+	else if(Debug::getElapsedTime(myLastEntryTime) > MergeWindow)
+	{
+		return false;
+	}
+
+	EntryData next = DecodeEntry(header.data());
+	if(next.chart || next.tempo) return false;
+
+	// The most recent entry is never packed, since packing leaves at least one entry uncompressed.
+	Entry last = myEntries.back();
+	EntryData prev = DecodeEntry(last.mem);
+	if(prev.id != id) return false;
+
+	WriteStream merged;
+	ReadStream prevStream(prev.data, prev.size), nextStream(data, size);
+	if(!callback.merge(prevStream, nextStream, merged)) return false;
+
+	// Apply the new entry on top of the most recent entry.
+	Bindings bound = getBindings(myTotalEntries);
+	next.data = (const uchar*)data;
+	writeJournalEntry(next, bound, JOURNAL_MERGE);
+
+	ReadStream stream(data, size);
+	String msg = callback.apply(stream, bound, false, false);
+	if(msg.len() && !myIsReplaying) HudNote("%s", msg.str());
+
+	// Replace the most recent entry with the merged entry. Types that can be merged do not have a
+	// release function, so the data of the replaced entry can simply be discarded.
+	WriteStream mergedHeader;
+	WriteEntryHeader(mergedHeader, id, merged.size(), prev.chart, prev.tempo);
+	freeLastEntry();
+
+	uint headerSize = mergedHeader.size();
+	uchar* mem = allocateEntry(mySegments, headerSize + merged.size());
+	memcpy(mem, mergedHeader.data(), headerSize);
+	memcpy(mem + headerSize, merged.data(), merged.size());
+	myEntries.push_back({mem, headerSize + merged.size(), false, last.chart, last.tempo});
+
+	myLastEntryTime = Debug::getElapsedTime();
+
+	applyMemoryLimit();
+
+	return true;
 }
 
 void addEntry(EditId id, const void* data, uint size, Chart* targetChart, Tempo* targetTempo)
@@ -231,23 +636,22 @@ void addEntry(EditId id, const void* data, uint size, Chart* targetChart, Tempo*
 
 	clearUnappliedEntries();
 
-	// Find out what the current bindings are.
-	Bindings bound = {mySimfile, nullptr, nullptr};
-	auto it = myEntries.head;
-	while(it) it = Advance(it, bound);
-
 	// If the target chart/tempo are equal to the current chart/tempo, there is no need to record them.
+	Bindings bound = getBindings(myTotalEntries);
 	if(targetChart == bound.chart) targetChart = nullptr;
 	if(targetTempo == bound.tempo) targetTempo = nullptr;
 
-	Entry* entry = CreateEntry(id, data, size, targetChart, targetTempo);
+	WriteStream header;
+	WriteEntryHeader(header, id, size, targetChart, targetTempo);
 	if(myOpenChains > 0)
 	{
-		myChain.add(entry);
+		myChain.insert(myChain.size(), header.data(), header.size());
+		myChain.insert(myChain.size(), (const uchar*)data, size);
+		++myChainEntries;
 	}
-	else
+	else if(!mergeEntry(id, header, data, size))
 	{
-		pushEntry(entry);
+		pushEntry(header, data, size);
 	}
 }
 
@@ -269,40 +673,52 @@ void addEntry(EditId id, const void* data, uint size, Chart* targetChart)
 // ================================================================================================
 // HistoryImpl :: undo/redo entries.
 
-void redoEntry()
+// Redoes the next entry. Returns false if there is no entry to redo.
+bool redoEntry()
 {
-	if(myTotalEntries > myAppliedEntries)
-	{
-		Bindings bound = {mySimfile, nullptr, nullptr};
-		auto it = myEntries.head;
-		for(int i = 0; i < myAppliedEntries; ++i) it = Advance(it, bound);
+	if(myTotalEntries == myAppliedEntries) return false;
 
-		String msg = ApplyEntry(it, bound, false, true);
+	// The journal is written first, so a journal that is started here describes the state before
+	// the entry is redone.
+	writeJournalRecord(JOURNAL_REDO);
 
-		++myAppliedEntries;
+	Bindings bound = getBindings(myAppliedEntries);
+	auto& entry = myEntries[myFirstEntry + myAppliedEntries];
 
-		if(msg.empty()) msg = "---";
-		HudNote("{tc:4a4}{g:redo}{tc:666}[%i/%i]:{tc} %s",
-			myAppliedEntries, myTotalEntries, msg.str());
-	}
+	String msg = ApplyEntry(getEntryMem(entry), bound, false, true);
+
+	++myAppliedEntries;
+	myCanMergeEntry = false;
+
+	if(myIsReplaying) return true;
+	if(msg.empty()) msg = "---";
+	HudNote("{tc:4a4}{g:redo}{tc:666}[%i/%i]:{tc} %s",
+		myAppliedEntries, myTotalEntries, msg.str());
+
+	return true;
 }
 
-void undoEntry()
+// Undoes the most recent entry. Returns false if there is no entry to undo.
+bool undoEntry()
 {
-	if(myAppliedEntries > 0)
-	{
-		Bindings bound = {mySimfile, nullptr, nullptr};
-		auto it = myEntries.head;
-		for(int i = 0; i < myAppliedEntries - 1; ++i) it = Advance(it, bound);
+	if(myAppliedEntries == 0) return false;
 
-		String msg = ApplyEntry(it, bound, true, false);
+	writeJournalRecord(JOURNAL_UNDO);
 
-		--myAppliedEntries;
+	Bindings bound = getBindings(myAppliedEntries - 1);
+	auto& entry = myEntries[myFirstEntry + myAppliedEntries - 1];
 
-		if(msg.empty()) msg = "---";
-		HudNote("{tc:822}{g:undo}{tc:666}[%i/%i]:{tc} %s",
-			myAppliedEntries, myTotalEntries, msg.str());
-	}
+	String msg = ApplyEntry(getEntryMem(entry), bound, true, false);
+
+	--myAppliedEntries;
+	myCanMergeEntry = false;
+
+	if(myIsReplaying) return true;
+	if(msg.empty()) msg = "---";
+	HudNote("{tc:822}{g:undo}{tc:666}[%i/%i]:{tc} %s",
+		myAppliedEntries, myTotalEntries, msg.str());
+
+	return true;
 }
 
 // ================================================================================================
@@ -326,17 +742,58 @@ void onKeyPress(KeyPress& evt)
 void onFileOpen(Simfile* simfile)
 {
 	mySimfile = simfile;
+	recoverJournal();
+}
+
+void onFileSaveStarted()
+{
+	mySavingEntries = myAppliedEntries;
+
+	// Edits made during the save are not part of the snapshot, so they can not be merged into it.
+	myCanMergeEntry = false;
+
+	WriteStream start;
+	writeJournalStart(start);
+	myIsSaving = true;
+	mySavingJournal.clear();
+	mySavingRecords.clear();
+	saveJournalRecord(start.data(), start.size());
 }
 
 void onFileSaved()
 {
-	mySavedEntries = myAppliedEntries;
+	// The file is written in the background, so edits may have been made since the snapshot.
+	mySavedEntries = mySavingEntries;
+	mySavingEntries = NO_SAVED_ENTRIES;
+
+	// The records of the current journal start before the saved file, so it is replaced by a journal
+	// that starts at the saved file and contains the records written during the save. If the saved
+	// simfile contains all edits, a new journal is started by the next edit instead.
+	myJournal.close(true);
+	if(mySavedEntries == myAppliedEntries)
+	{
+		myJournalStopped = false;
+	}
+	else if(mySavingRecords.size() > 1)
+	{
+		restartJournal();
+	}
+	myIsSaving = false;
+	mySavingJournal.clear();
+	mySavingRecords.clear();
 }
 
 void onFileClosed()
 {
+	myJournal.close(true);
+	myJournalStopped = false;
+
 	clearEverything();
 	mySavedEntries = 0;
+	mySavingEntries = NO_SAVED_ENTRIES;
+	myIsSaving = false;
+	mySavingJournal.clear();
+	mySavingRecords.clear();
 	mySimfile = nullptr;
 }
 
@@ -345,21 +802,44 @@ bool hasUnsavedChanges() const
 	return (mySavedEntries != myAppliedEntries);
 }
 
+size_t getMemoryUse() const
+{
+	return myMemoryUse;
+}
+
+int getNumEntries() const
+{
+	return myTotalEntries;
+}
+
 // ================================================================================================
 // HistoryImpl :: chains.
 
+// Reads the number of entries in a chain, followed by the positions of the entries.
+static void ReadChain(ReadStream& in, Vector<const uchar*>& out)
+{
+	uint numEntries = in.readNum();
+	for(uint i = 0; i < numEntries && in.success(); ++i)
+	{
+		out.push_back(in.pos());
+		uint flags = in.readNum();
+		if(flags & 1) in.skip(sizeof(Chart*));
+		if(flags & 2) in.skip(sizeof(Tempo*));
+		in.skip(in.readNum());
+	}
+}
+
 static void ReleaseChain(ReadStream& in, bool hasBeenApplied)
 {
-	auto list = in.read<EntryList>();
+	Vector<const uchar*> entries;
+	ReadChain(in, entries);
 	auto msg = in.readStr();
 	if(in.success())
 	{
-		list.reverse(); // Release in reverse order, from most recent to oldest.
-		for(auto it = list.head; it;)
+		// Release in reverse order, from most recent to oldest.
+		for(int i = entries.size() - 1; i >= 0; --i)
 		{
-			auto next = it->next;
-			ReleaseEntry(it, hasBeenApplied);
-			it = next;
+			ReleaseEntry(entries[i], hasBeenApplied);
 		}
 	}
 	else
@@ -370,24 +850,24 @@ static void ReleaseChain(ReadStream& in, bool hasBeenApplied)
 
 static String ApplyChain(ReadStream& in, History::Bindings bound, bool undo, bool redo)
 {
-	auto list = in.read<EntryList>();
+	Vector<const uchar*> entries;
+	ReadChain(in, entries);
 	auto msg = in.readStr();
 	if(in.success())
 	{
 		if(undo)
 		{
-			list.reverse(); // Undo in reverse order, from most recent to oldest.
-			for(auto it = list.head; it; it = it->next)
+			// Undo in reverse order, from most recent to oldest.
+			for(int i = entries.size() - 1; i >= 0; --i)
 			{
-				ApplyEntry(it, bound, true, redo);
+				ApplyEntry(entries[i], bound, true, redo);
 			}
-			list.reverse(); // Restore the original order.
 		}
 		else
 		{
-			for(auto it = list.head; it; it = it->next)
+			for(auto entry : entries)
 			{
-				ApplyEntry(it, bound, false, redo);
+				ApplyEntry(entry, bound, false, redo);
 			}
 		}
 	}
@@ -406,18 +886,302 @@ void startChain()
 void finishChain(String msg)
 {
 	myOpenChains = max(0, myOpenChains - 1);
-	if(myChain.head && myOpenChains == 0)
+	if(myChainEntries > 0 && myOpenChains == 0)
 	{
 		clearUnappliedEntries();
 
 		WriteStream stream;
-		stream.write(myChain);
+		stream.writeNum(myChainEntries);
+		stream.write(myChain.data(), myChain.size());
 		stream.writeStr(msg);
 
-		myChain.head = nullptr;
+		myChain.clear();
+		myChainEntries = 0;
 
-		auto entry = CreateEntry(0, stream.data(), stream.size(), nullptr, nullptr);
-		pushEntry(entry);
+		WriteStream header;
+		WriteEntryHeader(header, 0, stream.size(), nullptr, nullptr);
+		pushEntry(header, stream.data(), stream.size());
+	}
+}
+
+// ================================================================================================
+// HistoryImpl :: edit journal.
+
+String getJournalPath() const
+{
+	return Path(mySimfile->dir, mySimfile->file, "journal").str;
+}
+
+// Describes the simfile at the start of the journal, so the journal is not replayed on a simfile
+// that was changed by other means in the meantime. Only uses chart properties that are known
+// before the notes of a chart are loaded.
+void writeJournalStart(WriteStream& out) const
+{
+	out.write<uchar>(JOURNAL_START);
+	out.writeNum(myCallbacks.size());
+	out.writeNum(mySimfile->tempo->segments->numSegments());
+	out.writeNum(mySimfile->charts.size());
+	for(auto chart : mySimfile->charts)
+	{
+		out.writeNum(chart->difficulty);
+		out.writeNum(chart->meter);
+		out.writeNum(chart->tempo ? chart->tempo->segments->numSegments() : 0);
+	}
+}
+
+bool openJournal()
+{
+	if(myJournalStopped || !mySimfile) return false;
+	if(myJournal.isOpen()) return true;
+
+	if(!myJournal.open(getJournalPath()))
+	{
+		myJournalStopped = true;
+		return false;
+	}
+
+	WriteStream out;
+	writeJournalStart(out);
+	myJournal.append(out.data(), out.size());
+	return true;
+}
+
+// Appends a record to the journal. While a snapshot is being saved, the record is also kept for
+// the journal that replaces the current one once the save is done.
+void appendJournalRecord(const void* data, uint size)
+{
+	myJournal.append(data, size);
+	if(myIsSaving) saveJournalRecord(data, size);
+}
+
+void saveJournalRecord(const void* data, uint size)
+{
+	const uchar* bytes = (const uchar*)data;
+	mySavingJournal.insert(mySavingJournal.size(), bytes, size);
+	mySavingRecords.push_back(size);
+}
+
+// Replaces the journal by one that starts at the saved snapshot. The records were written relative
+// to the snapshot, so replaying them on the saved file gives the current state of the simfile. If
+// the journal was stopped during the save, the stop record is copied and it stays stopped.
+void restartJournal()
+{
+	if(!myJournal.open(getJournalPath()))
+	{
+		myJournalStopped = true;
+		return;
+	}
+	const uchar* data = mySavingJournal.data();
+	for(uint size : mySavingRecords)
+	{
+		myJournal.append(data, size);
+		data += size;
+	}
+}
+
+// Charts are written by index plus one, zero means no chart. Tempos are written by chart index plus
+// two, one means the simfile tempo. Returns false if the chart or tempo is not part of the simfile.
+bool writeJournalTargets(WriteStream& out, Chart* chart, Tempo* tempo) const
+{
+	auto& charts = mySimfile->charts;
+	int chartIndex = chart ? charts.find(chart) : -1;
+	if(chartIndex == charts.size()) return false;
+
+	int tempoIndex = -2;
+	if(tempo == mySimfile->tempo)
+	{
+		tempoIndex = -1;
+	}
+	else if(tempo)
+	{
+		for(tempoIndex = 0; tempoIndex < charts.size(); ++tempoIndex)
+		{
+			if(charts[tempoIndex]->tempo == tempo) break;
+		}
+		if(tempoIndex == charts.size()) return false;
+	}
+
+	out.writeNum(chartIndex + 1);
+	out.writeNum(tempoIndex + 2);
+	return true;
+}
+
+bool readJournalTargets(ReadStream& in, Chart*& chart, Tempo*& tempo) const
+{
+	auto& charts = mySimfile->charts;
+	int chartIndex = (int)in.readNum() - 1;
+	int tempoIndex = (int)in.readNum() - 2;
+	if(chartIndex >= charts.size() || tempoIndex >= charts.size()) return false;
+
+	chart = (chartIndex >= 0) ? charts[chartIndex] : nullptr;
+	tempo = (tempoIndex >= 0) ? charts[tempoIndex]->tempo : nullptr;
+	if(tempoIndex == -1) tempo = mySimfile->tempo;
+
+	return in.success() && (tempoIndex < 0 || tempo);
+}
+
+// Writes the targets, type and data of an entry that is applied with the given bindings.
+bool writeJournalData(WriteStream& out, const EntryData& entry, Bindings bound) const
+{
+	auto& callback = myCallbacks[entry.id];
+	if(!callback.journaled) return false;
+
+	Chart* chart = entry.chart ? entry.chart : bound.chart;
+	Tempo* tempo = entry.tempo ? entry.tempo : bound.tempo;
+	if(!writeJournalTargets(out, chart, tempo)) return false;
+
+	out.writeNum(entry.id);
+	if(callback.journal)
+	{
+		WriteStream data;
+		ReadStream in(entry.data, entry.size);
+		callback.journal(in, data);
+		out.writeNum(data.size());
+		out.write(data.data(), data.size());
+	}
+	else
+	{
+		out.writeNum(entry.size);
+		out.write(entry.data, entry.size);
+	}
+	return true;
+}
+
+// Writes an entry to the journal before it is applied. If the entry can not be written, the journal
+// is stopped, since the entries that follow can not be replayed without it.
+void writeJournalEntry(const EntryData& entry, Bindings bound, JournalRecord type)
+{
+	if(!openJournal()) return;
+
+	WriteStream out;
+	bool valid = true;
+	if(entry.id == 0)
+	{
+		Vector<const uchar*> entries;
+		ReadStream in(entry.data, entry.size);
+		ReadChain(in, entries);
+		String msg = in.readStr();
+
+		out.write<uchar>(JOURNAL_CHAIN);
+		out.writeNum(entries.size());
+		for(int i = 0; i < entries.size() && valid; ++i)
+		{
+			valid = writeJournalData(out, DecodeEntry(entries[i]), bound);
+		}
+		out.writeStr(msg);
+	}
+	else
+	{
+		out.write<uchar>(type);
+		valid = writeJournalData(out, entry, bound);
+	}
+
+	if(valid)
+	{
+		appendJournalRecord(out.data(), out.size());
+	}
+	else
+	{
+		writeJournalRecord(JOURNAL_STOP);
+		myJournalStopped = true;
+	}
+}
+
+void writeJournalRecord(JournalRecord type)
+{
+	if(!openJournal()) return;
+
+	uchar record = type;
+	appendJournalRecord(&record, 1);
+}
+
+// Reads an entry from the journal and adds it. Returns false if the entry is invalid.
+bool replayJournalEntry(ReadStream& in)
+{
+	Chart* chart = nullptr;
+	Tempo* tempo = nullptr;
+	bool valid = readJournalTargets(in, chart, tempo);
+
+	uint id = in.readNum();
+	uint size = in.readNum();
+	const uchar* data = in.pos();
+	in.skip(size);
+
+	if(!valid || !in.success() || id == 0 || id >= (uint)myCallbacks.size()) return false;
+
+	addEntry(id, data, size, chart, tempo);
+	return true;
+}
+
+// Replays the journal of the simfile, if the editor exited without saving or discarding the edits.
+void recoverJournal()
+{
+	Vector<uchar> buffer;
+	Vector<Journal::Record> records;
+	String path = getJournalPath();
+	if(!(Path(path).attributes() & File::ATR_EXISTS)) return;
+	if(!Journal::read(path, buffer, records)) return;
+
+	WriteStream start;
+	writeJournalStart(start);
+	if(records.empty() || records[0].size != (uint)start.size() ||
+		memcmp(records[0].data, start.data(), start.size()) != 0)
+	{
+		HudWarning("Ignored the edit journal of the simfile, the simfile was changed after it was written.");
+		File::deleteFile(path);
+		return;
+	}
+
+	// The recovered entries can target any chart, so all notes are loaded before they are replayed.
+	mySimfile->loadNotes();
+
+	// The recovered entries are written to a new journal while they are replayed.
+	myIsReplaying = true;
+
+	int numRecovered = 0;
+	bool complete = true;
+	for(int i = 1; i < records.size() && complete; ++i)
+	{
+		ReadStream in(records[i].data, records[i].size);
+		uchar type = in.read<uchar>();
+		switch(type)
+		{
+		case JOURNAL_ENTRY:
+		case JOURNAL_MERGE:
+			myReplayMerge = (type == JOURNAL_MERGE);
+			complete = replayJournalEntry(in);
+			myReplayMerge = false;
+			break;
+		case JOURNAL_CHAIN: {
+			uint numEntries = in.readNum();
+			startChain();
+			for(uint j = 0; j < numEntries && complete; ++j)
+			{
+				complete = replayJournalEntry(in);
+			}
+			finishChain(in.readStr());
+			break; }
+		case JOURNAL_UNDO:
+			complete = undoEntry();
+			break;
+		case JOURNAL_REDO:
+			complete = redoEntry();
+			break;
+		default:
+			complete = false;
+		};
+		if(complete) ++numRecovered;
+	}
+
+	myIsReplaying = false;
+
+	if(numRecovered > 0)
+	{
+		HudInfo("Recovered %i unsaved edits from the edit journal.", numRecovered);
+	}
+	if(!complete)
+	{
+		HudWarning("Some edits in the edit journal could not be recovered.");
 	}
 }
 
@@ -426,49 +1190,37 @@ void finishChain(String msg)
 
 void clearUnappliedEntries()
 {
-	int unappliedEntries = myTotalEntries - myAppliedEntries;
-	
-	myEntries.reverse();
-	auto it = myEntries.head;
-	for(int i = 0; i < unappliedEntries; ++i)
+	while(myTotalEntries > myAppliedEntries)
 	{
-		auto next = it->next;
-		ReleaseEntry(it, false);
-		it = next;
+		popLastEntry(false);
 	}
-	myEntries.head = it;
-	myEntries.reverse();
-
-	myTotalEntries = myAppliedEntries;
 	if(mySavedEntries > myAppliedEntries)
 	{
 		mySavedEntries = NO_SAVED_ENTRIES;
 	}
+	if(mySavingEntries > myAppliedEntries)
+	{
+		mySavingEntries = NO_SAVED_ENTRIES;
+	}
 }
 
 void clearEverything()
 {
-	int unappliedEntries = myTotalEntries - myAppliedEntries;
-	
-	myEntries.reverse();
-	auto it = myEntries.head;
-	for(int i = 0; i < unappliedEntries; ++i)
+	while(myTotalEntries > 0)
 	{
-		auto next = it->next;
-		ReleaseEntry(it, false);
-		it = next;
+		popLastEntry(myTotalEntries <= myAppliedEntries);
 	}
-	for(int i = 0; i < myAppliedEntries; ++i)
-	{
-		auto next = it->next;
-		ReleaseEntry(it, true);
-		it = next;
-	}
-	myEntries.head = nullptr;
+	myEntries.release();
+	myFirstEntry = 0;
+
+	myBaseChart = nullptr;
+	myBaseTempo = nullptr;
 
 	myAppliedEntries = 0;
 	mySavedEntries = 0;
 	myTotalEntries = 0;
+
+	myCanMergeEntry = false;
 }
 
 }; // HistoryImpl.
@@ -479,9 +1231,10 @@ void clearEverything()
 
 History* gHistory = nullptr;
 
-void History::create()
+void History::create(XmrNode& settings)
 {
 	gHistory = new HistoryImpl;
+	((HistoryImpl*)gHistory)->loadSettings(settings);
 }
 
 void History::destroy()
@@ -20,10 +20,27 @@ struct History : public InputHandler
 	typedef void (*ReleaseFunc)(ReadStream& in, bool hasBeenApplied);
 	typedef String(*ApplyFunc)(ReadStream& in, Bindings bound, bool undo, bool redo);
 
-	static void create();
+	/// Combines two successive entries into one entry that goes from the state before the first entry
+	/// to the state after the second entry. Returns false if the entries can not be combined.
+	typedef bool (*MergeFunc)(ReadStream& prev, ReadStream& next, WriteStream& out);
+
+	/// Converts the data of an entry to data that remains valid in another session of the editor.
+	typedef void (*JournalFunc)(ReadStream& in, WriteStream& out);
+
+	static void create(XmrNode& settings);
 	static void destroy();
 
-	virtual EditId addCallback(ApplyFunc apply, ReleaseFunc release = nullptr) = 0;
+	virtual void saveSettings(XmrNode& settings) = 0;
+
+	/// Registers an edit type. If a merge function is given, entries of the type that are added in
+	/// quick succession on the same target are combined into a single entry.
+	virtual EditId addCallback(ApplyFunc apply, ReleaseFunc release = nullptr,
+		MergeFunc merge = nullptr) = 0;
+
+	/// Allows entries of the given type to be written to the edit journal, from which unsaved edits
+	/// are recovered when the simfile is opened after a crash. The entry data is written as is, so it
+	/// must not contain pointers, unless a journal function is given that removes them.
+	virtual void enableJournal(EditId id, JournalFunc func = nullptr) = 0;
 
 	virtual void addEntry(EditId id, const void* data, uint size) = 0;
 	virtual void addEntry(EditId id, const void* data, uint size, Tempo* targetTempo) = 0;
@@ -34,9 +51,20 @@ struct History : public InputHandler
 	
 	virtual void onFileOpen(Simfile* simfile) = 0;
 	virtual void onFileClosed() = 0;
+
+	/// Called when a snapshot of the simfile is taken for saving.
+	virtual void onFileSaveStarted() = 0;
+
+	/// Called when the snapshot taken by onFileSaveStarted is written successfully.
 	virtual void onFileSaved() = 0;
 
 	virtual bool hasUnsavedChanges() const = 0;
+
+	/// Returns the number of bytes that are allocated for the history entries.
+	virtual size_t getMemoryUse() const = 0;
+
+	/// Returns the number of entries in the history, including entries that are undone.
+	virtual int getNumEntries() const = 0;
 };
 
 extern History* gHistory;
@@ -0,0 +1,179 @@
+#include <Editor/Journal.h>
+
+#include <Core/Utils.h>
+
+#include <System/File.h>
+#include <System/Thread.h>
+
+#include <string.h>
+#include <mutex>
+#include <condition_variable>
+
+namespace Vortex {
+namespace {
+
+static const char JournalMagic[4] = {'A', 'V', 'J', '1'};
+
+// FNV-1a hash, used to detect records that were only partially written.
+static uint Checksum(const uchar* data, uint size)
+{
+	uint hash = 2166136261u;
+	for(uint i = 0; i < size; ++i)
+	{
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+}; // anonymous namespace
+
+// ================================================================================================
+// Journal :: sync thread.
+
+// Stores the records on disk in the background, which protects them against power loss as well,
+// since waiting for the disk can take several milliseconds. The C runtime locks the file on every
+// call, so the main thread can keep appending records while the data is synced.
+struct Journal::SyncThread : public BackgroundThread
+{
+	FileWriter file;
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool pending;
+	bool stopping;
+
+	SyncThread() : pending(false), stopping(false) {}
+
+	~SyncThread() { stop(false); }
+
+	// Wakes up the thread to store the records that were appended.
+	void notify()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = true;
+		wakeup.notify_one();
+	}
+
+	// Stores the pending records, unless they are discarded, and waits until the thread is done.
+	void stop(bool discard)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(discard) pending = false;
+			stopping = true;
+			wakeup.notify_one();
+		}
+		terminate();
+	}
+
+	void exec()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true)
+		{
+			wakeup.wait(lock, [this] { return pending || stopping; });
+			if(!pending) break;
+
+			pending = false;
+			lock.unlock();
+			file.sync();
+			lock.lock();
+		}
+	}
+};
+
+// ================================================================================================
+// Journal :: implementation.
+
+Journal::Journal()
+	: mySync(nullptr)
+{
+}
+
+Journal::~Journal()
+{
+	close(false);
+}
+
+bool Journal::open(StringRef path)
+{
+	close(false);
+
+	mySync = new SyncThread;
+	if(!mySync->file.open(path))
+	{
+		delete mySync;
+		mySync = nullptr;
+		return false;
+	}
+	myPath = path;
+
+	mySync->file.write(JournalMagic, 1, sizeof(JournalMagic));
+	mySync->start();
+	mySync->notify();
+
+	return true;
+}
+
+void Journal::close(bool remove)
+{
+	if(mySync)
+	{
+		mySync->stop(remove);
+		mySync->file.close();
+		delete mySync;
+		mySync = nullptr;
+
+		if(remove) File::deleteFile(myPath);
+		myPath.clear();
+	}
+}
+
+bool Journal::isOpen() const
+{
+	return mySync != nullptr;
+}
+
+void Journal::append(const void* data, uint size)
+{
+	if(!mySync) return;
+
+	uint header[2] = {size, Checksum((const uchar*)data, size)};
+	mySync->file.write(header, sizeof(uint), 2);
+	mySync->file.write(data, 1, size);
+
+	// The record is passed to the operating system right away, so it survives a crash of the editor.
+	mySync->file.flush();
+	mySync->notify();
+}
+
+bool Journal::read(StringRef path, Vector<uchar>& buffer, Vector<Record>& records)
+{
+	records.clear();
+
+	FileReader file;
+	if(!file.open(path)) return false;
+
+	buffer.resize((int)file.size());
+	buffer.resize((int)file.read(buffer.data(), 1, buffer.size()));
+
+	if(buffer.size() < sizeof(JournalMagic) || memcmp(buffer.data(), JournalMagic, sizeof(JournalMagic)))
+	{
+		return true;
+	}
+
+	const uchar* pos = buffer.begin() + sizeof(JournalMagic), *end = buffer.end();
+	while(end - pos >= (int)sizeof(uint) * 2)
+	{
+		uint header[2];
+		memcpy(header, pos, sizeof(header));
+		pos += sizeof(header);
+		if(header[0] > (uint)(end - pos) || Checksum(pos, header[0]) != header[1]) break;
+
+		records.push_back({pos, header[0]});
+		pos += header[0];
+	}
+
+	return true;
+}
+
+}; // namespace Vortex
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Core/String.h>
+#include <Core/Vector.h>
+
+namespace Vortex {
+
+/// Append-only file of records, used to recover edits that were not saved. Records are written to
+/// the file immediately and stored on disk by a background thread, so appending a record is cheap.
+class Journal
+{
+public:
+	/// A record that was read from a journal file.
+	struct Record
+	{
+		const uchar* data;
+		uint size;
+	};
+
+	Journal();
+	~Journal();
+
+	/// Creates a new journal file, replacing the file if it already exists.
+	bool open(StringRef path);
+
+	/// Stores the pending records on disk and closes the file. If remove is true, the file is deleted.
+	void close(bool remove);
+
+	/// Returns true if a journal file is open.
+	bool isOpen() const;
+
+	/// Appends a record to the journal file.
+	void append(const void* data, uint size);
+
+	/// Reads the records of a journal file. Reading stops at the first record that is incomplete or
+	/// damaged, which is the case if the editor was terminated while writing it. The records point
+	/// into the buffer. Returns false if the file could not be opened.
+	static bool read(StringRef path, Vector<uchar>& buffer, Vector<Record>& records);
+
+private:
+	struct SyncThread;
+	SyncThread* mySync;
+	String myPath;
+};
+
+}; // namespace Vortex
@@ -0,0 +1,566 @@
+#include <Editor/Library.h>
+
+#include <Core/Utils.h>
+#include <Core/StringUtils.h>
+#include <Core/ByteStream.h>
+
+#include <System/File.h>
+#include <System/Thread.h>
+
+#include <Simfile/Parsing.h>
+
+#include <string.h>
+#include <algorithm>
+
+namespace Vortex {
+
+namespace Sm
+{
+	Difficulty ToDiff(const char* str); // Defined in LoadSm.cpp
+};
+
+namespace {
+
+static const char CachePath[] = "settings/library.cache";
+static const char CacheMagic[4] = {'A', 'V', 'L', '1'};
+
+// Loadable simfile extensions, from high priority to low priority.
+static const char* SimfileExts[] = {"ssc", "sm", "dwi", "osu"};
+static const int NumSimfileExts = 4;
+
+struct SongEntry
+{
+	Library::Song song;
+	ulong dirTime;
+	ulong fileTime;
+	String key;
+};
+
+struct Pack
+{
+	String dir;
+	Vector<SongEntry> songs;
+};
+
+static String FindSimfile(StringRef dir)
+{
+	String out;
+	int curPriority = NumSimfileExts;
+	for(auto& file : File::findFiles(dir, false))
+	{
+		String ext = file.ext();
+		Str::toLower(ext);
+		for(int i = 0; i < curPriority; ++i)
+		{
+			if(Str::equal(ext, SimfileExts[i]))
+			{
+				curPriority = i;
+				out = file.str;
+			}
+		}
+	}
+	return out;
+}
+
+static char* SkipSpace(char* p)
+{
+	while(*p == ' ' || *p == '\n') ++p;
+	return p;
+}
+
+// Splits the first parameters of a value "a:b:c:..." and trims the trailing whitespace.
+static int SplitParams(char* p, char** out, int maxParams)
+{
+	int n = 0;
+	for(; n < maxParams && *p; ++n)
+	{
+		out[n] = p = SkipSpace(p);
+		while(*p && *p != ':') ++p;
+		char* end = p;
+		while(end > out[n] && (end[-1] == ' ' || end[-1] == '\n')) --end;
+		if(*p == ':') ++p;
+		*end = 0;
+	}
+	return n;
+}
+
+static void ParseBpmRange(Library::Song& song, char* str)
+{
+	double bpm;
+	for(char* v[2]; ParseNextItem(str, v, 2);)
+	{
+		if(ParseVal(v[1], bpm) && bpm > 0)
+		{
+			if(song.minBpm == 0 || bpm < song.minBpm) song.minBpm = bpm;
+			if(bpm > song.maxBpm) song.maxBpm = bpm;
+		}
+	}
+}
+
+// Reads the header tags of an sm-style simfile. The note data is skipped by the tokenizer, only the
+// chart info that precedes it is read.
+static void ReadHeader(Library::Song& song)
+{
+	String buffer;
+	Vector<SimfileTag> tags;
+	if(!TokenizeSimfile(song.path, buffer, tags, true)) return;
+
+	Library::ChartInfo* chart = nullptr;
+	for(auto& it : tags)
+	{
+		const char* tag = it.tag;
+		if(Str::iequal(tag, "TITLE"))
+		{
+			song.title = it.val;
+		}
+		else if(Str::iequal(tag, "SUBTITLE"))
+		{
+			song.subtitle = it.val;
+		}
+		else if(Str::iequal(tag, "ARTIST"))
+		{
+			song.artist = it.val;
+		}
+		else if(Str::iequal(tag, "BPMS"))
+		{
+			// Charts with split timing can have their own tempo, only the song tempo is used.
+			if(!chart) ParseBpmRange(song, it.val);
+		}
+		else if(Str::iequal(tag, "BPM"))
+		{
+			// Dwi files store the initial tempo separately from the tempo changes.
+			double bpm;
+			if(ParseVal(it.val, bpm) && bpm > 0)
+			{
+				song.minBpm = (song.minBpm == 0) ? bpm : min(song.minBpm, bpm);
+				song.maxBpm = max(song.maxBpm, bpm);
+			}
+		}
+		else if(Str::iequal(tag, "NOTES"))
+		{
+			// Stepmania 3.95/ITG notes format, the chart info precedes the notes.
+			char* params[4];
+			if(SplitParams(it.val, params, 4) == 4)
+			{
+				song.charts.push_back({params[0], Sm::ToDiff(params[2]), atoi(params[3])});
+			}
+			chart = nullptr;
+		}
+		else if(Str::iequal(tag, "NOTEDATA"))
+		{
+			// Stepmania 5 notes format, the chart info is stored in separate tags.
+			chart = &song.charts.append();
+			chart->difficulty = DIFF_EDIT;
+			chart->meter = 1;
+		}
+		else if(chart && Str::iequal(tag, "STEPSTYPE"))
+		{
+			chart->style = it.val;
+		}
+		else if(chart && Str::iequal(tag, "DIFFICULTY"))
+		{
+			chart->difficulty = Sm::ToDiff(it.val);
+		}
+		else if(chart && Str::iequal(tag, "METER"))
+		{
+			ParseVal(it.val, chart->meter);
+		}
+	}
+}
+
+static void ReadSong(SongEntry& entry)
+{
+	auto& song = entry.song;
+	song.path = FindSimfile(song.dir);
+	song.title.clear();
+	song.subtitle.clear();
+	song.artist.clear();
+	song.minBpm = song.maxBpm = 0;
+	song.charts.clear();
+
+	entry.fileTime = 0;
+	if(song.path.len())
+	{
+		entry.fileTime = File::getModifiedTime(song.path);
+
+		// Only sm-style files are indexed, other formats are listed by directory name.
+		Path path(song.path);
+		if(!path.hasExt("osu")) ReadHeader(song);
+	}
+	if(song.title.empty())
+	{
+		song.title = Path(song.dir).top();
+	}
+
+	// The search key contains all searchable text in lowercase.
+	entry.key = song.title;
+	entry.key += ' ';
+	entry.key += song.subtitle;
+	entry.key += ' ';
+	entry.key += song.artist;
+	entry.key += ' ';
+	entry.key += Path(song.dir).top();
+	Str::toLower(entry.key);
+}
+
+struct ReadSongThreads : public ParallelThreads
+{
+	Vector<SongEntry*> entries;
+
+	void exec(int item, int thread) override
+	{
+		ReadSong(*entries[item]);
+	}
+};
+
+static bool MatchesQuery(const SongEntry& entry, const Vector<String>& words)
+{
+	for(auto& word : words)
+	{
+		if(Str::find(entry.key, word.str()) == String::npos) return false;
+	}
+	return true;
+}
+
+}; // anonymous namespace
+
+// ================================================================================================
+// LibraryImpl :: member data.
+
+struct LibraryImpl : public Library {
+
+struct ScanThread : public BackgroundThread
+{
+	LibraryImpl* library;
+
+	ScanThread(LibraryImpl* lib) : library(lib) {}
+
+	~ScanThread() { terminate(); }
+
+	void exec() override
+	{
+		library->scanQueue(terminationFlag_);
+	}
+};
+
+mutable CriticalSection myLock;
+
+// Shared between the main thread and the scan thread, guarded by myLock.
+Vector<Pack*> myPacks;
+Vector<String> myQueue;
+Vector<String> myScannedPacks;
+bool myIsScanning;
+int myRevision;
+
+ScanThread* myThread;
+
+// ================================================================================================
+// LibraryImpl :: constructor and destructor.
+
+~LibraryImpl()
+{
+	delete myThread;
+	for(auto pack : myPacks) delete pack;
+}
+
+LibraryImpl()
+	: myIsScanning(false)
+	, myRevision(0)
+	, myThread(nullptr)
+{
+	loadCache();
+}
+
+// ================================================================================================
+// LibraryImpl :: cache file.
+
+void loadCache()
+{
+	bool success;
+	String data = File::getText(CachePath, &success);
+	if(!success || data.len() < (int)sizeof(CacheMagic)) return;
+	if(memcmp(data.str(), CacheMagic, sizeof(CacheMagic))) return;
+
+	ReadStream in(data.str() + sizeof(CacheMagic), data.len() - sizeof(CacheMagic));
+	uint numPacks = in.readNum();
+	for(uint p = 0; p < numPacks && in.success(); ++p)
+	{
+		auto pack = new Pack;
+		myPacks.push_back(pack);
+		in.readStr(pack->dir);
+		uint numSongs = in.readNum();
+		for(uint s = 0; s < numSongs && in.success(); ++s)
+		{
+			auto& entry = pack->songs.append();
+			auto& song = entry.song;
+			in.readStr(song.dir);
+			in.readStr(song.path);
+			in.readStr(song.title);
+			in.readStr(song.subtitle);
+			in.readStr(song.artist);
+			in.read(song.minBpm);
+			in.read(song.maxBpm);
+			uint numCharts = in.readNum();
+			for(uint c = 0; c < numCharts && in.success(); ++c)
+			{
+				auto& chart = song.charts.append();
+				in.readStr(chart.style);
+				chart.difficulty = (Difficulty)min(in.readNum(), (uint)DIFF_EDIT);
+				chart.meter = in.readNum();
+			}
+			in.read(entry.dirTime);
+			in.read(entry.fileTime);
+			in.readStr(entry.key);
+		}
+	}
+
+	// A damaged cache is discarded, the packs are indexed again when they are opened.
+	if(!in.success())
+	{
+		for(auto pack : myPacks) delete pack;
+		myPacks.clear();
+	}
+}
+
+void saveCache()
+{
+	WriteStream out;
+	out.write(CacheMagic, sizeof(CacheMagic));
+
+	myLock.lock();
+	out.writeNum(myPacks.size());
+	for(auto pack : myPacks)
+	{
+		out.writeStr(pack->dir);
+		out.writeNum(pack->songs.size());
+		for(auto& entry : pack->songs)
+		{
+			auto& song = entry.song;
+			out.writeStr(song.dir);
+			out.writeStr(song.path);
+			out.writeStr(song.title);
+			out.writeStr(song.subtitle);
+			out.writeStr(song.artist);
+			out.write(song.minBpm);
+			out.write(song.maxBpm);
+			out.writeNum(song.charts.size());
+			for(auto& chart : song.charts)
+			{
+				out.writeStr(chart.style);
+				out.writeNum(chart.difficulty);
+				out.writeNum(chart.meter);
+			}
+			out.write(entry.dirTime);
+			out.write(entry.fileTime);
+			out.writeStr(entry.key);
+		}
+	}
+	myLock.unlock();
+
+	// Write to a temporary file first, so an interrupted write does not corrupt the cache.
+	String tempPath = String(CachePath) + ".tmp";
+	FileWriter file;
+	if(!out.success() || !file.open(tempPath)) return;
+	bool written = (file.write(out.data(), 1, out.size()) == out.size()) && file.sync();
+	file.close();
+	if(written)
+	{
+		File::moveFile(tempPath, CachePath, true);
+	}
+	else
+	{
+		File::deleteFile(tempPath);
+	}
+}
+
+// ================================================================================================
+// LibraryImpl :: scanning.
+
+void scanPack(StringRef packDir)
+{
+	myLock.lock();
+	bool isNew = (myScannedPacks.find(packDir) == myScannedPacks.size());
+	if(isNew)
+	{
+		myScannedPacks.push_back(packDir);
+		myQueue.push_back(packDir);
+	}
+	bool startThread = isNew && !myIsScanning;
+	if(startThread) myIsScanning = true;
+	myLock.unlock();
+
+	// A background thread can only run once, so a new one is started for each batch of packs.
+	if(startThread)
+	{
+		delete myThread;
+		myThread = new ScanThread(this);
+		myThread->start();
+	}
+}
+
+void scanQueue(const uchar& terminationFlag)
+{
+	while(!terminationFlag)
+	{
+		myLock.lock();
+		if(myQueue.empty())
+		{
+			myIsScanning = false;
+			myLock.unlock();
+			break;
+		}
+		String packDir = myQueue[0];
+		myQueue.erase(0);
+		myLock.unlock();
+
+		updatePack(packDir);
+	}
+	saveCache();
+}
+
+void updatePack(StringRef packDir)
+{
+	auto dirs = File::findDirs(packDir, false);
+
+	Pack* pack = new Pack;
+	pack->dir = packDir;
+	pack->songs.resize(dirs.size());
+	for(int i = 0; i < dirs.size(); ++i)
+	{
+		auto& entry = pack->songs[i];
+		entry.song.dir = dirs[i].str;
+		entry.dirTime = File::getModifiedTime(entry.song.dir);
+		entry.fileTime = 0;
+	}
+
+	// Songs of which neither the directory nor the simfile was modified are copied from the index.
+	// The packs are only replaced by the scan thread, so the previous pack can be read unlocked.
+	ReadSongThreads threads;
+	myLock.lock();
+	const Pack* prev = findPack(packDir);
+	myLock.unlock();
+	for(auto& entry : pack->songs)
+	{
+		bool upToDate = false;
+		if(prev)
+		{
+			for(auto& old : prev->songs)
+			{
+				if(old.song.dir == entry.song.dir)
+				{
+					upToDate = (old.dirTime == entry.dirTime) &&
+						(old.fileTime == File::getModifiedTime(old.song.path));
+					if(upToDate) entry = old;
+					break;
+				}
+			}
+		}
+		if(!upToDate) threads.entries.push_back(&entry);
+	}
+	threads.run(threads.entries.size());
+
+	// Songs without a simfile are not listed.
+	for(int i = pack->songs.size() - 1; i >= 0; --i)
+	{
+		if(pack->songs[i].song.path.empty()) pack->songs.erase(i);
+	}
+
+	myLock.lock();
+	int index = myPacks.find((Pack*)prev);
+	if(index < myPacks.size())
+	{
+		delete myPacks[index];
+		myPacks[index] = pack;
+	}
+	else
+	{
+		myPacks.push_back(pack);
+	}
+	++myRevision;
+	myLock.unlock();
+}
+
+bool isScanning() const
+{
+	myLock.lock();
+	bool result = myIsScanning;
+	myLock.unlock();
+	return result;
+}
+
+// ================================================================================================
+// LibraryImpl :: song lists.
+
+// Must be called with myLock held.
+const Pack* findPack(StringRef packDir) const
+{
+	for(auto pack : myPacks)
+	{
+		if(pack->dir == packDir) return pack;
+	}
+	return nullptr;
+}
+
+Vector<Song> getPack(StringRef packDir) const
+{
+	Vector<Song> out;
+	myLock.lock();
+	if(auto pack = findPack(packDir))
+	{
+		out.reserve(pack->songs.size());
+		for(auto& entry : pack->songs)
+		{
+			out.push_back(entry.song);
+		}
+	}
+	myLock.unlock();
+	return out;
+}
+
+Vector<Song> search(StringRef query, int maxResults) const
+{
+	String lowerQuery = query;
+	Str::toLower(lowerQuery);
+	auto words = Str::split(lowerQuery);
+
+	Vector<Song> out;
+	myLock.lock();
+	for(auto pack : myPacks)
+	{
+		for(auto& entry : pack->songs)
+		{
+			if(out.size() == maxResults) break;
+			if(MatchesQuery(entry, words)) out.push_back(entry.song);
+		}
+	}
+	myLock.unlock();
+	return out;
+}
+
+int getRevision() const
+{
+	myLock.lock();
+	int result = myRevision;
+	myLock.unlock();
+	return result;
+}
+
+}; // LibraryImpl
+
+// ================================================================================================
+// Library API.
+
+Library* gLibrary = nullptr;
+
+void Library::create()
+{
+	gLibrary = new LibraryImpl;
+}
+
+void Library::destroy()
+{
+	delete (LibraryImpl*)gLibrary;
+	gLibrary = nullptr;
+}
+
+}; // namespace Vortex
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Core/Vector.h>
+#include <Core/String.h>
+
+#include <Simfile/Common.h>
+
+namespace Vortex {
+
+/// Index of the songs in the packs of the simfiles that have been opened. Packs are scanned on a
+/// background thread, and only the header tags of each simfile are read. The index is stored in a
+/// cache file, and a song is only read again if its directory or simfile was modified.
+struct Library
+{
+	struct ChartInfo
+	{
+		String style;
+		Difficulty difficulty;
+		int meter;
+	};
+
+	struct Song
+	{
+		String dir;   ///< Song directory, without a trailing slash.
+		String path;  ///< Path of the simfile, empty if the directory does not contain one.
+		String title;
+		String subtitle;
+		String artist;
+		double minBpm;
+		double maxBpm;
+		Vector<ChartInfo> charts;
+	};
+
+	static void create();
+	static void destroy();
+
+	/// Starts scanning the given pack directory in the background. Packs that have been scanned
+	/// during this session are skipped.
+	virtual void scanPack(StringRef packDir) = 0;
+
+	/// Returns true if a pack is being scanned.
+	virtual bool isScanning() const = 0;
+
+	/// Returns the songs of a pack in directory order, or an empty list if the pack is not indexed.
+	virtual Vector<Song> getPack(StringRef packDir) const = 0;
+
+	/// Returns the indexed songs that contain every word of the query in their title, subtitle,
+	/// artist or directory name, ignoring case.
+	virtual Vector<Song> search(StringRef query, int maxResults) const = 0;
+
+	/// Returns a number that changes whenever songs are added to the index or updated.
+	virtual int getRevision() const = 0;
+};
+
+extern Library* gLibrary;
+
+}; // namespace Vortex
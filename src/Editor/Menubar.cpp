@@ -117,6 +117,8 @@ void init(Item* menu)
 	add(hFile, 0 /*dummy*/, "Recent files");
 	add(hFile, FILE_CLOSE, "Close");
 	sep(hFile);
+	add(hFile, OPEN_DIALOG_SONG_LIST, "Song list...");
+	sep(hFile);
 	add(hFile, FILE_SAVE, "Save");
 	add(hFile, FILE_SAVE_AS, "Save as...");
 	sep(hFile);
@@ -355,6 +357,7 @@ void init(Item* menu)
 	add(myStatusMenu, TOGGLE_STATUS_MEASURE, "Show measure");
 	add(myStatusMenu, TOGGLE_STATUS_TIME, "Show time");
 	add(myStatusMenu, TOGGLE_STATUS_TIMING_MODE, "Show timing mode");
+	add(myStatusMenu, TOGGLE_STATUS_HISTORY, "Show history size");
 
 	// View menu.
 	myViewMenu = newMenu();
@@ -548,6 +551,10 @@ void registerUpdateFunctions()
 	{
 		MENU->myStatusMenu->setChecked(TOGGLE_STATUS_TIMING_MODE, gStatusbar->hasTimingMode());
 	};
+	myUpdateFunctions[STATUSBAR_HISTORY] = []
+	{
+		MENU->myStatusMenu->setChecked(TOGGLE_STATUS_HISTORY, gStatusbar->hasHistory());
+	};
 }
 
 void update(Property prop)
@@ -44,6 +44,7 @@ struct Menubar
 	STATUSBAR_MEASURE,
 	STATUSBAR_TIME,
 	STATUSBAR_TIMING_MODE,
+	STATUSBAR_HISTORY,
 
 	NUM_PROPERTIES
 	
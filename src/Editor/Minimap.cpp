@@ -129,7 +129,7 @@ void renderNotes(SetPixelData& spd, const int* colx)
 {
 	if(gView->isTimeBased())
 	{
-		for(auto& note : *gNotes)
+		for(auto note : *gNotes)
 		{
 			int rowtype = ToRowType(note.row);
 			if(note.endrow > note.row)
@@ -151,7 +151,7 @@ void renderNotes(SetPixelData& spd, const int* colx)
 	}
 	else
 	{
-		for(auto& note : *gNotes)
+		for(auto note : *gNotes)
 		{
 			int rowtype = ToRowType(note.row);
 			if(note.endrow > note.row)
@@ -19,6 +19,7 @@
 #include <Simfile/TimingData.h>
 
 #include <Editor/ConvertToOgg.h>
+#include <Editor/FindOnsets.h>
 #include <Editor/Editor.h>
 #include <Editor/Common.h>
 #include <Editor/TextOverlay.h>
@@ -42,6 +43,18 @@ static const int MIX_CHANNELS = 2;
 
 enum LoadState { LOADING_ALLOCATING_AND_READING, LOADING_ALLOCATED_AND_READING, LOADING_DONE };
 
+struct OnsetAnalysisThread : public BackgroundThread
+{
+	const Sound* sound;
+	OnsetCache cache;
+	bool success;
+	void exec() override
+	{
+		success = FindOnsets(sound->samplesL(), sound->samplesR(), sound->getFrequency(),
+			sound->getNumFrames(), &terminationFlag_, cache);
+	}
+};
+
 // ================================================================================================
 // MusicImpl :: member data.
 
@@ -64,6 +77,10 @@ Reference<InfoBoxWithProgress> myInfoBox;
 Vector<short> myMixBuffer;
 
 OggConversionThread* myOggConversionThread;
+OnsetAnalysisThread* myOnsetThread;
+OnsetCache myOnsets;
+bool myHasOnsets;
+bool myHasPendingOnsets;
 
 // ================================================================================================
 // MusicImpl :: constructor and destructor.
@@ -91,6 +108,9 @@ MusicImpl()
 	myNoteTick.enabled = false;
 
 	myOggConversionThread = nullptr;
+	myOnsetThread = nullptr;
+	myHasOnsets = false;
+	myHasPendingOnsets = false;
 
 	bool success;
 
@@ -128,6 +148,7 @@ void saveSettings(XmrNode& settings)
 void unload()
 {
 	terminateOggConversion();
+	terminateOnsetAnalysis();
 
 	myMixer->close();
 
@@ -426,6 +447,80 @@ void finishOggConversion()
 	}
 }
 
+// ================================================================================================
+// MusicImpl :: onset analysis.
+
+void startOnsetAnalysis()
+{
+	terminateOnsetAnalysis();
+
+	if(mySamples.getNumFrames() > 0)
+	{
+		// Without multithreading, the analysis is postponed until the onsets are first requested,
+		// so loading the music does not block the editor for the length of the analysis.
+		if(gEditor->hasMultithreading())
+		{
+			myOnsetThread = new OnsetAnalysisThread;
+			myOnsetThread->sound = &mySamples;
+			myOnsetThread->success = false;
+			myOnsetThread->start();
+		}
+		else
+		{
+			myHasPendingOnsets = true;
+		}
+	}
+}
+
+void terminateOnsetAnalysis()
+{
+	if(myOnsetThread)
+	{
+		myOnsetThread->terminate();
+		delete myOnsetThread;
+		myOnsetThread = nullptr;
+	}
+	myOnsets.onsets.release();
+	myOnsets.novelty.release();
+	myOnsets.amplitude.release();
+	myHasOnsets = false;
+	myHasPendingOnsets = false;
+}
+
+void finishOnsetAnalysis()
+{
+	if(myOnsetThread)
+	{
+		if(myOnsetThread->success)
+		{
+			OnsetCache& cache = myOnsetThread->cache;
+			myOnsets.onsets.swap(cache.onsets);
+			myOnsets.novelty.swap(cache.novelty);
+			myOnsets.amplitude.swap(cache.amplitude);
+			myOnsets.samplerate = cache.samplerate;
+			myOnsets.hopSize = cache.hopSize;
+			myOnsets.blockSize = cache.blockSize;
+			myHasOnsets = true;
+		}
+		delete myOnsetThread;
+		myOnsetThread = nullptr;
+	}
+}
+
+const OnsetCache* getOnsets()
+{
+	if(myHasPendingOnsets)
+	{
+		myHasPendingOnsets = false;
+		myOnsetThread = new OnsetAnalysisThread;
+		myOnsetThread->sound = &mySamples;
+		myOnsetThread->success = false;
+		myOnsetThread->exec();
+		finishOnsetAnalysis();
+	}
+	return myHasOnsets ? &myOnsets : nullptr;
+}
+
 // ================================================================================================
 // MusicImpl :: general API.
 
@@ -476,10 +571,16 @@ void tick()
 		{
 			myInfoBox.destroy();
 			myLoadState = LOADING_DONE;
+			startOnsetAnalysis();
 			gEditor->reportChanges(VCM_MUSIC_IS_LOADED);
 		}
 	}
 
+	if(myOnsetThread && myOnsetThread->isDone())
+	{
+		finishOnsetAnalysis();
+	}
+
 	if(myOggConversionThread)
 	{
 		if(myInfoBox)
@@ -642,12 +743,19 @@ void updateBeatTicks()
 	double freq = (double)mySamples.getFrequency();
 	double ofs = myTickOffsetMs / 1000.0;
 
-	TempoTimeTracker tracker(gTempo->getTimingData());
+	Vector<int> rows;
 	for(int row = 0, end = gSimfile->getEndRow(); row < end; row += ROWS_PER_BEAT)
 	{
-		double time = tracker.advance(row);
-		int frame = (int)((time + ofs) * freq);
-		myBeatTick.frames.push_back(frame);
+		rows.push_back(row);
+	}
+	Vector<double> times;
+	times.resize(rows.size());
+	gTempo->getTimingData().rowsToTimes(rows.data(), times.data(), rows.size(), true);
+
+	myBeatTick.frames.resize(times.size());
+	for(int i = 0; i < times.size(); ++i)
+	{
+		myBeatTick.frames[i] = (int)((times[i] + ofs) * freq);
 	}
 }
 
@@ -658,7 +766,7 @@ void updateNoteTicks()
 	double freq = (double)mySamples.getFrequency();
 	double ofs = myTickOffsetMs / 1000.0;
 
-	for(auto& note : *gNotes)
+	for(auto note : *gNotes)
 	{
 		if(!(note.isMine | note.isWarped | (note.type == NOTE_FAKE)))
 		{
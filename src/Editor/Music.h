@@ -4,6 +4,8 @@
 
 namespace Vortex {
 
+struct OnsetCache;
+
 struct Music
 {
 	static void create(XmrNode& settings);
@@ -77,6 +79,11 @@ struct Music
 
 	/// Returns the audio samples of the current music.
 	virtual const Sound& getSamples() = 0;
+
+	/// Returns the onset analysis of the current music, which is computed in the background after
+	/// the music has finished loading. Without multithreading, it is computed by the first call.
+	/// Returns null if the analysis is not available (yet).
+	virtual const OnsetCache* getOnsets() = 0;
 };
 
 extern Music* gMusic;
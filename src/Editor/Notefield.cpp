@@ -2,6 +2,7 @@
 
 #include <math.h>
 #include <stdint.h>
+#include <algorithm>
 
 #include <Core/Draw.h>
 #include <Core/Gui.h>
@@ -107,6 +108,30 @@ struct DrawPosHelper
 	GetFunc getFunc;
 };
 
+// Finds the notes that can be visible between the given y-positions. The y-positions of the notes
+// only move in one direction, so the notes on screen are found with a binary search. Holds that
+// start above the screen are included, up to the length of the longest hold.
+static void GetVisibleNotes(const DrawPosHelper& drawPos, int minY, int maxY,
+	ExpandedNotePtr& outBegin, ExpandedNotePtr& outEnd)
+{
+	int dir = (drawPos.deltaY < 0) ? -1 : 1;
+	int first = (dir > 0) ? minY : -maxY, last = (dir > 0) ? maxY : -minY;
+	auto begin = gNotes->begin(), end = gNotes->end();
+
+	outBegin = std::lower_bound(begin, end, first, [&](ConstExpandedNoteRef n, int y)
+	{
+		return drawPos.get(n.row, n.time) * dir < y;
+	});
+	outEnd = std::upper_bound(outBegin, end, last, [&](int y, ConstExpandedNoteRef n)
+	{
+		return y < drawPos.get(n.row, n.time) * dir;
+	});
+	if(outBegin != begin)
+	{
+		outBegin = min(outBegin, gNotes->getFirstNoteReachingRow((outBegin - 1)->row + 1));
+	}
+}
+
 }; // anonymous namespace
 
 // ================================================================================================
@@ -630,8 +655,12 @@ void drawNotes()
 	bool hasLabels = false;	
 	auto batch = Renderer::batchT();
 	DrawPosHelper drawPos;
-	for(auto& note : *gNotes)
+	ExpandedNotePtr visibleBegin, visibleEnd;
+	GetVisibleNotes(drawPos, -32, maxY, visibleBegin, visibleEnd);
+	for(auto it = visibleBegin; it != visibleEnd; ++it)
 	{
+		auto note = *it;
+
 		// Determine the y-position of the note.
 		int y = drawPos.get(note.row, note.time), by;
 		if(note.row == note.endrow)
@@ -707,8 +736,9 @@ void drawNotes()
 	// Draw indicator sprites for fake notes and lift notes.
 	Renderer::bindTexture(myNoteLabelsTex.handle());
 	batch = Renderer::batchT();
-	for(auto& note : *gNotes)
+	for(auto it = visibleBegin; it != visibleEnd; ++it)
 	{
+		auto note = *it;
 		if(note.type == NOTE_LIFT || note.type == NOTE_FAKE)
 		{
 			int y = drawPos.get(note.row, note.time);
@@ -723,8 +753,9 @@ void drawNotes()
 	Renderer::bindTexture(mySelectionTex.handle());
 	batch = Renderer::batchT();
 	BatchSprite select(mySelectionTex.size().x, mySelectionTex.size().y);
-	for(auto& note : *gNotes)
+	for(auto it = visibleBegin; it != visibleEnd; ++it)
 	{
+		auto note = *it;
 		if(note.isSelected)
 		{
 			int y = drawPos.get(note.row, note.time);
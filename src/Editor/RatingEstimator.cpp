@@ -45,7 +45,7 @@ static Vector<double> CalcDensities()
 {
 	Vector<double> stamps, out;
 	TempoTimeTracker tracker(gTempo->getTimingData());
-	for(auto& n : *gNotes)
+	for(auto n : *gNotes)
 	{
 		if(!(n.isMine | n.isWarped))
 		{
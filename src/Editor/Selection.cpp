@@ -1,5 +1,7 @@
 #include <Editor/Selection.h>
 
+#include <math.h>
+
 #include <Core/Utils.h>
 #include <Core/StringUtils.h>
 #include <Core/Draw.h>
@@ -160,13 +162,21 @@ bool selectNotes(SelectModifier mod, double torT, double torB, int xl, int xr)
 	if(xl == xr && torT == torB)
 	{
 		double clickY = gView->offsetToY(torT);
-		const ExpandedNote* closest = nullptr;
+		ExpandedNotePtr closest;
 		int mindist = gView->applyZoom(32);
+
+		// Only the notes within the maximum distance of the click are tested.
+		double range = mindist / fabs(gView->getPixPerOfs());
+		auto it = timeBased
+			? gNotes->getFirstNoteFromTime(torT - range)
+			: gNotes->getFirstNoteFromRow((int)floor(torT - range));
 		mindist *= mindist;
 
-		for(auto& note : *gNotes)
+		for(auto end = gNotes->end(); it != end; ++it)
 		{
+			auto note = *it;
 			double tor = timeBased ? note.time : (double)note.row;
+			if(tor > torT + range) break;
 			int dx = xl - gView->columnToX(note.col);
 			int dy = (int)(clickY - gView->offsetToY(tor));
 			if(abs(dy) < mindist)
@@ -175,13 +185,13 @@ bool selectNotes(SelectModifier mod, double torT, double torB, int xl, int xr)
 				if(sqrdist < mindist)
 				{
 					mindist = sqrdist;
-					closest = &note;
+					closest = it;
 				}
 			}
 		}
 		if(closest)
 		{
-			selectNotes(mod, Vector<RowCol>(1, {closest->row, closest->col}));
+			selectNotes(mod, Vector<RowCol>(1, {closest->row, (int)closest->col}));
 			return true;
 		}
 		else
@@ -387,15 +397,11 @@ int getSelectedNotes(NoteList& out)
 {
 	if(myRegion.beginRow == myRegion.endRow)
 	{
-		for(auto& note : *gNotes)
-		{
-			if(note.isSelected) out.append(CompressNote(note));
-		}
+		gNotes->getSelectedNotes(out);
 	}
 	else
 	{
-		auto note = gNotes->begin(), end = gNotes->end();
-		for(; note != end && note->row < myRegion.beginRow; ++note);
+		auto note = gNotes->getFirstNoteFromRow(myRegion.beginRow), end = gNotes->end();
 		for(; note != end && note->row <= myRegion.endRow; ++note)
 		{
 			out.append(CompressNote(*note));
@@ -197,6 +197,7 @@ E(OPEN_DIALOG_TEMPO_BREAKDOWN)
 E(OPEN_DIALOG_WAVEFORM_SETTINGS)
 E(OPEN_DIALOG_CUSTOM_SNAP)
 E(OPEN_DIALOG_ZOOM)
+E(OPEN_DIALOG_SONG_LIST)
 
 E(TOGGLE_JUMP_TO_NEXT_NOTE)
 E(TOGGLE_UNDO_REDO_JUMP)
@@ -342,6 +343,7 @@ E(TOGGLE_STATUS_BEAT)
 E(TOGGLE_STATUS_MEASURE)
 E(TOGGLE_STATUS_TIME)
 E(TOGGLE_STATUS_TIMING_MODE)
+E(TOGGLE_STATUS_HISTORY)
 
 E(SHOW_SHORTCUTS)
 E(SHOW_MESSAGE_LOG)
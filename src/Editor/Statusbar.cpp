@@ -14,6 +14,7 @@
 #include <Editor/Editor.h>
 #include <Editor/Common.h>
 #include <Editor/View.h>
+#include <Editor/History.h>
 
 #include <Managers/MetadataMan.h>
 #include <Managers/SimfileMan.h>
@@ -35,6 +36,7 @@ bool myShowBeat;
 bool myShowMeasure;
 bool myShowTime;
 bool myShowTimingMode;
+bool myShowHistory;
 
 // ================================================================================================
 // StatusbarImpl :: constructor / destructor.
@@ -53,6 +55,7 @@ StatusbarImpl()
 	myShowMeasure = true;
 	myShowTime = true;
 	myShowTimingMode = true;
+	myShowHistory = false;
 }
 
 // ================================================================================================
@@ -71,6 +74,7 @@ void loadSettings(XmrNode& settings)
 		statusbar->get("showMeasure", &myShowMeasure);
 		statusbar->get("showTime", &myShowTime);
 		statusbar->get("showTimingMode", &myShowTimingMode);
+		statusbar->get("showHistory", &myShowHistory);
 	}
 }
 
@@ -86,6 +90,7 @@ void saveSettings(XmrNode& settings)
 	statusbar->addAttrib("showMeasure", myShowMeasure);
 	statusbar->addAttrib("showTime", myShowTime);
 	statusbar->addAttrib("showTimingMode", myShowTimingMode);
+	statusbar->addAttrib("showHistory", myShowHistory);
 }
 
 // ================================================================================================
@@ -153,6 +158,13 @@ void draw()
 		}
 	}
 
+	if(myShowHistory)
+	{
+		double megabytes = gHistory->getMemoryUse() / (1024.0 * 1024.0);
+		int entries = gHistory->getNumEntries();
+		info.push_back(Str::fmt("{tc:888}History:{tc} %1 MB, %2 edits").arg(megabytes, 1, 1).arg(entries));
+	}
+
 	if(info.size())
 	{
 		String str = Str::join(info, " ");
@@ -220,6 +232,12 @@ void StatusbarImpl::toggleTimingMode()
 	gMenubar->update(Menubar::STATUSBAR_TIMING_MODE);
 }
 
+void StatusbarImpl::toggleHistory()
+{
+	myShowHistory = !myShowHistory;
+	gMenubar->update(Menubar::STATUSBAR_HISTORY);
+}
+
 
 bool StatusbarImpl::hasChart()
 {
@@ -261,6 +279,11 @@ bool StatusbarImpl::hasTimingMode()
 	return myShowTimingMode;
 }
 
+bool StatusbarImpl::hasHistory()
+{
+	return myShowHistory;
+}
+
 }; // StatusbarImpl
 
 // ================================================================================================
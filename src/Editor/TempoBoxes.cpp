@@ -288,7 +288,7 @@ int selectTime(SelectModifier mod, double begin, double end, int xl, int xr)
 {
 	auto coords = gView->getNotefieldCoords();
 	const int baseX[2] = {coords.xl, coords.xr};
-	TempoTimeTracker tracker;
+	TempoTimeTracker tracker(gTempo->getTimingData());
 	return performSelection(mod, [&](const TempoBox* box)
 	{
 		int side = Segment::meta[box->type]->side;
@@ -320,7 +320,7 @@ void tick()
 		double oy = gView->offsetToY(0.0);
 		double dy = gView->getPixPerOfs();
 
-		TempoTimeTracker tracker;
+		TempoTimeTracker tracker(gTempo->getTimingData());
 		auto coords = gView->getNotefieldCoords();
 		const int baseX[2] = {coords.xl, coords.xr};
 		vec2i mpos = gSystem->getMousePos();
@@ -361,7 +361,7 @@ void draw()
 
 	// First pass, draw the box sprites.
 	int previousRow = 0;	
-	TempoTimeTracker tracker;
+	TempoTimeTracker tracker(gTempo->getTimingData());
 	auto batch = Renderer::batchTC();
 	for(const TempoBox& box : myBoxes)
 	{
@@ -383,7 +383,7 @@ void draw()
 	batch.flush();
 
 	// Second pass, draw the text labels.
-	tracker = TempoTimeTracker();
+	tracker = TempoTimeTracker(gTempo->getTimingData());
 	TextStyle textStyle;
 	for(const TempoBox& box : myBoxes)
 	{
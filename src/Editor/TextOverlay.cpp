@@ -11,6 +11,7 @@
 #include <System/Debug.h>
 #include <System/System.h>
 #include <System/File.h>
+#include <System/Thread.h>
 
 #include <Editor/Common.h>
 #include <Editor/Shortcuts.h>
@@ -24,6 +25,8 @@ namespace {
 
 struct HudEntry { String text; TextOverlay::MessageType type; float timeLeft; };
 
+struct PendingMessage { String text; TextOverlay::MessageType type; };
+
 struct ProgressMessage { int id; String text; };
 
 struct Shortcut { String a, b; bool isHeader; };
@@ -65,6 +68,10 @@ Vector<String> logEntries_;
 Vector<Shortcut> displayShortcuts_;
 String debugLog_;
 
+// Messages can be added from any thread, so they are queued and moved to the hud during tick.
+CriticalSection pendingLock_;
+Vector<PendingMessage> pendingMessages_;
+
 int textOverlayScrollPos_, textOverlayScrollEnd_, textOverlayPageSize_;
 Mode textOverlayMode_;
 
@@ -217,6 +224,7 @@ void UpdateScrollValues()
 
 void tick()
 {
+	addPendingMessages();
 	UpdateScrollValues();
 	switch(textOverlayMode_)
 	{
@@ -361,7 +369,26 @@ void draw()
 
 void addMessage(const char* str, MessageType type)
 {
-	String msg = str;
+	pendingLock_.lock();
+	pendingMessages_.push_back({String(str), type});
+	pendingLock_.unlock();
+}
+
+void addPendingMessages()
+{
+	Vector<PendingMessage> messages;
+	pendingLock_.lock();
+	messages.swap(pendingMessages_);
+	pendingLock_.unlock();
+
+	for(auto& message : messages)
+	{
+		addHudEntry(message.text, message.type);
+	}
+}
+
+void addHudEntry(String msg, MessageType type)
+{
 	if(type == NOTE)
 	{
 		hudEntries_.push_back({msg, type, 0.5f});
@@ -33,6 +33,8 @@ struct TextOverlay : public InputHandler
 	virtual void tick() = 0;
 	virtual void draw() = 0;
 
+	/// Adds a message to the hud and the message log. Can be called from any thread, the message
+	/// is shown from the next tick on.
 	virtual void addMessage(const char* str, MessageType type) = 0;
 	virtual void show(Mode mode) = 0;
 
@@ -41,6 +41,10 @@ ChartManImpl()
 	myApplyStepArtistId = gHistory->addCallback(ApplyStepArtist);
 	myApplyMeterId      = gHistory->addCallback(ApplyMeter);
 	myApplyDifficultyId = gHistory->addCallback(ApplyDifficulty);
+
+	gHistory->enableJournal(myApplyStepArtistId);
+	gHistory->enableJournal(myApplyMeterId);
+	gHistory->enableJournal(myApplyDifficultyId);
 }
 
 // ================================================================================================
@@ -79,6 +83,7 @@ static String ApplyStepArtist(ReadStream& in, History::Bindings bound, bool undo
 
 		gSimfile->openChart(bound.chart);
 		bound.chart->artist = newVal;
+		bound.chart->markModified();
 		gEditor->reportChanges(VCM_CHART_PROPERTIES_CHANGED);
 	}
 	return msg;	
@@ -112,6 +117,7 @@ static String ApplyMeter(ReadStream& in, History::Bindings bound, bool undo, boo
 
 		gSimfile->openChart(bound.chart);
 		bound.chart->meter = newVal;
+		bound.chart->markModified();
 		gEditor->reportChanges(VCM_CHART_PROPERTIES_CHANGED);
 	}
 	return msg;
@@ -145,6 +151,7 @@ static String ApplyDifficulty(ReadStream& in, History::Bindings bound, bool undo
 
 		gSimfile->openChart(bound.chart);
 		bound.chart->difficulty = newDiff;
+		bound.chart->markModified();
 		gEditor->reportChanges(VCM_CHART_PROPERTIES_CHANGED);
 	}
 	return msg;
@@ -297,8 +304,8 @@ Vector<BreakdownItem> getStreamBreakdown(int* totalMeasures) const
 
 	// Build a list of streams and breaks.
 	Vector<StreamItem> items;
-	const ExpandedNote* prevStreamEnd = nullptr, *streamBegin = nullptr;
-	for(const ExpandedNote* n = first, *next; n != last; n = next)
+	ExpandedNotePtr prevStreamEnd, streamBegin;
+	for(ExpandedNotePtr n = first, next; n != last; n = next)
 	{
 		next = n + 1;
 		while(next->isMine) ++next;
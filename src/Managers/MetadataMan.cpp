@@ -38,6 +38,9 @@ MetadataManImpl()
 
 	myApplyStringPropertyId = gHistory->addCallback(ApplyStringProperty);
 	myApplyMusicPreviewId   = gHistory->addCallback(ApplyMusicPreview);
+
+	// String property edits store a pointer to the property, so they are not written to the journal.
+	gHistory->enableJournal(myApplyMusicPreviewId);
 }
 
 // ================================================================================================
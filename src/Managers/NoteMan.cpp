@@ -33,12 +33,18 @@ struct NotesManImpl : public NotesMan {
 // ================================================================================================
 // NotesManImpl :: member data.
 
-Vector<ExpandedNote> myNotes;
+ExpandedNoteList myNotes;
 
 int myNumSteps, myNumJumps;
 int myNumHolds, myNumRolls;
 int myNumMines, myNumWarps;
 
+// Spans of the holds and rolls, which find the holds that reach a row.
+HoldIndex myHolds;
+
+// Sorted indices of the selected notes, which have their isSelected flag set.
+Vector<int> mySelection;
+
 Simfile* mySimfile;
 Chart* myChart;
 
@@ -66,8 +72,13 @@ NotesManImpl()
 
 	myApplyAddNoteId     = gHistory->addCallback(ApplyAddNote);
 	myApplyRemNoteId     = gHistory->addCallback(ApplyRemoveNote);
-	myApplyChangeNotesId = gHistory->addCallback(ApplyChangeNotes);
+	myApplyChangeNotesId = gHistory->addCallback(ApplyChangeNotes, nullptr, MergeChangeNotes);
 	myApplyInsertRowsId  = gHistory->addCallback(ApplyInsertRows);
+
+	// Insert rows edits store the charts they affect, so they are not written to the journal.
+	gHistory->enableJournal(myApplyAddNoteId);
+	gHistory->enableJournal(myApplyRemNoteId);
+	gHistory->enableJournal(myApplyChangeNotesId, JournalChangeNotes);
 }
 
 // ================================================================================================
@@ -75,115 +86,151 @@ NotesManImpl()
 
 void myUpdateNotes()
 {
-	int numCols = gStyle->getNumCols();
-	int numPlayers = gStyle->getNumPlayers();
 	myChart->notes.sanitize(myChart);
 
-	myNotes.resize(myChart->notes.size());
-	auto it = myNotes.begin();
-	for(auto& note : myChart->notes)
-	{
-		it->row = note.row;
-		it->col = note.col;
-		it->endrow = note.endrow;
-		it->isMine = note.type == NOTE_MINE;
-		it->isRoll = note.type == NOTE_ROLL;
-		it->isSelected = 0;
-		it->type = note.type;
-		it->player = note.player;
-		it->quant = note.quant;
-		++it;
-	}
+	ExpandNotes(myChart->notes, myNotes);
+	mySelection.clear();
 
-	myUpdateNoteTimes();
+	myUpdateNoteTimes(0);
 	myUpdateWarpedNotes();
 	myUpdateNoteStats();
-	myUpdateCheckQuants();
+	myUpdateCheckQuants(myNotes.begin(), myNotes.end());
 }
 
-void myUpdateCheckQuants()
+// Updates the expanded notes after the given notes were added to and removed from the chart. Only
+// the notes on the rows between the first and last changed row are expanded again.
+void myUpdateChangedNotes(const NoteList& add, const NoteList& rem)
 {
-	for (auto& note : myNotes)
+	int firstRow = INT_MAX, lastRow = -1;
+	if(rem.size())
 	{
-		if (note.quant < 0 || note.quant > 192)
-		{
-			HudError("Missing quant at %d, value %d", note.row, note.quant);
-			note.quant = 192;
-		}
+		firstRow = rem.begin()->row;
+		lastRow = (rem.end() - 1)->row;
 	}
-}
+	for(auto& note : add)
+	{
+		firstRow = min(firstRow, note.row);
+		lastRow = max(lastRow, note.endrow);
+	}
+	if(firstRow > lastRow) return;
 
-void myUpdateNoteTimes()
-{
-	TempoTimeTracker tracker;
-	for(auto& note : myNotes)
+	// Find the range of expanded notes and the range of chart notes on the changed rows.
+	const int* rows = myNotes.rows();
+	int begin = std::lower_bound(rows, rows + myNotes.size(), firstRow) - rows;
+	int end = std::lower_bound(rows + begin, rows + myNotes.size(), lastRow + 1) - rows;
+
+	const NoteList& notes = myChart->notes;
+	auto first = notes.lowerBound(firstRow), last = notes.lowerBound(lastRow + 1);
+	int num = last - first;
+
+	// Notes on the changed rows are deselected, the selected notes after them only move.
+	int shift = num - (end - begin), numSelected = 0;
+	for(int index : mySelection)
 	{
-		note.time = tracker.advance(note.row);
-		if(note.endrow == note.row)
+		if(index < begin)
 		{
-			note.endtime = note.time;
+			mySelection[numSelected++] = index;
 		}
-		else
+		else if(index >= end)
 		{
-			note.endtime = gTempo->rowToTime(note.endrow);
+			mySelection[numSelected++] = index + shift;
 		}
 	}
+	mySelection.resize(numSelected);
+
+	// Replace the expanded notes, the notes after them only move.
+	myCountNoteStats(myNotes.begin() + begin, myNotes.begin() + end, -1);
+	if(num > end - begin)
+	{
+		myNotes.insert(end, num - (end - begin));
+	}
+	else
+	{
+		myNotes.erase(begin + num, end);
+	}
+	int out = begin;
+	for(auto it = first; it != last; ++it)
+	{
+		ExpandedNote note;
+		ExpandNote(*it, note);
+		myNotes.set(out++, note);
+	}
+
+	auto& timing = gTempo->getTimingData();
+	UpdateNoteTimes(myNotes, begin, num, timing, firstRow);
+	UpdateWarpedNotes(myNotes, begin, num, timing);
+	myCountNoteStats(myNotes.begin() + begin, myNotes.begin() + begin + num, 1);
+	myUpdateCheckQuants(myNotes.begin() + begin, myNotes.begin() + begin + num);
 }
 
-void myUpdateWarpedNotes()
+void myUpdateCheckQuants(ExpandedNoteList::iterator note, ExpandedNoteList::iterator end)
 {
-	uint insideWarp = 0;
-	auto note = myNotes.begin(), noteEnd = myNotes.end();
-	auto& events = gTempo->getTimingData().events;
-	auto it = events.begin(), end = events.end();
-	for(; it != end; ++it)
+	for (; note != end; ++note)
 	{
-		if(insideWarp)
+		if (note->quant < 0 || note->quant > 192)
 		{
-			for(; note != noteEnd && note->row < it->row; ++note)
-			{
-				note->isWarped = 1;
-			}
-		}
-		else
-		{
-			for(; note != noteEnd && note->row <= it->row; ++note)
-			{
-				note->isWarped = 0;
-			}
+			HudError("Missing quant at %d, value %d", note->row, note->quant);
+			note->quant = 192;
 		}
-		insideWarp = (it->spr == 0.0);
-	}
-	for(; note != noteEnd; ++note)
-	{
-		note->isWarped = 0;
 	}
 }
 
+void myUpdateNoteTimes(int firstChangedRow)
+{
+	UpdateNoteTimes(myNotes, 0, myNotes.size(), gTempo->getTimingData(), firstChangedRow);
+}
+
+void myUpdateWarpedNotes()
+{
+	UpdateWarpedNotes(myNotes, 0, myNotes.size(), gTempo->getTimingData());
+}
+
 void myUpdateNoteStats()
 {
 	myNumSteps = 0, myNumJumps = 0;
 	myNumHolds = 0, myNumRolls = 0;
 	myNumMines = 0, myNumWarps = 0;
+	myHolds.clear();
+
+	myCountNoteStats(myNotes.begin(), myNotes.end(), 1);
+}
 
+// Adds the statistics of the given notes times sign. The notes must cover entire rows, so that the
+// jumps do not depend on the notes around them. The spans of the holds are added or removed too.
+void myCountNoteStats(ExpandedNotePtr note, ExpandedNotePtr end, int sign)
+{
+	int numSteps = 0, numJumps = 0;
+	int numHolds = 0, numRolls = 0;
+	int numMines = 0, numWarps = 0;
+
+	Vector<HoldSpan> holds;
 	int lastRow = -1;
-	for(auto& note : myNotes)
+	for(; note != end; ++note)
 	{
-		if(!note.isMine)
+		if(note->endrow > note->row)
+		{
+			holds.push_back({(int)note->col, note->row, note->endrow});
+		}
+		if(!note->isMine)
 		{
-			int isHoldOrRoll = note.endrow > note.row;
-			myNumRolls += isHoldOrRoll & note.isRoll;
-			myNumHolds += isHoldOrRoll & (note.isRoll ^ 1);
-			myNumJumps += lastRow == note.row;
-			lastRow = note.row;
-			++myNumSteps;
+			int isHoldOrRoll = note->endrow > note->row;
+			numRolls += isHoldOrRoll & note->isRoll;
+			numHolds += isHoldOrRoll & (note->isRoll ^ 1);
+			numJumps += lastRow == note->row;
+			lastRow = note->row;
+			++numSteps;
 		}
 		else
 		{
-			++myNumMines;
+			++numMines;
 		}
-		myNumWarps += note.isWarped;
+		numWarps += note->isWarped;
 	}
+
+	myNumSteps += numSteps * sign, myNumJumps += numJumps * sign;
+	myNumHolds += numHolds * sign, myNumRolls += numRolls * sign;
+	myNumMines += numMines * sign, myNumWarps += numWarps * sign;
+	if(sign > 0) myHolds.insert(holds); else myHolds.remove(holds);
 }
 
 void update(Simfile* simfile, Chart* chart)
@@ -198,6 +245,7 @@ void update(Simfile* simfile, Chart* chart)
 	else
 	{
 		myNotes.release();
+		mySelection.release();
 		myUpdateNoteStats();
 	}
 
@@ -206,10 +254,33 @@ void update(Simfile* simfile, Chart* chart)
 
 void updateTempo()
 {
-	myUpdateNoteTimes();
+	myUpdateNoteTimes(0);
 	myUpdateWarpedNotes();
 }
 
+void updateTempo(int firstChangedRow)
+{
+	if(firstChangedRow <= 0)
+	{
+		updateTempo();
+	}
+	else if(firstChangedRow != INT_MAX)
+	{
+		myUpdateNoteTimes(firstChangedRow);
+		myUpdateWarpedNotes();
+	}
+}
+
+void updateTempoOffset(double shift)
+{
+	double* times = myNotes.times(), *endtimes = myNotes.endtimes();
+	for(int i = 0; i < myNotes.size(); ++i)
+	{
+		times[i] += shift;
+		endtimes[i] += shift;
+	}
+}
+
 // ================================================================================================
 // NotesManImpl :: editing helper functions.
 
@@ -233,10 +304,16 @@ static String GetNoteName(const Note& note)
 
 void myApplyNotes(Chart* chart, const NoteList& add, const NoteList& rem, bool firstTime)
 {
-	// Remove notes before inserting rows.
+	// Remove notes before inserting rows. Only the added notes can conflict with other notes.
 	chart->notes.remove(rem);
 	chart->notes.insert(add);
-	chart->notes.sanitize(chart);
+	chart->markModified();
+	if(add.size())
+	{
+		int lastRow = add.begin()->row;
+		for(auto& note : add) lastRow = max(lastRow, note.endrow);
+		chart->notes.sanitize(chart, add.begin()->row, lastRow);
+	}
 
 	// Jump to the position of the first note that changed.
 	bool updated = false;
@@ -262,9 +339,9 @@ void myApplyNotes(Chart* chart, const NoteList& add, const NoteList& rem, bool f
 
 	if(myChart == chart)
 	{
-		if(!firstTime) select(SELECT_SET, add.begin(), add.size());
+		if(!updated) myUpdateChangedNotes(add, rem);
 
-		if(!updated) myUpdateNotes();
+		if(!firstTime) select(SELECT_SET, add);
 
 		gEditor->reportChanges(VCM_NOTES_CHANGED);
 	}
@@ -404,6 +481,48 @@ static String ApplyChangeNotes(ReadStream& in, History::Bindings bound, bool und
 	return msg;
 }
 
+// Merges two note changes if the second change removes exactly the notes that were added by the
+// first change, which is the case when the same notes are nudged repeatedly.
+static bool MergeChangeNotes(ReadStream& prev, ReadStream& next, WriteStream& out)
+{
+	NoteList add1, rem1, add2, rem2;
+	const uchar* add1Begin = prev.pos();
+	add1.decode(prev, 0);
+	const uchar* rem1Begin = prev.pos();
+	rem1.decode(prev, 0);
+	const uchar* rem1End = prev.pos();
+	auto desc1 = prev.read<const EditDescription*>();
+
+	const uchar* add2Begin = next.pos();
+	add2.decode(next, 0);
+	const uchar* rem2Begin = next.pos();
+	rem2.decode(next, 0);
+	const uchar* rem2End = next.pos();
+	auto desc2 = next.read<const EditDescription*>();
+
+	if(!prev.success() || !next.success() || desc1 != desc2) return false;
+
+	int add1Size = (int)(rem1Begin - add1Begin);
+	if(add1Size != rem2End - rem2Begin || memcmp(add1Begin, rem2Begin, add1Size) != 0)
+	{
+		return false;
+	}
+
+	out.write(add2Begin, (int)(rem2Begin - add2Begin));
+	out.write(rem1Begin, (int)(rem1End - rem1Begin));
+	out.write(desc1);
+	return true;
+}
+
+// The edit description points to static data of the running editor, so it is left out of the journal.
+static void JournalChangeNotes(ReadStream& in, WriteStream& out)
+{
+	const uchar* begin = in.pos();
+	in.skip((int)in.bytesleft() - (int)sizeof(const EditDescription*));
+	out.write(begin, (int)(in.pos() - begin));
+	out.write((const EditDescription*)nullptr);
+}
+
 // ================================================================================================
 // NotesManImpl :: apply insert rows.
 
@@ -414,7 +533,7 @@ void myItemizeInsertRows(WriteStream& stream, Chart* chart, int startRow, int nu
 	if(numRows < 0)
 	{
 		int endRow = startRow - numRows;
-		NoteList& notes = chart->notes;
+		const NoteList& notes = chart->notes;
 		for(auto& note : notes)
 		{
 			if(note.endrow >= startRow && note.row <= endRow)
@@ -447,6 +566,7 @@ void myQueueInsertRows(int startRow, int numRows, bool curChartOnly)
 		{
 			for(auto chart : mySimfile->charts)
 			{
+				chart->loadNotes();
 				myItemizeInsertRows(stream, chart, startRow, numRows);
 			}
 		}
@@ -458,11 +578,25 @@ void myQueueInsertRows(int startRow, int numRows, bool curChartOnly)
 
 void myApplyInsertRowsOffset(Chart* chart, int startRow, int numRows)
 {
+	chart->markModified();
 	for(auto& n : chart->notes)
 	{
 		if(n.row >= startRow) n.row += numRows;
 		if(n.endrow >= startRow) n.endrow += numRows;
 	}
+	chart->notes.invalidateHolds();
+
+	// The expanded notes are offset as well, so edits in between can be applied to them.
+	if(chart == myChart)
+	{
+		int* rows = myNotes.rows(), *endrows = myNotes.endrows();
+		for(int i = 0; i < myNotes.size(); ++i)
+		{
+			if(rows[i] >= startRow) rows[i] += numRows;
+			if(endrows[i] >= startRow) endrows[i] += numRows;
+		}
+		myHolds.offset(startRow, numRows);
+	}
 }
 
 String myApplyInsertRows(ReadStream& in, bool undo, bool redo)
@@ -527,69 +661,107 @@ void forAllSelectedNotes(Func f)
 	if(gSelection->getType() == Selection::REGION)
 	{
 		auto region = gSelection->getSelectedRegion();
-		for(auto& note : myNotes)
+		ExpandedNotePtr note = getFirstNoteFromRow(region.beginRow), end = myNotes.end();
+		for(; note != end && note->row <= region.endRow; ++note)
 		{
-			if(note.row >= region.beginRow && note.row <= region.endRow)
-			{
-				f(note);
-			}
+			f(*note);
 		}
 	}
 	else if(gSelection->getType() == Selection::NOTES)
 	{
-		for(auto& note : myNotes)
+		for(int index : mySelection)
 		{
-			if(note.isSelected)
-			{
-				f(note);
-			}
+			f(myNotes[index]);
 		}
 	}
 }
 
+// Applies a selection operation to the notes between the first and last index for which the
+// predicate returns true. Only the tested notes and the selected notes are visited.
 template <typename Predicate>
-int performSelection(SelectModifier mod, Predicate pred)
+int performSelection(SelectModifier mod, int first, int last, Predicate pred)
 {
+	Vector<int> matches;
+	for(int i = first; i < last; ++i)
+	{
+		if(pred(myNotes.begin() + i)) matches.push_back(i);
+	}
+
 	int numSelected = 0;
-	auto note = myNotes.begin();
-	auto end = myNotes.end();
 	if(mod == SELECT_SET)
 	{
-		for(; note != end; ++note)
+		for(int index : mySelection)
 		{
-			uint set = pred(note);
-			numSelected += set;
-			note->isSelected = set;
+			myNotes[index].isSelected = 0;
 		}
+		mySelection.swap(matches);
+		for(int index : mySelection)
+		{
+			myNotes[index].isSelected = 1;
+		}
+		numSelected = mySelection.size();
 	}
 	else if(mod == SELECT_ADD)
 	{
-		for(; note != end; ++note)
+		// Merge the newly selected notes into the selection.
+		Vector<int> merged;
+		merged.reserve(mySelection.size() + matches.size());
+		auto a = mySelection.begin(), aEnd = mySelection.end();
+		for(int index : matches)
 		{
-			uint set = pred(note);
-			numSelected += set & (note->isSelected ^ 1);
-			note->isSelected |= set;
+			if(myNotes[index].isSelected) continue;
+			for(; a != aEnd && *a < index; ++a)
+			{
+				merged.push_back(*a);
+			}
+			merged.push_back(index);
+			myNotes[index].isSelected = 1;
+			++numSelected;
 		}
+		for(; a != aEnd; ++a)
+		{
+			merged.push_back(*a);
+		}
+		mySelection.swap(merged);
 	}
 	else if(mod == SELECT_SUB)
 	{
-		for(; note != end; ++note)
+		for(int index : matches)
+		{
+			numSelected += myNotes[index].isSelected;
+			myNotes[index].isSelected = 0;
+		}
+		int numLeft = 0;
+		for(int index : mySelection)
 		{
-			uint set = pred(note);
-			numSelected += set & note->isSelected;
-			note->isSelected &= set ^ 1;
+			if(myNotes[index].isSelected) mySelection[numLeft++] = index;
 		}
+		mySelection.resize(numLeft);
 	}
 	gSelection->setType(Selection::NOTES);
 	return numSelected;
 }
 
+template <typename Predicate>
+int performSelection(SelectModifier mod, Predicate pred)
+{
+	return performSelection(mod, 0, myNotes.size(), pred);
+}
+
+// Returns the index range of the notes between the given rows, including the last row.
+void myGetRowRange(int firstRow, int lastRow, int& outFirst, int& outLast) const
+{
+	outFirst = getFirstNoteFromRow(firstRow) - myNotes.begin();
+	outLast = (lastRow == INT_MAX) ? myNotes.size() : getFirstNoteFromRow(lastRow + 1) - myNotes.begin();
+}
+
 void deselectAll()
 {
-	for(auto& note : myNotes)
+	for(int index : mySelection)
 	{
-		note.isSelected = 0;
+		myNotes[index].isSelected = 0;
 	}
+	mySelection.clear();
 	if(gSelection->getType() == Selection::NOTES)
 	{
 		gSelection->setType(Selection::NONE);
@@ -598,9 +770,11 @@ void deselectAll()
 
 int selectAll()
 {
-	for(auto& note : myNotes)
+	mySelection.resize(myNotes.size());
+	for(int i = 0; i < myNotes.size(); ++i)
 	{
-		note.isSelected = 1;
+		myNotes[i].isSelected = 1;
+		mySelection[i] = i;
 	}
 	if(myNotes.size())
 	{
@@ -612,9 +786,12 @@ int selectAll()
 int selectQuant(int rowType)
 {
 	int numSelected = 0;
-	for(auto& note : myNotes)
+	mySelection.clear();
+	for(int i = 0; i < myNotes.size(); ++i)
 	{
+		auto note = myNotes[i];
 		note.isSelected = (ToRowType(note.row) == rowType);
+		if(note.isSelected) mySelection.push_back(i);
 		numSelected += note.isSelected;
 	}
 	if(numSelected)
@@ -626,7 +803,9 @@ int selectQuant(int rowType)
 
 int selectRows(SelectModifier mod, int firstCol, int lastCol, int firstRow, int lastRow)
 {
-	return performSelection(mod, [&](const ExpandedNote* note)
+	int first, last;
+	myGetRowRange(firstRow, lastRow - 1, first, last);
+	return performSelection(mod, first, last, [&](ExpandedNotePtr note)
 	{
 		return (note->col >= firstCol && note->col < lastCol &&
 		        note->row >= firstRow && note->row < lastRow);
@@ -636,7 +815,10 @@ int selectRows(SelectModifier mod, int firstCol, int lastCol, int firstRow, int
 int selectTime(SelectModifier mod, int firstCol, int lastCol, double firstTime, double lastTime)
 {
 	gSelection->setType(Selection::NOTES);
-	return performSelection(mod, [&](const ExpandedNote* note)
+	int first = getFirstNoteFromTime(firstTime) - myNotes.begin();
+	const double* times = myNotes.times();
+	int last = std::upper_bound(times + first, times + myNotes.size(), lastTime) - times;
+	return performSelection(mod, first, last, [&](ExpandedNotePtr note)
 	{
 		return (note->col >= firstCol && note->col < lastCol &&
 		        note->time >= firstTime && note->time <= lastTime);
@@ -645,8 +827,10 @@ int selectTime(SelectModifier mod, int firstCol, int lastCol, double firstTime,
 
 int select(SelectModifier mod, const Vector<RowCol>& indices)
 {
+	int first = 0, last = 0;
+	if(indices.size()) myGetRowRange(indices.begin()->row, indices.back().row, first, last);
 	auto it = indices.begin(), end = indices.end();
-	return performSelection(mod, [&](const ExpandedNote* note)
+	return performSelection(mod, first, last, [&](ExpandedNotePtr note)
 	{
 		while(it != end && LessThanRowCol(*it, *note)) ++it;
 		if(it == end) return false;
@@ -654,10 +838,12 @@ int select(SelectModifier mod, const Vector<RowCol>& indices)
 	});
 }
 
-int select(SelectModifier mod, const Note* notes, int numNotes)
+int select(SelectModifier mod, const NoteList& notes)
 {
-	auto it = notes, end = notes + numNotes;
-	return performSelection(mod, [&](const ExpandedNote* note)
+	int first = 0, last = 0;
+	if(notes.size()) myGetRowRange(notes.begin()->row, (notes.end() - 1)->row, first, last);
+	auto it = notes.begin(), end = notes.end();
+	return performSelection(mod, first, last, [&](ExpandedNotePtr note)
 	{
 		while(it != end && LessThanRowCol(*it, *note)) ++it;
 		if(it == end) return false;
@@ -672,12 +858,12 @@ int select(SelectModifier mod, Filter filter)
 	switch(filter)
 	{
 	case SELECT_STEPS:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return !note->isMine;
 		});
 	case SELECT_JUMPS:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			if(note->isMine)
 			{
@@ -694,32 +880,32 @@ int select(SelectModifier mod, Filter filter)
 			return false;
 		});
 	case SELECT_MINES:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return note->isMine;
 		});
 	case SELECT_HOLDS:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return note->endrow != note->row && !note->isRoll;
 		});
 	case SELECT_ROLLS:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return note->endrow != note->row && note->isRoll;
 		});
 	case SELECT_WARPS:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return note->isWarped;
 		});
 	case SELECT_FAKES:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return note->type == NoteType::NOTE_FAKE;
 		});
 	case SELECT_LIFTS:
-		return performSelection(mod, [&](const ExpandedNote* note)
+		return performSelection(mod, [&](ExpandedNotePtr note)
 		{
 			return note->type == NoteType::NOTE_LIFT;
 		});
@@ -729,11 +915,16 @@ int select(SelectModifier mod, Filter filter)
 
 bool noneSelected() const
 {
-	for(auto& note : myNotes)
+	return mySelection.empty();
+}
+
+int getSelectedNotes(NoteList& out) const
+{
+	for(int index : mySelection)
 	{
-		if(note.isSelected) return false;
+		out.append(CompressNote(myNotes[index]));
 	}
-	return true;
+	return mySelection.size();
 }
 
 // ================================================================================================
@@ -840,7 +1031,7 @@ void pasteFromClipboard(bool insert)
 	// Perform the changes.
 	static const NotesMan::EditDescription desc = {"Pasted %1 note", "Pasted %1 notes"};
 	modify(edit, !insert, &desc);
-	select(SELECT_SET, edit.add.begin(), edit.add.size());
+	select(SELECT_SET, edit.add);
 }
 
 // ================================================================================================
@@ -876,49 +1067,75 @@ int getNumWarps() const
 	return myNumWarps;
 }
 
-const ExpandedNote* begin() const
+ExpandedNotePtr begin() const
 {
 	return myNotes.begin();
 }
 
-const ExpandedNote* end() const
+ExpandedNotePtr end() const
 {
 	return myNotes.end();
 }
 
-const ExpandedNote* getNoteAt(int row, int col) const
+ExpandedNotePtr getNoteAt(int row, int col) const
 {
-	RowCol key = {row, col};
-	auto it = std::lower_bound(myNotes.begin(), myNotes.end(), key, [](const ExpandedNote& a, const RowCol& b)
+	// Search the row array, the notes on a row are sorted by column.
+	const int* rows = myNotes.rows();
+	int num = myNotes.size();
+	int i = std::lower_bound(rows, rows + num, row) - rows;
+	for(; i < num && rows[i] == row; ++i)
 	{
-		return CompareRowCol(a, b) < 0;
-	});
-	return (it != myNotes.end() && CompareRowCol(*it, key) == 0) ? it : nullptr;
+		int noteCol = myNotes[i].col;
+		if(noteCol == col) return myNotes.begin() + i;
+		if(noteCol > col) break;
+	}
+	return nullptr;
 }
 
-const ExpandedNote* getNoteIntersecting(int row, int col) const
+ExpandedNotePtr getNoteIntersecting(int row, int col) const
 {
-	auto it = myNotes.begin(), end = myNotes.end();
-	for(; it != end && it->endrow < row; ++it);
-	for(; it != end && it->row <= row; ++it)
-	{
-		if(it->col == col && it->endrow >= row) return it;
-	}
-	return nullptr;
+	auto hold = myHolds.find(col, row);
+	return getNoteAt(hold ? hold->row : row, col);
 }
 
-Vector<const ExpandedNote*> getNotesBeforeTime(double time) const
+Vector<ExpandedNotePtr> getNotesBeforeTime(double time) const
 {
-	Vector<const ExpandedNote*> out(gStyle->getNumCols(), nullptr);
+	int numCols = gStyle->getNumCols();
+	Vector<ExpandedNotePtr> out(numCols, nullptr);
 	auto cols = out.begin();
-	for(auto& n : myNotes)
+
+	// Walk back from the last note before the time, until every column has a note.
+	const double* times = myNotes.times();
+	auto it = myNotes.begin() + (std::upper_bound(times, times + myNotes.size(), time) - times);
+	for(int numFound = 0; it != myNotes.begin() && numFound < numCols;)
 	{
-		if(n.time > time) break;
-		cols[n.col] = &n;
+		--it;
+		if(it->col < numCols && !cols[it->col])
+		{
+			cols[it->col] = it;
+			++numFound;
+		}
 	}
 	return out;
 }
 
+ExpandedNotePtr getFirstNoteFromRow(int row) const
+{
+	const int* rows = myNotes.rows();
+	return myNotes.begin() + (std::lower_bound(rows, rows + myNotes.size(), row) - rows);
+}
+
+ExpandedNotePtr getFirstNoteFromTime(double time) const
+{
+	const double* times = myNotes.times();
+	return myNotes.begin() + (std::lower_bound(times, times + myNotes.size(), time) - times);
+}
+
+ExpandedNotePtr getFirstNoteReachingRow(int row) const
+{
+	return getFirstNoteFromRow(myHolds.firstRowReaching(row));
+}
+
 bool empty() const
 {
 	return myNotes.empty();
@@ -36,6 +36,12 @@ struct NotesMan
 	/// Called by tempo when the active tempo changes.
 	virtual void updateTempo() = 0;
 
+	/// Called by tempo when the timing of the active tempo changes from the given row onwards.
+	virtual void updateTempo(int firstChangedRow) = 0;
+
+	/// Called by tempo when the offset of the active tempo changes, which shifts all note times.
+	virtual void updateTempoOffset(double shift) = 0;
+
 	// Selection functions.
 	virtual void deselectAll() = 0;
 	virtual int selectAll() = 0;
@@ -43,10 +49,13 @@ struct NotesMan
 	virtual int selectRows(SelectModifier mod, int beginCol, int endCol, int beginRow, int endRow) = 0;
 	virtual int selectTime(SelectModifier mod, int beginCol, int endCol, double beginTime, double endTime) = 0;
 	virtual int select(SelectModifier mod, const Vector<RowCol>& indices) = 0;
-	virtual int select(SelectModifier mod, const Note* notes, int numNotes) = 0;
+	virtual int select(SelectModifier mod, const NoteList& notes) = 0;
 	virtual int select(SelectModifier mod, Filter filter) = 0;
 	virtual bool noneSelected() const = 0;
 
+	/// Appends the selected notes to the output list, in order. Returns the number of notes.
+	virtual int getSelectedNotes(NoteList& out) const = 0;
+
 	// Editing functions.
 	virtual void modify(const NoteEdit& edit, bool clearRegion, const EditDescription* desc = nullptr) = 0;
 	virtual void removeSelectedNotes() = 0;
@@ -64,23 +73,33 @@ struct NotesMan
 	virtual int getNumRolls() const = 0;
 	virtual int getNumWarps() const = 0;
 
-	/// Returns a pointer to the first note.
-	virtual const ExpandedNote* begin() const = 0;
+	/// Returns an iterator to the first note.
+	virtual ExpandedNotePtr begin() const = 0;
 
-	/// Returns a pointer to the last note.
-	virtual const ExpandedNote* end() const = 0;
+	/// Returns an iterator past the last note.
+	virtual ExpandedNotePtr end() const = 0;
 
 	/// Returns true if the number of notes is zero.
 	virtual bool empty() const = 0;
 
 	/// Returns a pointer to the note at the given row/column, or null if there is none.
-	virtual const ExpandedNote* getNoteAt(int row, int col) const = 0;
+	virtual ExpandedNotePtr getNoteAt(int row, int col) const = 0;
 
 	/// Returns a pointer to the note that contains the given row/column, or null if there is none.
-	virtual const ExpandedNote* getNoteIntersecting(int row, int col) const = 0;
+	virtual ExpandedNotePtr getNoteIntersecting(int row, int col) const = 0;
 
 	/// Returns the indices of all notes preceding the given time for each column.
-	virtual Vector<const ExpandedNote*> getNotesBeforeTime(double time) const = 0;
+	virtual Vector<ExpandedNotePtr> getNotesBeforeTime(double time) const = 0;
+
+	/// Returns a pointer to the first note on or after the given row, or end if there is none.
+	virtual ExpandedNotePtr getFirstNoteFromRow(int row) const = 0;
+
+	/// Returns a pointer to the first note on or after the given time, or end if there is none.
+	virtual ExpandedNotePtr getFirstNoteFromTime(double time) const = 0;
+
+	/// Returns a pointer to the first note that can end on or after the given row. The notes before
+	/// it all end before the row, the notes after it do not necessarily reach the row.
+	virtual ExpandedNotePtr getFirstNoteReachingRow(int row) const = 0;
 };
 
 extern NotesMan* gNotes;
@@ -10,6 +10,7 @@
 #include <System/System.h>
 #include <System/File.h>
 #include <System/Debug.h>
+#include <System/Thread.h>
 
 #include <Simfile/Simfile.h>
 #include <Simfile/SegmentGroup.h>
@@ -33,6 +34,35 @@
 
 namespace Vortex {
 
+// ================================================================================================
+// SimfileManImpl :: save thread.
+
+// Saves a copy of the simfile in the background, so the editor is not blocked while the simfile is
+// serialized and written to disk. The chart cache belongs to the thread until it is done. The result
+// is reported by the simfile manager once the thread is done, see SimfileManImpl::finishSave.
+struct SaveThread : public BackgroundThread
+{
+	Simfile* simfile;
+	ChartCache* cache;
+	SimFormat format;
+	bool backup;
+	bool success;
+
+	SaveThread(Simfile* sim, ChartCache* c, SimFormat fmt, bool bak)
+		: simfile(sim), cache(c), format(fmt), backup(bak), success(false) {}
+
+	~SaveThread()
+	{
+		waitUntilDone();
+		delete simfile;
+	}
+
+	void exec() override
+	{
+		success = SaveSimfile(*simfile, format, backup, cache);
+	}
+};
+
 // ================================================================================================
 // SimfileManImpl :: member data.
 
@@ -45,6 +75,9 @@ int myEndRow;
 int myChartIndex;
 bool myBackupOnSave;
 
+SaveThread* mySaveThread;
+ChartCache myChartCache;
+
 History::EditId myApplyAddChartId;
 History::EditId myApplyRemoveChartId;
 
@@ -57,6 +90,7 @@ SimfileManImpl()
 	, myEndRow(0)
 	, myChartIndex(-1)
 	, myBackupOnSave(false)
+	, mySaveThread(nullptr)
 {
 	myApplyAddChartId    = gHistory->addCallback(ApplyAddChart,    ReleaseAddChart);
 	myApplyRemoveChartId = gHistory->addCallback(ApplyRemoveChart, ReleaseRemoveChart);
@@ -64,6 +98,7 @@ SimfileManImpl()
 
 ~SimfileManImpl()
 {
+	delete mySaveThread;
 	delete mySimfile;
 }
 
@@ -89,7 +124,8 @@ void myUpdateEndRow()
 	// Row of the last note.
 	if(myChart) 
 	{
-		for (auto& n : myChart->notes)
+		const NoteList& notes = myChart->notes;
+		for(auto& n : notes)
 		{
 			endRow = max(endRow, n.endrow);
 		}
@@ -124,6 +160,7 @@ void myUpdateChart()
 	{
 		myChartIndex = clamp(myChartIndex, -1, mySimfile->charts.size() - 1);
 		myChart = (myChartIndex >= 0) ? mySimfile->charts[myChartIndex] : nullptr;
+		if(myChart) myChart->loadNotes();
 	}
 	else
 	{
@@ -173,9 +210,9 @@ bool load(StringRef path)
 	HudInfo("Opening: %s", filename.str());
 	
 	// Check if we are loading a stepmania simfile.
-	if(ext == "sm" || ext == "ssc" || ext == "dwi" || ext == "osu" || ext == "osz")
+	if(ext == "sm" || ext == "ssc" || ext == "dwi" || ext == "osu" || ext == "osz" || ext == "avproj")
 	{
-		if(!LoadSimfile(*mySimfile, path))
+		if(!LoadSimfile(*mySimfile, path, true))
 		{
 			close();
 			return false;
@@ -228,19 +265,67 @@ bool save(StringRef dir, StringRef name, SimFormat format)
 	mySimfile->dir = dir;
 	mySimfile->file = name;
 
-	// Save the simfile.
-	bool result = SaveSimfile(*mySimfile, format, myBackupOnSave);
+	// Wait until the previous save is finished, so the saves are written in order.
+	finishSave();
+
+	// Charts that were not opened yet are parsed here, so their notes are sanitized on this thread.
+	mySimfile->loadNotes();
+
+	// Charts that are saved for the first time get a revision, so they can be cached from now on.
+	for(auto chart : mySimfile->charts)
+	{
+		if(chart->revision == 0) chart->markModified();
+	}
+
+	// Save a copy of the simfile in the background, edits made in the meantime are not saved.
+	auto snapshot = new Simfile;
+	snapshot->copy(mySimfile);
+	mySaveThread = new SaveThread(snapshot, &myChartCache, format, myBackupOnSave);
+	mySaveThread->start();
 	myBackupOnSave = false;
 
-	gHistory->onFileSaved();
+	gHistory->onFileSaveStarted();
+
+	return true;
+}
+
+void finishSave()
+{
+	if(!mySaveThread) return;
+
+	String file = mySaveThread->simfile->file;
+	bool success = mySaveThread->success;
+	delete mySaveThread;
+	mySaveThread = nullptr;
 
-	return result;
+	// The history is only marked as saved once the file is written completely.
+	if(success)
+	{
+		gHistory->onFileSaved();
+		HudInfo("Saved: %s", file.str());
+	}
+	else
+	{
+		HudError("Could not save %s", file.str());
+	}
+}
+
+void tick()
+{
+	if(mySaveThread && mySaveThread->isDone())
+	{
+		finishSave();
+	}
 }
 
 void close()
 {
 	if(!mySimfile) return;
 
+	// Finish saving before the cached charts are released.
+	finishSave();
+	myChartCache.entries.clear();
+
 	delete mySimfile;
 	mySimfile = nullptr;
 
@@ -550,6 +635,11 @@ void previousChart()
 	openChart(myChartIndex - 1);
 }
 
+void loadNotes()
+{
+	if(mySimfile) mySimfile->loadNotes();
+}
+
 // ================================================================================================
 // SimfileManImpl :: get functions.
 
@@ -16,9 +16,13 @@ struct SimfileMan
 	/// Loads a new simfile from file and opens it for editing.
 	virtual bool load(StringRef path) = 0;
 
-	/// Saves the simfile that is currently open for editing.
+	/// Saves the simfile that is currently open for editing. The simfile is copied, and the copy is
+	/// written to disk in the background.
 	virtual bool save(StringRef dir, StringRef name, SimFormat format) = 0;
 
+	/// Reports the result of a background save once it is done.
+	virtual void tick() = 0;
+
 	/// Closes the simfile that is currently open for editing.
 	virtual void close() = 0;
 
@@ -46,6 +50,9 @@ struct SimfileMan
 	/// Opens the previous chart in the simfile for editing.
 	virtual void previousChart() = 0;
 
+	/// Parses the note data of the charts that have not been opened yet, see Chart::loadNotes.
+	virtual void loadNotes() = 0;
+
 	/// Returns the directory of the active simfile.
 	virtual String getDir() const = 0;
 
@@ -66,10 +66,15 @@ TempoManImpl()
 {
 	myUpdateTimingData();
 
-	myApplyOffsetId     = gHistory->addCallback(ApplyOffset);
-	myApplySegmentsId   = gHistory->addCallback(ApplySegments);
+	myApplyOffsetId     = gHistory->addCallback(ApplyOffset, nullptr, MergeOffset);
+	myApplySegmentsId   = gHistory->addCallback(ApplySegments, nullptr, MergeSegments);
 	myApplyInsertRowsId = gHistory->addCallback(ApplyInsertRows);
 	myApplyDisplayBpmId = gHistory->addCallback(ApplyDisplayBpm);
+
+	// Insert rows edits store the tempos they affect, so they are not written to the journal.
+	gHistory->enableJournal(myApplyOffsetId);
+	gHistory->enableJournal(myApplySegmentsId);
+	gHistory->enableJournal(myApplyDisplayBpmId);
 }
 
 // ================================================================================================
@@ -96,6 +101,38 @@ void myUpdateTimingData()
 
 }
 
+// Updates the timing data after changes to segments on or after the given row.
+void myUpdateTimingData(int firstChangedRow)
+{
+	const Tempo* tempo = myTweakTempo ? myTweakTempo : myTempo;
+	if(!tempo)
+	{
+		myUpdateTimingData();
+		return;
+	}
+
+	int changedRow = myTimingData.update(tempo, firstChangedRow);
+	if(gNotes) gNotes->updateTempo(changedRow);
+
+	gEditor->reportChanges(VCM_TEMPO_CHANGED);
+}
+
+// Updates the timing data after a change of the offset.
+void myUpdateTimingOffset()
+{
+	const Tempo* tempo = myTweakTempo ? myTweakTempo : myTempo;
+	double shift;
+	if(!tempo || !myTimingData.updateOffset(tempo, shift))
+	{
+		myUpdateTimingData();
+		return;
+	}
+
+	if(gNotes) gNotes->updateTempoOffset(shift);
+
+	gEditor->reportChanges(VCM_TEMPO_CHANGED);
+}
+
 void update(Simfile* sim, Chart* chart)
 {
 	myChart = chart;
@@ -122,24 +159,53 @@ void update(Simfile* sim, Chart* chart)
 // ================================================================================================
 // TempoManImpl :: edit helper functions.
 
+// Marks the chart that owns the given tempo as modified, the simfile tempo is not part of a chart.
+void myMarkModified(Tempo* tempo)
+{
+	if(!mySimfile) return;
+	for(auto chart : mySimfile->charts)
+	{
+		if(chart->tempo == tempo) chart->markModified();
+	}
+}
+
 void myStartEdit(Tempo* tempo)
 {
+	myMarkModified(tempo);
 	if(myTempo == tempo)
 	{
 		stopTweaking(false);
 	}
 }
 
-void myFinishEdit(Tempo* tempo)
+void myFinishEdit(Tempo* tempo, int firstChangedRow)
 {
 	tempo->sanitize();
 	if(myTempo == tempo)
 	{
-		myUpdateTimingData();
-		gEditor->reportChanges(VCM_TEMPO_CHANGED);
+		myUpdateTimingData(firstChangedRow);
 	}
 }
 
+void myFinishOffsetEdit(Tempo* tempo)
+{
+	if(myTempo == tempo)
+	{
+		myUpdateTimingOffset();
+	}
+}
+
+// Returns the first row of the segments in the given group.
+static int FirstRow(const SegmentGroup& group)
+{
+	int row = INT_MAX;
+	for(auto& list : group)
+	{
+		if(list.size()) row = min(row, list.begin()->row);
+	}
+	return row;
+}
+
 // ================================================================================================
 // TempoManImpl :: apply segments.
 
@@ -228,7 +294,7 @@ String myApplySegments(Tempo* out, ReadStream& in, bool undo, bool redo)
 			out->segments->insert(add);
 			
 		}
-		myFinishEdit(out);
+		myFinishEdit(out, min(FirstRow(add), FirstRow(rem)));
 	}
 	return msg;
 }
@@ -238,6 +304,36 @@ static String ApplySegments(ReadStream& in, History::Bindings bound, bool undo,
 	return TEMPO_MAN->myApplySegments(bound.tempo, in, undo, redo);
 }
 
+// Merges two segment edits if the second edit removes exactly the segments that were added by the
+// first edit, which is the case when the same segments are adjusted repeatedly.
+static bool MergeSegments(ReadStream& prev, ReadStream& next, WriteStream& out)
+{
+	SegmentGroup add1, rem1, add2, rem2;
+	const uchar* add1Begin = prev.pos();
+	add1.decode(prev);
+	const uchar* rem1Begin = prev.pos();
+	rem1.decode(prev);
+	const uchar* rem1End = prev.pos();
+
+	const uchar* add2Begin = next.pos();
+	add2.decode(next);
+	const uchar* rem2Begin = next.pos();
+	rem2.decode(next);
+	const uchar* rem2End = next.pos();
+
+	if(!prev.success() || !next.success()) return false;
+
+	int add1Size = (int)(rem1Begin - add1Begin);
+	if(add1Size != rem2End - rem2Begin || memcmp(add1Begin, rem2Begin, add1Size) != 0)
+	{
+		return false;
+	}
+
+	out.write(add2Begin, (int)(rem2Begin - add2Begin));
+	out.write(rem1Begin, (int)(rem1End - rem1Begin));
+	return true;
+}
+
 // ================================================================================================
 // TempoManImpl :: apply insert rows.
 
@@ -351,7 +447,7 @@ String myApplyInsertRows(ReadStream& in, bool undo, bool redo)
 		{
 			myApplyInsertRowsOffset(target, startRow, numRows);
 		}
-		myFinishEdit(target);
+		myFinishEdit(target, startRow);
 		
 		target = in.read<Tempo*>();
 	}
@@ -390,7 +486,7 @@ String myApplyOffset(Tempo* out, ReadStream& in, bool undo, bool redo)
 
 		myStartEdit(out);
 		out->offset = newOffset;
-		myFinishEdit(out);
+		myFinishOffsetEdit(out);
 	}
 	return msg;
 }
@@ -400,6 +496,16 @@ static String ApplyOffset(ReadStream& in, History::Bindings bound, bool undo, bo
 	return TEMPO_MAN->myApplyOffset(bound.tempo, in, undo, redo);
 }
 
+static bool MergeOffset(ReadStream& prev, ReadStream& next, WriteStream& out)
+{
+	auto before = prev.read<double>();
+	next.skip(sizeof(double));
+	auto after = next.read<double>();
+	out.write(before);
+	out.write(after);
+	return prev.success() && next.success();
+}
+
 // ================================================================================================
 // TempoManImpl :: display BPM edit functions.
 
@@ -429,6 +535,7 @@ String myApplyDisplayBpm(Tempo* tempo, ReadStream& in, bool undo, bool redo)
 		
 		tempo->displayBpmType = value.type;
 		tempo->displayBpmRange = value.range;
+		myMarkModified(tempo);
 		gEditor->reportChanges(VCM_SONG_PROPERTIES_CHANGED);
 	}
 	return msg;
@@ -675,18 +782,18 @@ void setTweakValue(double value)
 	if(myTweakMode == TWEAK_OFFSET)
 	{
 		myTweakTempo->offset = value;
+		myUpdateTimingOffset();
 	}
 	else if(myTweakMode == TWEAK_BPM)
 	{
 		myTweakTempo->segments->insert(BpmChange(myTweakRow, value));
+		myUpdateTimingData(myTweakRow);
 	}
 	else if(myTweakMode == TWEAK_STOP)
 	{
 		myTweakTempo->segments->insert(Stop(myTweakRow, value));
+		myUpdateTimingData(myTweakRow);
 	}
-
-	myUpdateTimingData();
-	gEditor->reportChanges(VCM_TEMPO_CHANGED);
 }
 
 void stopTweaking(bool apply)
@@ -722,8 +829,15 @@ void stopTweaking(bool apply)
 		}
 	}
 
-	myUpdateTimingData();
-	gEditor->reportChanges(VCM_TEMPO_CHANGED);
+	// Return to the timing of the active tempo, which only differs from the tweak at the tweak row.
+	if(mode == TWEAK_OFFSET)
+	{
+		myUpdateTimingOffset();
+	}
+	else
+	{
+		myUpdateTimingData(row);
+	}
 }
 
 // ================================================================================================
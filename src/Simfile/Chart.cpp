@@ -8,11 +8,15 @@
 
 namespace Vortex {
 
+static uint sLastRevision = 0;
+
 Chart::Chart()
 	: style(nullptr)
 	, difficulty(DIFF_BEGINNER)
 	, meter(1)
 	, tempo(nullptr)
+	, deferred(nullptr)
+	, revision(0)
 {
 }
 
@@ -22,6 +26,31 @@ Chart::~Chart()
 	difficulty = DIFF_BEGINNER;
 	meter = 1;
 	delete tempo;
+	delete deferred;
+}
+
+void Chart::copy(const Chart* other)
+{
+	style = other->style;
+	artist = other->artist;
+	difficulty = other->difficulty;
+	radar = other->radar;
+	meter = other->meter;
+
+	notes = other->notes;
+
+	delete tempo;
+	tempo = nullptr;
+	if(other->tempo)
+	{
+		tempo = new Tempo;
+		tempo->copy(other->tempo);
+	}
+
+	delete deferred;
+	deferred = other->deferred ? other->deferred->clone() : nullptr;
+
+	revision = other->revision;
 }
 
 String Chart::description() const
@@ -46,6 +75,8 @@ const Tempo* Chart::getTempo(const Simfile* simfile) const
 
 int Chart::stepCount() const
 {
+	if(deferred) return deferred->stepCount;
+
 	int count = 0;
 	for(auto& note : notes)
 	{
@@ -54,6 +85,24 @@ int Chart::stepCount() const
 	return count;
 }
 
+bool Chart::hasDeferredNotes() const
+{
+	return deferred != nullptr;
+}
+
+void Chart::loadNotes()
+{
+	if(deferred)
+	{
+		DeferredNotes* data = deferred;
+		deferred = nullptr;
+		data->load(this);
+		delete data;
+
+		if(style) notes.sanitize(this);
+	}
+}
+
 void Chart::sanitize()
 {
 	if(!style)
@@ -72,7 +121,12 @@ void Chart::sanitize()
 		tempo->sanitize(this);
 	}
 		
-	notes.sanitize(this);
+	if(!deferred) notes.sanitize(this);
+}
+
+void Chart::markModified()
+{
+	revision = ++sLastRevision;
 }
 
 static const char* DifficultyNames[NUM_DIFFICULTIES] =
@@ -8,12 +8,31 @@
 
 namespace Vortex {
 
+/// Note data of a chart that has not been parsed yet. Loaders can defer parsing the notes until the
+/// chart is opened, since most charts of a simfile are never opened in an editing session.
+struct DeferredNotes
+{
+	virtual ~DeferredNotes() {}
+
+	// Parses the note data and writes the notes to the given chart.
+	virtual void load(Chart* chart) = 0;
+
+	// Returns a copy of the unparsed note data.
+	virtual DeferredNotes* clone() const = 0;
+
+	// Number of notes in the note data, excluding mines, counted without parsing the notes.
+	int stepCount;
+};
+
 /// Holds data for a chart.
 struct Chart : NonCopyable
 {
 	Chart();
 	~Chart();
 
+	// Copies the data of another chart, including its deferred notes.
+	void copy(const Chart* other);
+
 	// Returns the difficulty and meter of the chart (e.g. "Challenge 12").
 	String description() const;
 
@@ -29,9 +48,20 @@ struct Chart : NonCopyable
 	// Returns the total number of notes in the chart, excluding mines.
 	int stepCount() const;
 
-	// Sanitizes the notes and tempo, and makes sure the chart parameters are valid.
+	// Returns true if the note data of the chart has not been parsed yet.
+	bool hasDeferredNotes() const;
+
+	// Parses and sanitizes the note data if it was deferred, otherwise it does nothing.
+	void loadNotes();
+
+	// Sanitizes the notes and tempo, and makes sure the chart parameters are valid. Deferred notes
+	// are sanitized when they are loaded.
 	void sanitize();
 
+	// Gives the chart a new revision number. Should be called whenever the chart properties, notes or
+	// chart tempo are modified.
+	void markModified();
+
 	const Style* style;
 	String artist;
 	Difficulty difficulty;
@@ -40,6 +70,11 @@ struct Chart : NonCopyable
 
 	NoteList notes;
 	Tempo* tempo;
+	DeferredNotes* deferred;
+
+	// Identifies the state of the chart data, which is unique among all charts. Zero if the chart
+	// has not been given a revision yet. Used to reuse the serialized chart when saving.
+	uint revision;
 };
 
 // Returns the name of the given difficulty type.
@@ -137,7 +137,8 @@ static char* ReadNoteRow(char* p, NoteList& out, int row, const int* map, int* h
 		{
 			if(holds[col])
 			{
-				auto hold = out.begin() + holds[col] - 1;
+				// The hold is close to the end of the list, so it is found from the end.
+				auto hold = out.end() - (out.size() - holds[col] + 1);
 				hold->endrow = row;
 				hold->type = NOTE_STEP_OR_HOLD;
 				holds[col] = 0;
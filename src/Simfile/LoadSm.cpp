@@ -1,6 +1,5 @@
 ﻿#include <Core/Core.h>
 
-#include <map>
 #include <algorithm>
 #include <numeric>
 
@@ -9,6 +8,7 @@
 
 #include <System/Debug.h>
 #include <System/File.h>
+#include <System/Thread.h>
 
 #include <Simfile/Parsing.h>
 #include <Simfile/Simfile.h>
@@ -26,7 +26,7 @@ namespace Sm {
 
 struct ParseData;
 
-#define PARSE_ARGS ParseData& data, StringRef tag, char* str
+#define PARSE_ARGS ParseData& data, const char* tag, char* str
 
 typedef void(*ParseFunc)(PARSE_ARGS);
 
@@ -34,17 +34,27 @@ static const int MEASURE_SUBDIV[] = { 4, 8, 12, 16, 24, 32, 48, 64, 96, 192 };
 static const int NUM_MEASURE_SUBDIV = 10;
 static const int ROWS_PER_NOTE_SECTION = 192;
 
+// The note data of a chart, which is parsed after all tags have been read.
+struct NoteBlock
+{
+	Chart* chart;
+	String styleId;
+	char* notes;
+	int numCols;
+	int numPlayers;
+	int numKeySounds;
+};
+
 struct ParseData
 {
 	bool isSM5;
+	bool deferNotes;
 	int numKeySounds;
 
 	Simfile* sim;
 	Chart* chart;
 	String styleId;
-
-	std::map<String, String*> simMap1;
-	std::map<String, ParseFunc> simMap2, chartMap;
+	Vector<NoteBlock> noteBlocks;
 
 	Tempo* tempo();
 };
@@ -313,11 +323,11 @@ static void ParseBgChanges(PARSE_ARGS)
 		change.file = v[1];
 		ParseVal(v[0], change.startBeat);
 	
-		if(tag == "FGCHANGES")
+		if(Str::equal(tag, "FGCHANGES"))
 		{
 			data.sim->fgChanges.push_back(change);
 		}
-		else if(tag == "BGCHANGES2")
+		else if(Str::equal(tag, "BGCHANGES2"))
 		{
 			data.sim->bgChanges[1].push_back(change);
 		}
@@ -401,7 +411,8 @@ static void ReadNoteRow(ReadNoteData& data, int row, char* p, int quantization)
 			int holdPos = data.holdPos[col];
 			if(holdPos)
 			{
-				auto* hold = data.notes->begin() + holdPos - 1;
+				// The hold is close to the end of the list, so it is found from the end.
+				auto hold = data.notes->end() - (data.notes->size() - holdPos + 1);
 				hold->endrow = row;
 				hold->type = data.holdType[col];
 				// Make sure we set the note to its largest quantization to avoid data loss
@@ -433,8 +444,12 @@ static void ReadNoteRow(ReadNoteData& data, int row, char* p, int quantization)
 	}
 }
 
-static void ParseNotes(ParseData& data, Chart* chart, StringRef style, char* notes)
+// Reads the notes of a chart. Only touches the chart and the block, so the charts of a simfile can
+// be parsed on several threads at once.
+static void ParseNoteBlock(NoteBlock& block)
 {
+	Chart* chart = block.chart;
+	char* notes = block.notes;
 	char* p = notes;
 
 	// Derive the column count from the first note row.
@@ -493,7 +508,7 @@ static void ParseNotes(ParseData& data, Chart* chart, StringRef style, char* not
 		{
 			if(*read == '[')
 			{
-				++data.numKeySounds;
+				++block.numKeySounds;
 				while(*read && *read != ']') ++read;
 			}
 			else if(*read != ' ' && *read != '\n')
@@ -568,8 +583,131 @@ static void ParseNotes(ParseData& data, Chart* chart, StringRef style, char* not
 		std::sort(chart->notes.begin(), chart->notes.end(), LessThanRowCol<Note, Note>);
 	}
 
-	// Find a style for the chart based on the style id, columns, and players.
-	chart->style = gStyle->findStyle(chart->description(), numCols, numPlayers, style);
+	block.numCols = numCols;
+	block.numPlayers = numPlayers;
+}
+
+struct NoteBlockThreads : public ParallelThreads
+{
+	NoteBlock* blocks;
+	void exec(int item, int thread) override
+	{
+		ParseNoteBlock(blocks[item]);
+	}
+};
+
+// Note data that is parsed when the chart is opened.
+struct SmDeferredNotes : public DeferredNotes
+{
+	String text;
+	void load(Chart* chart) override
+	{
+		NoteBlock block = {chart, String(), text.begin(), 0, 0, 0};
+		ParseNoteBlock(block);
+	}
+	DeferredNotes* clone() const override
+	{
+		return new SmDeferredNotes(*this);
+	}
+};
+
+struct NoteScanTables
+{
+	uchar isStep[256];
+	uchar isSpecial[256];
+	NoteScanTables() : isStep(), isSpecial()
+	{
+		for(uchar c : {'1', '2', '4', 'L', 'F'}) isStep[c] = 1;
+		isSpecial['&'] = isSpecial['['] = 1;
+	}
+};
+static const NoteScanTables NoteScanTable;
+
+// Determines the column count, player count, keysound count and step count of a chart, without
+// reading the notes. This is a lot faster than parsing, since it is a single pass over the text.
+static void ScanNoteBlock(NoteBlock& block, int& outStepCount)
+{
+	const char* p = block.notes;
+
+	int numCols = 0;
+	while(*p == ' ' || *p == '\n') ++p;
+	for(; *p && *p != '\n'; ++p)
+	{
+		if(*p == '[')
+		{
+			while(*p && *p != ']') ++p;
+		}
+		else
+		{
+			++numCols;
+		}
+	}
+
+	// Steps are counted without branches, since they are too frequent to predict.
+	int numPlayers = 1, numKeySounds = 0, stepCount = 0;
+	for(p = block.notes; *p; ++p)
+	{
+		uchar c = (uchar)*p;
+		stepCount += NoteScanTable.isStep[c];
+		if(NoteScanTable.isSpecial[c])
+		{
+			if(c == '&')
+			{
+				++numPlayers;
+			}
+			else
+			{
+				++numKeySounds;
+				while(p[1] && *p != ']') ++p;
+			}
+		}
+	}
+
+	block.numCols = numCols;
+	block.numPlayers = numPlayers;
+	block.numKeySounds = numKeySounds;
+	outStepCount = stepCount;
+}
+
+static void ParseNoteBlocks(ParseData& data)
+{
+	auto& blocks = data.noteBlocks;
+	int numThreads = min(blocks.size(), ParallelThreads::concurrency());
+	if(data.deferNotes)
+	{
+		// Only scan the note data, the notes are parsed when the chart is opened.
+		for(auto& block : blocks)
+		{
+			auto deferred = new SmDeferredNotes;
+			ScanNoteBlock(block, deferred->stepCount);
+			deferred->text = block.notes;
+			block.chart->deferred = deferred;
+		}
+	}
+	else if(numThreads > 1)
+	{
+		NoteBlockThreads threads;
+		threads.blocks = blocks.data();
+		threads.run(blocks.size(), numThreads);
+	}
+	else
+	{
+		for(auto& block : blocks)
+		{
+			ParseNoteBlock(block);
+		}
+	}
+
+	// Styles are found and charts are added in file order, since finding a style can create one.
+	for(auto& block : blocks)
+	{
+		auto chart = block.chart;
+		chart->style = gStyle->findStyle(chart->description(), block.numCols, block.numPlayers,
+			block.styleId);
+		data.sim->charts.push_back(chart);
+		data.numKeySounds += block.numKeySounds;
+	}
+	blocks.clear();
 }
 
 static void ParseNotes(PARSE_ARGS)
@@ -611,10 +749,8 @@ static void ParseNotes(PARSE_ARGS)
 		// Stepmania 5 notes format.
 		notes = params[0];
 	}
-	ParseNotes(data, data.chart, data.styleId, notes);
-
-	// Add the chart to the chart list.
-	data.sim->charts.push_back(data.chart);
+	// The notes are parsed once all tags have been read.
+	data.noteBlocks.push_back({data.chart, data.styleId, notes, 0, 0, 0});
 	data.chart = nullptr;
 	data.styleId.clear();
 }
@@ -622,9 +758,6 @@ static void ParseNotes(PARSE_ARGS)
 // ================================================================================================
 // Tag parsing.
 
-typedef std::map<String, String*> StrMap;
-typedef std::map<String, ParseFunc> FuncMap;
-
 String UnescapeTag(String s)
 {
 	Str::replace(s, "\\\\", "\\");
@@ -634,99 +767,151 @@ String UnescapeTag(String s)
 	return s;
 }
 
-static void MapSharedTags(FuncMap& map)
+static void ParseVersion(PARSE_ARGS)      { data.isSM5 = true; }
+static void ParseSampleStart(PARSE_ARGS)  { ParseVal(str, data.sim->previewStart); }
+static void ParseSampleLength(PARSE_ARGS) { ParseVal(str, data.sim->previewLength); }
+static void ParseSelectable(PARSE_ARGS)   { ParseBool(str, data.sim->isSelectable); }
+static void ParseNoteData(PARSE_ARGS)     { data.chart = new Chart; }
+
+static void ParseDescription(PARSE_ARGS)  { data.chart->artist = UnescapeTag(str); }
+static void ParseDifficulty(PARSE_ARGS)   { data.chart->difficulty = ToDiff(str); }
+static void ParseMeter(PARSE_ARGS)        { ParseVal(str, data.chart->meter); }
+static void ParseRadarValues(PARSE_ARGS)  { ParseRadar(data.chart, str); }
+static void ParseStepsType(PARSE_ARGS)    { data.styleId = str; }
+
+struct TagInfo
 {
-	map["OFFSET"] = ParseOffset;
+	const char* name;
+	String Simfile::* simString; // Simfile property that is set outside of charts, or null.
+	ParseFunc simFunc;           // Parse function outside of charts, or null.
+	ParseFunc chartFunc;         // Parse function inside of charts, or null.
+};
 
-	map["BPMS"] = ParseBpms;
-	map["STOPS"] = ParseStops;
-	map["DELAYS"] = ParseDelays;
-	map["WARPS"] = ParseWarps;
-	map["SPEEDS"] = ParseSpeeds;
-	map["SCROLLS"] = ParseScrolls;
-	map["TICKCOUNTS"] = ParseTickCounts;
-	map["TIMESIGNATURES"] = ParseTimeSignatures;
+static constexpr TagInfo Tags[] =
+{
+	// Shared tags.
+	{"OFFSET",           nullptr, ParseOffset,         ParseOffset},
+	{"BPMS",             nullptr, ParseBpms,           ParseBpms},
+	{"STOPS",            nullptr, ParseStops,          ParseStops},
+	{"DELAYS",           nullptr, ParseDelays,         ParseDelays},
+	{"WARPS",            nullptr, ParseWarps,          ParseWarps},
+	{"SPEEDS",           nullptr, ParseSpeeds,         ParseSpeeds},
+	{"SCROLLS",          nullptr, ParseScrolls,        ParseScrolls},
+	{"TICKCOUNTS",       nullptr, ParseTickCounts,     ParseTickCounts},
+	{"TIMESIGNATURES",   nullptr, ParseTimeSignatures, ParseTimeSignatures},
+	{"LABELS",           nullptr, ParseLabels,         ParseLabels},
+	{"ATTACKS",          nullptr, ParseAttacks,        ParseAttacks},
+	{"KEYSOUNDS",        nullptr, ParseKeySounds,      ParseKeySounds},
+	{"COMBOS",           nullptr, ParseCombos,         ParseCombos},
+	{"FAKES",            nullptr, ParseFakes,          ParseFakes},
+	{"DISPLAYBPM",       nullptr, ParseDisplayBpm,     ParseDisplayBpm},
+	{"NOTES",            nullptr, ParseNotes,          ParseNotes},
+	{"NOTES2",           nullptr, ParseNotes,          ParseNotes},
+
+	// Simfile tags.
+	{"TITLE",            &Simfile::title,      nullptr, nullptr},
+	{"TITLETRANSLIT",    &Simfile::titleTr,    nullptr, nullptr},
+	{"SUBTITLE",         &Simfile::subtitle,   nullptr, nullptr},
+	{"SUBTITLETRANSLIT", &Simfile::subtitleTr, nullptr, nullptr},
+	{"ARTIST",           &Simfile::artist,     nullptr, nullptr},
+	{"ARTISTTRANSLIT",   &Simfile::artistTr,   nullptr, nullptr},
+	{"GENRE",            &Simfile::genre,      nullptr, nullptr},
+	{"CREDIT",           &Simfile::credit,     nullptr, nullptr},
+	{"MUSIC",            &Simfile::music,      nullptr, nullptr},
+	{"BANNER",           &Simfile::banner,     nullptr, nullptr},
+	{"BACKGROUND",       &Simfile::background, nullptr, nullptr},
+	{"CDTITLE",          &Simfile::cdTitle,    nullptr, nullptr},
+	{"LYRICSPATH",       &Simfile::lyricsPath, nullptr, nullptr},
+	{"FGCHANGES",        nullptr, ParseBgChanges,      nullptr},
+	{"BGCHANGES",        nullptr, ParseBgChanges,      nullptr},
+	{"BGCHANGES1",       nullptr, ParseBgChanges,      nullptr},
+	{"BGCHANGES2",       nullptr, ParseBgChanges,      nullptr},
+	{"VERSION",          nullptr, ParseVersion,        nullptr},
+	{"SAMPLESTART",      nullptr, ParseSampleStart,    nullptr},
+	{"SAMPLELENGTH",     nullptr, ParseSampleLength,   nullptr},
+	{"SELECTABLE",       nullptr, ParseSelectable,     nullptr},
+	{"NOTEDATA",         nullptr, ParseNoteData,       nullptr},
+
+	// Chart tags.
+	{"DESCRIPTION",      nullptr, nullptr, ParseDescription},
+	{"DIFFICULTY",       nullptr, nullptr, ParseDifficulty},
+	{"METER",            nullptr, nullptr, ParseMeter},
+	{"RADARVALUES",      nullptr, nullptr, ParseRadarValues},
+	{"STEPSTYPE",        nullptr, nullptr, ParseStepsType},
+};
 
-	map["LABELS"] = ParseLabels;
-	map["ATTACKS"] = ParseAttacks;
-	map["KEYSOUNDS"] = ParseKeySounds;
-	map["COMBOS"] = ParseCombos;
-	map["FAKES"] = ParseFakes;
-	map["DISPLAYBPM"] = ParseDisplayBpm;
+static constexpr int NumTags = sizeof(Tags) / sizeof(Tags[0]);
 
-	map["NOTES"] = ParseNotes;
-	map["NOTES2"] = ParseNotes;
-}
+// The tags are found through a perfect hash, which maps every tag name to its own slot. The seed is
+// chosen so that the names do not collide, which is checked at compile time.
+static constexpr uint TagHashSeed = 17;
+static constexpr int TagSlotBits = 8;
 
-static void MapSimfileTags(StrMap& str, FuncMap& map, Simfile* sim)
-{
-	MapSharedTags(map);
-
-	str["TITLE"] = &sim->title;
-	str["TITLETRANSLIT"] = &sim->titleTr;
-	str["SUBTITLE"] = &sim->subtitle;
-	str["SUBTITLETRANSLIT"] = &sim->subtitleTr;
-	str["ARTIST"] = &sim->artist;
-	str["ARTISTTRANSLIT"] = &sim->artistTr;
-	str["GENRE"] = &sim->genre;
-	str["CREDIT"] = &sim->credit;
-	str["MUSIC"] = &sim->music;
-	str["BANNER"] = &sim->banner;
-	str["BACKGROUND"] = &sim->background;
-	str["CDTITLE"] = &sim->cdTitle;
-	str["LYRICSPATH"] = &sim->lyricsPath;
-
-	map["FGCHANGES"] = ParseBgChanges;
-	map["BGCHANGES"] = ParseBgChanges;
-	map["BGCHANGES1"] = ParseBgChanges;
-	map["BGCHANGES2"] = ParseBgChanges;
-
-	map["VERSION"]      = [](PARSE_ARGS) { data.isSM5 = true; };
-	map["SAMPLESTART"]  = [](PARSE_ARGS) { ParseVal(str, data.sim->previewStart); };
-	map["SAMPLELENGTH"] = [](PARSE_ARGS) { ParseVal(str, data.sim->previewLength); };
-	map["SELECTABLE"]   = [](PARSE_ARGS) { ParseBool(str, data.sim->isSelectable); };
-
-	map["NOTEDATA"] = [](PARSE_ARGS) { data.chart = new Chart; };
+static constexpr int GetTagSlot(const char* tag)
+{
+	uint hash = TagHashSeed;
+	for(; *tag; ++tag) hash = (hash ^ (uchar)*tag) * 16777619u;
+	return (int)(hash >> (32 - TagSlotBits));
 }
 
-static void MapChartTags(FuncMap& map)
+struct TagTable
 {
-	MapSharedTags(map);
+	uchar slots[1 << TagSlotBits]; // Index of the tag plus one, zero means there is no tag.
 
-	map["DESCRIPTION"]  = [](PARSE_ARGS) { data.chart->artist = UnescapeTag(str); };
-	map["DIFFICULTY"]   = [](PARSE_ARGS) { data.chart->difficulty = ToDiff(str); };
-	map["METER"]        = [](PARSE_ARGS) { ParseVal(str, data.chart->meter); };
-	map["RADARVALUES"]  = [](PARSE_ARGS) { ParseRadar(data.chart, str); };
-	map["STEPSTYPE"]    = [](PARSE_ARGS) { data.styleId = str; };
-}
+	constexpr TagTable() : slots()
+	{
+		for(int i = 0; i < NumTags; ++i)
+		{
+			slots[GetTagSlot(Tags[i].name)] = (uchar)(i + 1);
+		}
+	}
+};
 
-static void ParseTag(ParseData& data, String tag, char* val)
+static constexpr bool TagSlotsAreUnique()
 {
-	if(data.chart)
+	for(int i = 0; i < NumTags; ++i)
 	{
-		// Check if the tag is in the chart function map.
-		auto func = data.chartMap.find(tag);
-		if(func != data.chartMap.end())
+		for(int j = i + 1; j < NumTags; ++j)
 		{
-			func->second(data, tag, val);
-			return;
+			if(GetTagSlot(Tags[i].name) == GetTagSlot(Tags[j].name)) return false;
 		}
 	}
-	else
+	return true;
+}
+
+static_assert(TagSlotsAreUnique(), "Tag names collide, pick a different TagHashSeed.");
+
+static constexpr TagTable TagSlots;
+
+// Returns the tag with the given name, or null if the tag is not recognized.
+static const TagInfo* FindTag(const char* name)
+{
+	int index = TagSlots.slots[GetTagSlot(name)] - 1;
+	if(index >= 0 && Str::equal(Tags[index].name, name)) return Tags + index;
+	return nullptr;
+}
+
+static void ParseTag(ParseData& data, const char* tag, char* val)
+{
+	auto info = FindTag(tag);
+	if(info)
 	{
-		// Check if the tag is in the sim string map.
-		auto str = data.simMap1.find(tag);
-		if(str != data.simMap1.end())
+		if(data.chart)
+		{
+			if(info->chartFunc)
+			{
+				info->chartFunc(data, tag, val);
+				return;
+			}
+		}
+		else if(info->simString)
 		{
-			*str->second = UnescapeTag(val);
+			data.sim->*info->simString = UnescapeTag(val);
 			return;
 		}
-
-		// Check if the tag is in the sim function map.
-		auto func = data.simMap2.find(tag);
-		if(func != data.simMap2.end())
+		else if(info->simFunc)
 		{
-			func->second(data, tag, val);
+			info->simFunc(data, tag, val);
 			return;
 		}
 	}
@@ -738,29 +923,30 @@ static void ParseTag(ParseData& data, String tag, char* val)
 // ===================================================================================
 // File importing
 
-bool LoadSm(StringRef path, Simfile* sim)
+bool LoadSm(StringRef path, Simfile* sim, bool deferNotes)
 {
 	ParseData data;
 
 	data.sim = sim;
 	data.chart = nullptr;
+	data.deferNotes = deferNotes;
 	data.isSM5 = Str::endsWith(path, ".ssc", false);
 	data.numKeySounds = 0;
 
-	MapSimfileTags(data.simMap1, data.simMap2, sim);
-	MapChartTags(data.chartMap);
-
 	// Read the file.
-	String str;
-	if(!ParseSimfile(str, path)) return false;
+	String buffer;
+	Vector<SimfileTag> tags;
+	if(!TokenizeSimfile(path, buffer, tags)) return false;
 
-	// Read the tags.
-	char* tag, *val, *p = str.begin();
-	while(ParseNextTag(p, tag, val))
+	// Parse the tags.
+	for(auto& tag : tags)
 	{
-		ParseTag(data, tag, val);
+		ParseTag(data, tag.tag, tag.val);
 	}
 
+	// Parse the note data of the charts.
+	ParseNoteBlocks(data);
+
 	// Show a warning if keysounds were present.
 	if(data.numKeySounds > 0)
 	{
@@ -15,62 +15,159 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 
 namespace Vortex {
 namespace {
 
+// Maximum number of notes in a block. Blocks that overflow are split into half full blocks, so the
+// next few insertions in the same area do not have to split them again.
+static const int BlockSize = 512;
+static const int HalfBlockSize = BlockSize / 2;
+
 inline int64_t NotePos(const Note* n)
 {
 	return ((int64_t)n->row << 8) | n->col;
 }
 
-template <typename T, typename R>
-inline bool ComesBefore(const T* a, const R* b)
+static bool LessSpan(const HoldSpan& a, const HoldSpan& b)
 {
-	return (a->row < b->row || (a->row == b->row && a->row < b->row));
+	if(a.col != b.col) return a.col < b.col;
+	if(a.row != b.row) return a.row < b.row;
+	return a.endrow < b.endrow;
+}
+
+static void ReserveBlock(NoteBlock& block, int num)
+{
+	if(block.cap < num)
+	{
+		block.cap = min(BlockSize, max(num, block.cap << 1));
+		block.notes = (Note*)realloc(block.notes, block.cap * sizeof(Note));
+	}
 }
 
 };
 
 // ================================================================================================
-// NoteNoteList :: destructor and constructors.
+// HoldIndex.
+
+void HoldIndex::clear()
+{
+	mySpans.release();
+}
+
+void HoldIndex::insert(Vector<HoldSpan>& spans)
+{
+	if(spans.empty()) return;
+
+	std::sort(spans.begin(), spans.end(), LessSpan);
+	Vector<HoldSpan> merged;
+	merged.resize(mySpans.size() + spans.size());
+	std::merge(mySpans.begin(), mySpans.end(), spans.begin(), spans.end(), merged.begin(), LessSpan);
+	mySpans.swap(merged);
+}
+
+void HoldIndex::remove(Vector<HoldSpan>& spans)
+{
+	if(spans.empty() || mySpans.empty()) return;
+
+	std::sort(spans.begin(), spans.end(), LessSpan);
+	auto rem = spans.begin(), remEnd = spans.end();
+	auto write = mySpans.begin();
+	for(auto& span : mySpans)
+	{
+		while(rem != remEnd && LessSpan(*rem, span)) ++rem;
+		if(rem != remEnd && !LessSpan(span, *rem))
+		{
+			++rem;
+			continue;
+		}
+		*write++ = span;
+	}
+	mySpans.resize(write - mySpans.begin());
+}
+
+void HoldIndex::offset(int startRow, int numRows)
+{
+	for(auto& span : mySpans)
+	{
+		if(span.row >= startRow) span.row += numRows;
+		if(span.endrow >= startRow) span.endrow += numRows;
+	}
+}
+
+const HoldSpan* HoldIndex::find(int col, int row) const
+{
+	HoldSpan key = {col, row, INT_MAX};
+	auto it = std::upper_bound(mySpans.begin(), mySpans.end(), key, LessSpan);
+	if(it != mySpans.begin() && (it - 1)->col == col && (it - 1)->endrow >= row)
+	{
+		return it - 1;
+	}
+	return nullptr;
+}
+
+int HoldIndex::firstRowReaching(int row) const
+{
+	int first = row;
+	auto it = mySpans.begin(), end = mySpans.end();
+	while(it != end)
+	{
+		// The last span of the column that starts before the row is the only one that can reach it.
+		int col = it->col;
+		HoldSpan key = {col, row, INT_MIN};
+		it = std::lower_bound(it, end, key, LessSpan);
+		if(it != mySpans.begin() && (it - 1)->col == col && (it - 1)->endrow >= row)
+		{
+			first = min(first, (it - 1)->row);
+		}
+		key = {col + 1, INT_MIN, INT_MIN};
+		it = std::lower_bound(it, end, key, LessSpan);
+	}
+	return first;
+}
+
+// ================================================================================================
+// NoteList :: destructor and constructors.
 
 NoteList::~NoteList()
 {
-	clear();
-	free(myNotes);
+	myFreeBlocks();
 }
 
 NoteList::NoteList()
-	: myNotes(nullptr)
-	, myNum(0)
-	, myCap(0)
+	: myNum(0)
+	, myHoldsValid(true)
 {
 }
 
 NoteList::NoteList(List&& list)
-	: myNotes(list.myNotes)
-	, myNum(list.myNum)
-	, myCap(list.myCap)
+	: myNum(list.myNum)
+	, myHoldsValid(list.myHoldsValid)
 {
-	list.myNotes = nullptr;
+	myBlocks.swap(list.myBlocks);
+	myHolds.swap(list.myHolds);
+	list.myNum = 0;
 }
 
 NoteList::NoteList(const List& list)
-	: myNotes(nullptr)
-	, myNum(0)
-	, myCap(0)
+	: myNum(0)
+	, myHoldsValid(true)
 {
 	assign(list);
 }
 
 NoteList& NoteList::operator = (List&& list)
 {
-	myNotes = list.myNotes;
+	myFreeBlocks();
+	myBlocks.swap(list.myBlocks);
 	myNum = list.myNum;
-	myCap = list.myCap;
+	myHolds.swap(list.myHolds);
+	myHoldsValid = list.myHoldsValid;
 
-	list.myNotes = nullptr;
+	list.myNum = 0;
+	list.myHolds.clear();
 
 	return *this;
 }
@@ -86,124 +183,154 @@ NoteList& NoteList::operator = (const List& list)
 
 void NoteList::clear()
 {
+	myFreeBlocks();
 	myNum = 0;
+	myHolds.clear();
+	myHoldsValid = true;
 }
 
 void NoteList::assign(const List& list)
 {
+	if(&list == this) return;
+
+	myFreeBlocks();
+	for(auto& block : list.myBlocks)
+	{
+		Block copy = {nullptr, 0, 0, block.start};
+		if(block.num > 0)
+		{
+			ReserveBlock(copy, block.num);
+			memcpy(copy.notes, block.notes, block.num * sizeof(Note));
+			copy.num = block.num;
+		}
+		myBlocks.push_back(copy);
+	}
 	myNum = list.myNum;
-	myReserve(myNum);
-	memcpy(myNotes, list.myNotes, myNum * sizeof(Note));
+	myHolds = list.myHolds;
+	myHoldsValid = list.myHoldsValid;
 }
 
 void NoteList::append(const Note& note)
 {
-	int index = myNum;
-	myReserve(++myNum);
-	myNotes[index] = note;
+	if(myBlocks.empty())
+	{
+		myBlocks.push_back({nullptr, 0, 0, 0});
+		myBlocks.push_back({nullptr, 0, 0, 0});
+	}
+	else if(myBlocks[myBlocks.size() - 2].num == BlockSize)
+	{
+		myBlocks.insert(myBlocks.size() - 1, {nullptr, 0, 0, myNum}, 1);
+	}
+
+	Block& block = myBlocks[myBlocks.size() - 2];
+	ReserveBlock(block, block.num + 1);
+	block.notes[block.num++] = note;
+	myBlocks.back().start = ++myNum;
+
+	// Appended holds are indexed when the index is used, since they are not sorted by column.
+	if(note.endrow > note.row)
+	{
+		myHoldsValid = false;
+	}
 }
 
 void NoteList::insert(const List& insert)
 {
 	if(insert.myNum == 0) return;
 
-	int newSize = myNum + insert.myNum;
-	myReserve(newSize);
-
-	// Work backwards, that way insertion can be done on the fly.
-	auto write = myNotes + newSize - 1;
-
-	auto read = myNotes + myNum - 1;
-	auto readEnd = myNotes - 1;
-
-	auto ins = insert.myNotes + insert.myNum - 1;
-	auto insEnd = insert.myNotes - 1;
+	if(myNum == 0)
+	{
+		assign(insert);
+		return;
+	}
 
-	while(read != readEnd)
+	Vector<HoldSpan> holds;
+	auto ins = insert.begin(), insEnd = insert.end();
+	int block = myFindBlock(NotePos(&*ins), 0);
+	int firstBlock = block;
+	while(ins != insEnd)
 	{
-		// Copy notes from the insert list.
-		int64_t readPos = NotePos(read);
-		while(ins != insEnd && NotePos(ins) > readPos)
+		// Notes that come before the first note of the next block are merged into this block.
+		int next = block + 1;
+		int64_t limit = (next < myBlocks.size() - 1) ? NotePos(myBlocks[next].notes) : INT64_MAX;
+		auto run = ins;
+		int num = 0;
+		for(; ins != insEnd && NotePos(&*ins) < limit; ++ins, ++num)
 		{
-			*write = *ins;
-			--write, --ins;
+			if(myHoldsValid && ins->endrow > ins->row)
+			{
+				holds.push_back({(int)ins->col, ins->row, ins->endrow});
+			}
 		}
-		if(ins == insEnd) break;
-
-		// Move existing notes.
-		int64_t insPos = NotePos(ins);
-		while(read != readEnd && NotePos(read) >= insPos)
+		myMergeIntoBlock(block, run, num);
+		if(ins != insEnd)
 		{
-			*write = *read;
-			--write, --read;
+			block = myFindBlock(NotePos(&*ins), block + 1);
 		}
 	}
 
-	// After read end is reached, there might still be some notes that need to be inserted.
-	while(ins != insEnd)
-	{
-		*write = *ins;
-		--write, --ins;
-	}
-
-	myNum = newSize;
+	myNum += insert.myNum;
+	myUpdateStarts(firstBlock);
+	myHolds.insert(holds);
 }
 
 void NoteList::remove(const List& remove)
 {
-	if(remove.myNum == 0) return;
-
-	// Work forwards from the first note.
-	auto it = myNotes;
-	auto itEnd = myNotes + myNum;
-
-	auto rem = remove.myNotes;
-	auto remEnd = remove.myNotes + remove.myNum;
-
-	// Invalidate the notes that have a matching note in the remove vector.
-	while(rem != remEnd)
+	if(remove.myNum == 0 || myNum == 0) return;
+
+	Vector<HoldSpan> holds;
+	auto rem = remove.begin(), remEnd = remove.end();
+	int numBlocks = myBlocks.size() - 1;
+	int block = myFindBlock(NotePos(&*rem), 0);
+	int firstBlock = block, lastBlock = block;
+	while(rem != remEnd && block < numBlocks)
 	{
-		int64_t remPos = NotePos(rem);
-		while(it != itEnd && NotePos(it) < remPos)
+		Block& b = myBlocks[block];
+		int next = block + 1;
+		int64_t limit = (next < numBlocks) ? NotePos(myBlocks[next].notes) : INT64_MAX;
+
+		// Invalidate the notes that have a matching note in the remove list.
+		auto it = b.notes, itEnd = b.notes + b.num;
+		for(; rem != remEnd && NotePos(&*rem) < limit; ++rem)
 		{
-			++it;
+			int64_t remPos = NotePos(&*rem);
+			while(it != itEnd && NotePos(it) < remPos)
+			{
+				++it;
+			}
+			if(it != itEnd && NotePos(it) == remPos)
+			{
+				if(myHoldsValid && it->endrow > it->row)
+				{
+					holds.push_back({(int)it->col, it->row, it->endrow});
+				}
+				it->row = -1;
+			}
 		}
-		if(it != itEnd && NotePos(it) == remPos)
+		lastBlock = block;
+		if(rem != remEnd)
 		{
-			it->row = -1;
+			block = myFindBlock(NotePos(&*rem), next);
 		}
-		++rem;
 	}
-	cleanup();
+	myCompactBlocks(firstBlock, lastBlock);
+	myHolds.remove(holds);
 }
 
 void NoteList::cleanup()
 {
-	auto read = myNotes;
-	auto end = myNotes + myNum;
-
-	// Skip over valid notes until we arrive at the first invalid note.
-	while(read != end && read->row >= 0) ++read;
-	auto write = read;
-
-	// Then, start skipping blocks of invalid notes and start moving blocks of valid notes.
-	while(read != end)
+	if(myNum > 0)
 	{
-		// Skip a block of invalid notes.
-		while(read != end && read->row < 0) ++read;
-
-		// Move a block of valid notes.
-		auto moveBegin = read;
-		while(read != end && read->row >= 0) ++read;
-		auto offset = read - moveBegin;
-		memmove(write, moveBegin, offset * sizeof(Note));
-		write += offset;
+		myCompactBlocks(0, myBlocks.size() - 2);
 	}
-
-	myNum = (int) (write - myNotes);
 }
 
 void NoteList::sanitize(const Chart* chart)
+{
+	sanitize(chart, INT_MIN, INT_MAX);
+}
+
+void NoteList::sanitize(const Chart* chart, int firstRow, int lastRow)
 {
 	int numCols = chart->style->numCols;
 	int numPlayers = chart->style->numPlayers;
@@ -235,46 +362,80 @@ void NoteList::sanitize(const Chart* chart)
 	uint col = -1;
 	int row = -1;
 
-	// Make sure all notes are valid, sorted, and do not overlap.
-	for(auto& note : *this)
+	// Notes before the first row can only conflict with the checked rows through their holds.
+	int firstBlock = 0, firstIndex = 0;
+	if(firstRow != INT_MIN && myNum > 0)
 	{
-		if(note.col >= (uint)numCols)
-		{
-			++numInvalidCols;
-			note.row = -1;
-		}
-		else if(note.player >= (uint)numPlayers)
-		{
-			++numInvalidPlayers;
-			note.row = -1;
-		}
-		else if(note.row <= endrows[note.col])
-		{
-			++numOverlapping;
-			note.row = -1;
-		}
-		else if(note.row < row || (note.row == row && note.col <= col))
-		{
-			++numUnsorted;
-			note.row = -1;
-		}
-		else if (note.quant <= 0 || note.quant > 192)
+		myLowerBound(firstRow, firstBlock, firstIndex);
+		auto& holds = myGetHolds();
+		for(int c = 0; c < numCols; ++c)
 		{
-			++numInvalidQuant;
-			note.row = -1;
+			auto hold = holds.find(c, firstRow - 1);
+			if(hold) endrows[c] = hold->endrow;
 		}
-		else
+	}
+	Vector<HoldSpan> removedHolds;
+
+	// Make sure all notes are valid, sorted, and do not overlap.
+	int numBlocks = max(0, myBlocks.size() - 1);
+	int lastBlock = firstBlock;
+	bool done = false;
+	for(int b = firstBlock; b < numBlocks && !done; ++b)
+	{
+		Block& block = myBlocks[b];
+		lastBlock = b;
+		for(int i = (b == firstBlock) ? firstIndex : 0; i < block.num; ++i)
 		{
-			col = note.col;
-			row = note.row;
-			endrows[note.col] = (int)note.endrow;
+			Note& note = block.notes[i];
+			if(note.row > lastRow)
+			{
+				done = true;
+				break;
+			}
+			HoldSpan span = {(int)note.col, note.row, note.endrow};
+			if(note.col >= (uint)numCols)
+			{
+				++numInvalidCols;
+				note.row = -1;
+			}
+			else if(note.player >= (uint)numPlayers)
+			{
+				++numInvalidPlayers;
+				note.row = -1;
+			}
+			else if(note.row <= endrows[note.col])
+			{
+				++numOverlapping;
+				note.row = -1;
+			}
+			else if(note.row < row || (note.row == row && note.col <= col))
+			{
+				++numUnsorted;
+				note.row = -1;
+			}
+			else if (note.quant <= 0 || note.quant > 192)
+			{
+				++numInvalidQuant;
+				note.row = -1;
+			}
+			else
+			{
+				col = note.col;
+				row = note.row;
+				endrows[note.col] = (int)note.endrow;
+			}
+			if(note.row < 0 && myHoldsValid && span.endrow > span.row)
+			{
+				removedHolds.push_back(span);
+			}
 		}
 	}
 
 	// Notify the user if the chart contained invalid notes.
 	if(numInvalidCols + numInvalidPlayers + numOverlapping + numUnsorted + numInvalidQuant > 0)
 	{
-		cleanup();
+		myCompactBlocks(firstBlock, lastBlock);
+		myHolds.remove(removedHolds);
 
 		String suffix = " from ";
 		Str::append(suffix, chart->description());
@@ -336,9 +497,20 @@ void NoteList::prepareEdit(const NoteEdit& in, NoteEditResult& out, bool clearRe
 	out.add.clear();
 	out.rem.clear();
 
-	auto it = begin(), itEnd = end();
 	auto add = in.add.begin(), addEnd = in.add.end();
 	auto rem = in.rem.begin(), remEnd = in.rem.end();
+	if(add == addEnd && rem == remEnd) return;
+
+	// Only notes from the first edited row onwards, and holds that reach it, can be affected.
+	int firstRow = (rem != remEnd) ? rem->row : INT_MAX;
+	int lastAddRow = -1;
+	for(auto& note : in.add)
+	{
+		firstRow = min(firstRow, note.row);
+		lastAddRow = max(lastAddRow, note.endrow);
+	}
+	const List& list = *this;
+	auto it = list.lowerBound(myGetHolds().firstRowReaching(firstRow)), itEnd = list.end();
 
 	int regionBegin, regionEnd;
 	if(add != addEnd && add->row < (addEnd - 1)->row)
@@ -358,16 +530,19 @@ void NoteList::prepareEdit(const NoteEdit& in, NoteEditResult& out, bool clearRe
 	int nextAddRows[SIM_MAX_COLUMNS];
 	for(auto& v : nextAddRows) v = 0;
 
-	const Note* nextAddNotes[SIM_MAX_COLUMNS];
+	const_iterator nextAddNotes[SIM_MAX_COLUMNS];
 	for(auto& v : nextAddNotes) v = add;
 
 	int64_t prevPos = -1;
-	int64_t nextAddPos = (add != addEnd) ? NotePos(add) : INT64_MAX;
-	int64_t nextRemPos = (rem != remEnd) ? NotePos(rem) : INT64_MAX;
+	int64_t nextAddPos = (add != addEnd) ? NotePos(&*add) : INT64_MAX;
+	int64_t nextRemPos = (rem != remEnd) ? NotePos(&*rem) : INT64_MAX;
 
 	for(; it != itEnd; ++it)
 	{
-		int64_t pos = NotePos(it);
+		// Notes past the last added and removed note are not affected.
+		if(add == addEnd && rem == remEnd && it->row > lastAddRow) break;
+
+		int64_t pos = NotePos(&*it);
 		int row = it->row, col = it->col;
 		bool removeNote = false;
 
@@ -377,14 +552,14 @@ void NoteList::prepareEdit(const NoteEdit& in, NoteEditResult& out, bool clearRe
 			out.add.append(*add);
 			VerifyAdd(*add, prevPos, prevEndRows);
 			++add;
-			nextAddPos = (add != addEnd) ? NotePos(add) : INT64_MAX;
+			nextAddPos = (add != addEnd) ? NotePos(&*add) : INT64_MAX;
 		}
 
 		// Advance to the next to-be-removed note.
 		while(nextRemPos < pos)
 		{
 			++rem;
-			nextRemPos = (rem != remEnd) ? NotePos(rem) : INT64_MAX;
+			nextRemPos = (rem != remEnd) ? NotePos(&*rem) : INT64_MAX;
 		}
 
 		// Keep track of the row of the next to-be-added note for this column.
@@ -427,7 +602,7 @@ void NoteList::prepareEdit(const NoteEdit& in, NoteEditResult& out, bool clearRe
 				VerifyAdd(*add, prevPos, prevEndRows);
 			}
 			++add;
-			nextAddPos = (add != addEnd) ? NotePos(add) : INT64_MAX;
+			nextAddPos = (add != addEnd) ? NotePos(&*add) : INT64_MAX;
 		}
 
 		// Check if the tail of the previously added note intersects this note.
@@ -583,11 +758,11 @@ void NoteList::encode(WriteStream& out, bool removeOffset) const
 	out.writeNum(myNum);
 	if(removeOffset && myNum > 0)
 	{
-		offsetRows = -myNotes[0].row;
+		offsetRows = -begin()->row;
 	}
-	for(int i = 0; i < myNum; ++i)
+	for(auto& note : *this)
 	{
-		EncodeNote(out, myNotes[i], offsetRows);
+		EncodeNote(out, note, offsetRows);
 	}
 }
 
@@ -595,14 +770,15 @@ void NoteList::encode(WriteStream& out, const TimingData& timing, bool removeOff
 {
 	double offsetTime = 0;
 	TempoTimeTracker tracker(timing);
+	const List& list = *this;
 	out.writeNum(myNum);
 	if(removeOffset && myNum > 0)
 	{
-		offsetTime = -timing.rowToTime(myNotes[0].row);
+		offsetTime = -timing.rowToTime(list.begin()->row);
 	}
-	for(int i = 0; i < myNum; ++i)
+	for(auto& note : list)
 	{
-		EncodeNote(out, myNotes[i], tracker, offsetTime);
+		EncodeNote(out, note, tracker, offsetTime);
 	}
 }
 
@@ -632,14 +808,194 @@ void NoteList::decode(ReadStream& in, const TimingData& timing, double offsetTim
 // ================================================================================================
 // NoteList :: memory management.
 
-void NoteList::myReserve(int num)
+NoteList::const_iterator NoteList::lowerBound(int row) const
+{
+	if(myNum == 0) return end();
+
+	int block, index;
+	myLowerBound(row, block, index);
+	return const_iterator(&myBlocks[block], index);
+}
+
+void NoteList::myLowerBound(int row, int& outBlock, int& outIndex) const
+{
+	// Find the first block that ends on or after the row, the end marker block if there is none.
+	int lo = 0, hi = myBlocks.size() - 1;
+	while(lo < hi)
+	{
+		int mid = (lo + hi) >> 1;
+		auto& block = myBlocks[mid];
+		if(block.notes[block.num - 1].row < row)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	auto& block = myBlocks[lo];
+	auto note = std::lower_bound(block.notes, block.notes + block.num, row,
+		[](const Note& n, int r) { return n.row < r; });
+	outBlock = lo;
+	outIndex = (int)(note - block.notes);
+}
+
+int NoteList::myFindBlock(int64_t pos, int first) const
+{
+	// Find the last block that starts on or before the position.
+	int lo = first, hi = myBlocks.size() - 1;
+	while(lo < hi)
+	{
+		int mid = (lo + hi) >> 1;
+		if(NotePos(myBlocks[mid].notes) <= pos)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return max(first, lo - 1);
+}
+
+void NoteList::myMergeIntoBlock(int& block, const_iterator notes, int num)
+{
+	Block& b = myBlocks[block];
+	Vector<Note> merged;
+	merged.resize(b.num + num);
+
+	// Inserted notes come before existing notes on the same position, sanitize keeps the first one.
+	auto write = merged.begin();
+	auto read = b.notes, readEnd = b.notes + b.num;
+	for(int i = 0; i < num; ++i, ++notes)
+	{
+		int64_t pos = NotePos(&*notes);
+		while(read != readEnd && NotePos(read) < pos)
+		{
+			*write++ = *read++;
+		}
+		*write++ = *notes;
+	}
+	while(read != readEnd)
+	{
+		*write++ = *read++;
+	}
+	mySetBlock(block, merged.data(), merged.size());
+}
+
+void NoteList::mySetBlock(int& block, const Note* notes, int num)
+{
+	// If the notes do not fit in one block, they are divided over half full blocks.
+	int numParts = (num <= BlockSize) ? 1 : (num + HalfBlockSize - 1) / HalfBlockSize;
+	if(numParts > 1)
+	{
+		myBlocks.insert(block + 1, {nullptr, 0, 0, 0}, numParts - 1);
+	}
+	for(int i = 0; i < numParts; ++i)
+	{
+		int begin = (int)((int64_t)num * i / numParts);
+		int end = (int)((int64_t)num * (i + 1) / numParts);
+		Block& b = myBlocks[block + i];
+		ReserveBlock(b, end - begin);
+		memcpy(b.notes, notes + begin, (end - begin) * sizeof(Note));
+		b.num = end - begin;
+	}
+	block += numParts - 1;
+}
+
+void NoteList::myCompactBlocks(int first, int last)
+{
+	// Remove the invalidated notes.
+	for(int i = first; i <= last; ++i)
+	{
+		Block& b = myBlocks[i];
+		auto end = std::remove_if(b.notes, b.notes + b.num, [](const Note& n) { return n.row < 0; });
+		int num = (int)(end - b.notes);
+		myNum -= b.num - num;
+		b.num = num;
+	}
+
+	// Drop empty blocks, and merge small blocks with the next block.
+	for(int i = first; i <= last && i < myBlocks.size() - 1;)
+	{
+		Block& b = myBlocks[i];
+		if(b.num == 0)
+		{
+			free(b.notes);
+			myBlocks.erase(i);
+			--last;
+			continue;
+		}
+		if(i + 1 < myBlocks.size() - 1 && b.num + myBlocks[i + 1].num <= HalfBlockSize)
+		{
+			Block& next = myBlocks[i + 1];
+			ReserveBlock(b, b.num + next.num);
+			memcpy(b.notes + b.num, next.notes, next.num * sizeof(Note));
+			b.num += next.num;
+			free(next.notes);
+			myBlocks.erase(i + 1);
+			if(i + 1 <= last) --last;
+			continue;
+		}
+		++i;
+	}
+
+	if(myNum == 0)
+	{
+		clear();
+	}
+	else
+	{
+		myUpdateStarts(first);
+	}
+}
+
+void NoteList::myUpdateStarts(int first)
+{
+	int start = 0;
+	if(first > 0)
+	{
+		start = myBlocks[first - 1].start + myBlocks[first - 1].num;
+	}
+	for(int i = first; i < myBlocks.size(); ++i)
+	{
+		myBlocks[i].start = start;
+		start += myBlocks[i].num;
+	}
+}
+
+const HoldIndex& NoteList::myGetHolds()
+{
+	if(!myHoldsValid)
+	{
+		Vector<HoldSpan> spans;
+		for(auto& block : myBlocks)
+		{
+			for(int i = 0; i < block.num; ++i)
+			{
+				const Note& note = block.notes[i];
+				if(note.endrow > note.row)
+				{
+					spans.push_back({(int)note.col, note.row, note.endrow});
+				}
+			}
+		}
+		myHolds.clear();
+		myHolds.insert(spans);
+		myHoldsValid = true;
+	}
+	return myHolds;
+}
+
+void NoteList::myFreeBlocks()
 {
-	int numBytes = num * sizeof(Note);
-	if(myCap < numBytes)
+	for(auto& block : myBlocks)
 	{
-		myCap = max(numBytes, myCap << 1);
-		myNotes = (Note*)realloc(myNotes, myCap);
+		free(block.notes);
 	}
+	myBlocks.release();
 }
 
 }; // namespace Vortex
\ No newline at end of file
@@ -2,15 +2,172 @@
 
 #include <Simfile/Notes.h>
 
+#include <stdint.h>
+#include <iterator>
+
 namespace Vortex {
 
 struct NoteEdit;
 struct NoteEditResult;
 
+// A block of consecutive notes in a note list.
+struct NoteBlock
+{
+	Note* notes;
+	int num, cap;
+
+	// Index of the first note of the block in the note list.
+	int start;
+};
+
+// Random access iterator over the blocks of a note list.
+template <typename T, typename B>
+class NoteIterator
+{
+public:
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef Note value_type;
+	typedef int difference_type;
+	typedef T* pointer;
+	typedef T& reference;
+
+	NoteIterator() : myBlock(nullptr), myIndex(0) {}
+	NoteIterator(B* block, int index) : myBlock(block), myIndex(index) {}
+
+	// Converts a regular iterator to a const iterator.
+	template <typename T2, typename B2>
+	NoteIterator(const NoteIterator<T2, B2>& it) : myBlock(it.myBlock), myIndex(it.myIndex) {}
+
+	inline T& operator * () const { return myBlock->notes[myIndex]; }
+	inline T* operator -> () const { return myBlock->notes + myIndex; }
+	inline T& operator [] (int n) const { return *(*this + n); }
+
+	// The block after the last block is empty, so the end iterator points to its first note.
+	inline NoteIterator& operator ++ ()
+	{
+		if(++myIndex == myBlock->num) ++myBlock, myIndex = 0;
+		return *this;
+	}
+
+	inline NoteIterator& operator -- ()
+	{
+		if(myIndex == 0) --myBlock, myIndex = myBlock->num;
+		--myIndex;
+		return *this;
+	}
+
+	inline NoteIterator operator ++ (int) { NoteIterator it = *this; ++*this; return it; }
+	inline NoteIterator operator -- (int) { NoteIterator it = *this; --*this; return it; }
+
+	// Moves through the blocks in between, which takes time proportional to the distance divided by
+	// the block size.
+	NoteIterator& operator += (int n)
+	{
+		int index = myIndex + n;
+		if(!myBlock) return *this;
+		if(n == 0 || (index >= 0 && index < myBlock->num))
+		{
+			myIndex += n;
+			return *this;
+		}
+		int target = myBlock->start + index;
+		while(target < myBlock->start) --myBlock;
+		while(target >= myBlock->start + myBlock->num && myBlock->num > 0) ++myBlock;
+		myIndex = target - myBlock->start;
+		return *this;
+	}
+
+	inline NoteIterator& operator -= (int n) { return *this += -n; }
+	inline NoteIterator operator + (int n) const { NoteIterator it = *this; return it += n; }
+	inline NoteIterator operator - (int n) const { NoteIterator it = *this; return it += -n; }
+
+	// Returns the index of the note in the note list.
+	inline int index() const { return myBlock ? myBlock->start + myIndex : 0; }
+
+	template <typename T2, typename B2>
+	inline int operator - (const NoteIterator<T2, B2>& it) const { return index() - it.index(); }
+
+	template <typename T2, typename B2>
+	inline bool operator == (const NoteIterator<T2, B2>& it) const
+	{
+		return myBlock == it.myBlock && myIndex == it.myIndex;
+	}
+
+	template <typename T2, typename B2>
+	inline bool operator != (const NoteIterator<T2, B2>& it) const
+	{
+		return myBlock != it.myBlock || myIndex != it.myIndex;
+	}
+
+	template <typename T2, typename B2>
+	inline bool operator < (const NoteIterator<T2, B2>& it) const { return index() < it.index(); }
+
+	template <typename T2, typename B2>
+	inline bool operator > (const NoteIterator<T2, B2>& it) const { return index() > it.index(); }
+
+	template <typename T2, typename B2>
+	inline bool operator <= (const NoteIterator<T2, B2>& it) const { return index() <= it.index(); }
+
+	template <typename T2, typename B2>
+	inline bool operator >= (const NoteIterator<T2, B2>& it) const { return index() >= it.index(); }
+
+private:
+	template <typename T2, typename B2> friend class NoteIterator;
+
+	B* myBlock;
+	int myIndex;
+};
+
+// Start and end row of a hold or roll.
+struct HoldSpan
+{
+	int col, row, endrow;
+};
+
+// Index of the holds and rolls of a chart, which finds the holds that reach a row without going over
+// the notes before it. Holds in the same column do not overlap, so the spans are sorted by column
+// and start row, and a lookup is a binary search in each column.
+class HoldIndex
+{
+public:
+	// Removes all spans.
+	void clear();
+
+	// Adds the given spans. The spans are sorted in the process.
+	void insert(Vector<HoldSpan>& spans);
+
+	// Removes spans that are identical to the given spans. The spans are sorted in the process.
+	void remove(Vector<HoldSpan>& spans);
+
+	// Moves the spans on or after the start row by the given number of rows.
+	void offset(int startRow, int numRows);
+
+	// Returns the last span in the column that starts on or before the row, if it ends on or after
+	// the row. Returns null otherwise.
+	const HoldSpan* find(int col, int row) const;
+
+	// Returns the first start row of the spans that start before the row and end on or after it,
+	// or the row itself if there are none.
+	int firstRowReaching(int row) const;
+
+	// Swaps the spans with another index.
+	inline void swap(HoldIndex& other) { mySpans.swap(other.mySpans); }
+
+	// Returns the number of spans.
+	inline int size() const { return mySpans.size(); }
+
+private:
+	Vector<HoldSpan> mySpans;
+};
+
+// Sorted list of notes. The notes are stored in blocks of limited size, so inserting or removing
+// a few notes only moves the notes of the blocks they end up in.
 class NoteList
 {
 public:
 	typedef NoteList List;
+	typedef NoteIterator<Note, NoteBlock> iterator;
+	typedef NoteIterator<const Note, const NoteBlock> const_iterator;
 
 	~NoteList();
 	NoteList();
@@ -29,6 +186,10 @@ public:
 	// Removes invalid notes (e.g. unsorted, overlapping, invalid row/column/player number).
 	void sanitize(const Chart* owner);
 
+	// Alternative version of sanitize that only checks notes which can conflict with the notes
+	// between firstRow and lastRow. The notes outside of that range must already be valid.
+	void sanitize(const Chart* owner, int firstRow, int lastRow);
+
 	// Prepares a modification. The input is a list of notes which should be added and removed.
 	// The output is a list of notes that actually end up being added and removed.
 	// If clearRegion is true, all notes in the edit region are also removed.
@@ -64,22 +225,50 @@ public:
 	// Returns true if the list is empty, false otherwise.
 	inline bool empty() const { return (myNum == 0); }
 
-	// Returns an iterator to the begin of the note list.
-	Note* begin() { return myNotes; }
+	// Returns a const iterator to the first note on or after the given row.
+	const_iterator lowerBound(int row) const;
+
+	// Must be called after notes are modified through an iterator, so the hold index is rebuilt the
+	// next time it is used.
+	void invalidateHolds() { myHoldsValid = false; }
+
+	// Returns an iterator to the begin of the note list. If notes are modified through the iterator,
+	// the hold index must be invalidated, see invalidateHolds.
+	iterator begin() { return iterator(myFirstBlock(), 0); }
 
 	// Returns a const iterator to the begin of the note list.
-	const Note* begin() const { return myNotes; }
+	const_iterator begin() const { return const_iterator(myFirstBlock(), 0); }
 
 	// Returns an iterator to the end of the note list.
-	Note* end() { return myNotes + myNum; }
+	iterator end() { return iterator(myLastBlock(), 0); }
 
 	// Returns a const iterator to the end of the note list.
-	const Note* end() const { return myNotes + myNum; }
+	const_iterator end() const { return const_iterator(myLastBlock(), 0); }
 
 private:
-	void myReserve(int num);
-	Note* myNotes;
-	int myNum, myCap;
+	typedef NoteBlock Block;
+
+	inline Block* myFirstBlock() { return myBlocks.empty() ? nullptr : myBlocks.begin(); }
+	inline const Block* myFirstBlock() const { return myBlocks.empty() ? nullptr : myBlocks.begin(); }
+	inline Block* myLastBlock() { return myBlocks.empty() ? nullptr : &myBlocks.back(); }
+	inline const Block* myLastBlock() const { return myBlocks.empty() ? nullptr : &myBlocks.back(); }
+
+	void myLowerBound(int row, int& outBlock, int& outIndex) const;
+	int myFindBlock(int64_t pos, int first) const;
+	void myMergeIntoBlock(int& block, const_iterator notes, int num);
+	void mySetBlock(int& block, const Note* notes, int num);
+	void myCompactBlocks(int first, int last);
+	void myUpdateStarts(int first);
+	const HoldIndex& myGetHolds();
+	void myFreeBlocks();
+
+	// The blocks are followed by an empty block, which marks the end of the list.
+	Vector<Block> myBlocks;
+	int myNum;
+
+	// Index of the holds in the list, which is rebuilt when it is used after it was invalidated.
+	HoldIndex myHolds;
+	bool myHoldsValid;
 };
 
 struct NoteEdit
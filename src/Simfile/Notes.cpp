@@ -1,7 +1,12 @@
 #include <Simfile/Notes.h>
 
+#include <Simfile/NoteList.h>
+#include <Simfile/TimingData.h>
+
 #include <Core/ByteStream.h>
 
+#include <algorithm>
+
 namespace Vortex {
 
 // ================================================================================================
@@ -99,4 +104,161 @@ void EncodeNotes(WriteStream& out, const Note* in, int num)
 	}
 }
 
-}; // namespace Vortex
\ No newline at end of file
+// ================================================================================================
+// Note expansion.
+
+void ExpandNote(const Note& in, ExpandedNote& out)
+{
+	out.row = in.row;
+	out.col = in.col;
+	out.endrow = in.endrow;
+	out.isMine = in.type == NOTE_MINE;
+	out.isRoll = in.type == NOTE_ROLL;
+	out.isSelected = 0;
+	out.type = in.type;
+	out.player = in.player;
+	out.quant = in.quant;
+}
+
+void ExpandNotes(const NoteList& notes, ExpandedNoteList& out)
+{
+	out.resize(notes.size());
+	int i = 0;
+	for(auto& note : notes)
+	{
+		ExpandedNote expanded;
+		ExpandNote(note, expanded);
+		out.set(i++, expanded);
+	}
+}
+
+void UpdateNoteTimes(ExpandedNoteList& notes, int begin, int num, const TimingData& timing,
+	int firstChangedRow)
+{
+	const int* rows = notes.rows() + begin;
+	const int* endrows = notes.endrows() + begin;
+	double* times = notes.times() + begin;
+	double* endtimes = notes.endtimes() + begin;
+
+	// The rows are sorted and stored in their own array, so they can be converted in a single pass.
+	int first = (int)(std::lower_bound(rows, rows + num, firstChangedRow) - rows);
+	timing.rowsToTimes(rows + first, times + first, num - first, true);
+	for(int i = first; i < num; ++i)
+	{
+		endtimes[i] = times[i];
+	}
+
+	// Hold ends are not sorted. Holds that start before the changed row can still end after it.
+	Vector<int> holds, holdRows;
+	Vector<double> holdTimes;
+	for(int i = 0; i < num; ++i)
+	{
+		if(endrows[i] != rows[i] && endrows[i] >= firstChangedRow)
+		{
+			holds.push_back(i);
+			holdRows.push_back(endrows[i]);
+		}
+	}
+	holdTimes.resize(holdRows.size());
+	timing.rowsToTimes(holdRows.data(), holdTimes.data(), holdRows.size(), false);
+	for(int i = 0; i < holds.size(); ++i)
+	{
+		endtimes[holds[i]] = holdTimes[i];
+	}
+}
+
+void UpdateWarpedNotes(ExpandedNoteList& notes, int begin, int num, const TimingData& timing)
+{
+	uint insideWarp = 0;
+	const int* rows = notes.rows();
+	int note = begin, noteEnd = begin + num;
+	auto it = timing.events.begin(), end = timing.events.end();
+
+	// Events before the first note only matter for the warp state of the first notes.
+	if(num > 0)
+	{
+		it = std::lower_bound(it, end, rows[begin],
+			[](const TimingData::Event& event, int row) { return event.row < row; });
+		if(it != timing.events.begin())
+		{
+			insideWarp = ((it - 1)->spr == 0.0);
+		}
+	}
+	for(; it != end && note != noteEnd; ++it)
+	{
+		if(insideWarp)
+		{
+			for(; note != noteEnd && rows[note] < it->row; ++note)
+			{
+				notes[note].isWarped = 1;
+			}
+		}
+		else
+		{
+			for(; note != noteEnd && rows[note] <= it->row; ++note)
+			{
+				notes[note].isWarped = 0;
+			}
+		}
+		insideWarp = (it->spr == 0.0);
+	}
+	for(; note != noteEnd; ++note)
+	{
+		notes[note].isWarped = 0;
+	}
+}
+
+// ================================================================================================
+// Expanded note list.
+
+void ExpandedNoteList::resize(int num)
+{
+	myRows.resize(num);
+	myEndrows.resize(num);
+	myTimes.resize(num);
+	myEndtimes.resize(num);
+	myInfo.resize(num);
+	myEditInfo.resize(num);
+}
+
+void ExpandedNoteList::insert(int index, int num)
+{
+	myRows.insert(index, 0, num);
+	myEndrows.insert(index, 0, num);
+	myTimes.insert(index, 0.0, num);
+	myEndtimes.insert(index, 0.0, num);
+	myInfo.insert(index, Info(), num);
+	myEditInfo.insert(index, EditInfo(), num);
+}
+
+void ExpandedNoteList::erase(int begin, int end)
+{
+	myRows.erase(begin, end);
+	myEndrows.erase(begin, end);
+	myTimes.erase(begin, end);
+	myEndtimes.erase(begin, end);
+	myInfo.erase(begin, end);
+	myEditInfo.erase(begin, end);
+}
+
+void ExpandedNoteList::release()
+{
+	myRows.release();
+	myEndrows.release();
+	myTimes.release();
+	myEndtimes.release();
+	myInfo.release();
+	myEditInfo.release();
+}
+
+void ExpandedNoteList::set(int index, const ExpandedNote& note)
+{
+	myRows[index] = note.row;
+	myEndrows[index] = note.endrow;
+	myTimes[index] = note.time;
+	myEndtimes[index] = note.endtime;
+	myInfo[index] = {(uchar)note.col, (uchar)note.type, (uchar)note.isWarped, 0};
+	myEditInfo[index] = {(uchar)note.player, (uchar)note.quant, (uchar)note.isSelected, 0};
+}
+
+}; // namespace Vortex
@@ -4,6 +4,10 @@
 
 #include <Core/Vector.h>
 
+#include <iterator>
+#include <type_traits>
+#include <cstddef>
+
 namespace Vortex {
 
 // Supported note types.
@@ -18,23 +22,33 @@ enum NoteType
 	NUM_NOTE_TYPES
 };
 
-/// Expanded representation of a note, including editing data.
+/// Expanded representation of a single note, including editing data. The notes of the active chart
+/// are not stored as an array of these, see ExpandedNoteList.
 struct ExpandedNote
 {
+	/// Time of the row.
+	double time;
+
+	/// Time of the end row.
+	double endtime;
+
 	/// Row index of the note.
 	int row;
 
-	/// Column index of the note.
-	int col;
-
 	/// Equal to 'row' for steps, larger than 'row' for holds.
 	int endrow;
 
-	/// Time of the row.
-	double time;
+	/// Column index of the note.
+	uint col : 8;
 
-	/// Time of the end row.
-	double endtime;
+	/// Indicates which player the note belongs to in routine modes.
+	uint player : 4;
+
+	/// One of the values in NoteType, indicates what kind of note it is.
+	uint type : 4;
+
+	/// Indicates the quantization of the note, if it is nonstandard
+	uint quant : 8;
 
 	/// 1 indicates a mine, 0 indicates a step or hold. 
 	uint isMine : 1;
@@ -47,15 +61,6 @@ struct ExpandedNote
 
 	/// 1 indicates selected, 0 indicates not selected.
 	uint isSelected : 1;
-
-	/// One of the values in NoteType, indicates what kind of note it is.
-	uint type : 4;
-
-	/// Indicates which player the note belongs to in routine modes.
-	uint player : 24;
-
-	/// Indicates the quantization of the note, if it is nonstandard
-	uint quant : 8;
 };
 
 // Converts and expanded note to a compact note.
@@ -64,6 +69,200 @@ inline Note CompressNote(const ExpandedNote& note)
 	return {note.row, note.endrow, (uint)note.col, (uint)note.player, (uint)note.type, (uint) note.quant};
 }
 
+// ================================================================================================
+// Expanded note list.
+
+class ExpandedNoteList;
+
+/// Reference to a note in an expanded note list. The fields refer to the arrays of the list, so a
+/// note is accessed with the same syntax as an ExpandedNote, e.g. "it->row". The mine and roll
+/// flags are derived from the type, so they can not be assigned.
+template <bool IsConst>
+struct ExpandedNoteRefT
+{
+	template <typename T>
+	using Field = typename std::conditional<IsConst, const T, T>::type&;
+
+	Field<double> time;
+	Field<double> endtime;
+	Field<int> row;
+	Field<int> endrow;
+	Field<uchar> col;
+	Field<uchar> type;
+	Field<uchar> isWarped;
+	Field<uchar> player;
+	Field<uchar> quant;
+	Field<uchar> isSelected;
+	bool isMine;
+	bool isRoll;
+
+	/// Returns a copy of the note.
+	operator ExpandedNote() const
+	{
+		ExpandedNote out;
+		out.time = time, out.endtime = endtime;
+		out.row = row, out.endrow = endrow;
+		out.col = col, out.player = player, out.type = type, out.quant = quant;
+		out.isMine = isMine, out.isRoll = isRoll, out.isWarped = isWarped, out.isSelected = isSelected;
+		return out;
+	}
+};
+
+typedef ExpandedNoteRefT<false> ExpandedNoteRef;
+typedef ExpandedNoteRefT<true> ConstExpandedNoteRef;
+
+/// Random access iterator over an expanded note list. Like a pointer, it can be null, which is the
+/// case for a default constructed iterator.
+template <bool IsConst>
+class ExpandedNoteIterator
+{
+public:
+	typedef typename std::conditional<IsConst, const ExpandedNoteList, ExpandedNoteList>::type List;
+	typedef ExpandedNoteRefT<IsConst> Ref;
+
+	/// Returned by the arrow operator, which needs a pointer to the reference.
+	struct Arrow
+	{
+		Ref ref;
+		inline const Ref* operator -> () const { return &ref; }
+	};
+
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef ExpandedNote value_type;
+	typedef int difference_type;
+	typedef Arrow pointer;
+	typedef Ref reference;
+
+	ExpandedNoteIterator() : myList(nullptr), myIndex(0) {}
+	ExpandedNoteIterator(std::nullptr_t) : myList(nullptr), myIndex(0) {}
+	ExpandedNoteIterator(List* list, int index) : myList(list), myIndex(index) {}
+
+	// Converts a regular iterator to a const iterator.
+	template <bool C2, typename = typename std::enable_if<IsConst || !C2>::type>
+	ExpandedNoteIterator(const ExpandedNoteIterator<C2>& it) : myList(it.list()), myIndex(it.index()) {}
+
+	inline Ref operator * () const { return myList->ref(myIndex); }
+	inline Arrow operator -> () const { return {myList->ref(myIndex)}; }
+	inline Ref operator [] (int n) const { return myList->ref(myIndex + n); }
+
+	inline ExpandedNoteIterator& operator ++ () { ++myIndex; return *this; }
+	inline ExpandedNoteIterator& operator -- () { --myIndex; return *this; }
+	inline ExpandedNoteIterator operator ++ (int) { ExpandedNoteIterator it = *this; ++myIndex; return it; }
+	inline ExpandedNoteIterator operator -- (int) { ExpandedNoteIterator it = *this; --myIndex; return it; }
+
+	inline ExpandedNoteIterator& operator += (int n) { myIndex += n; return *this; }
+	inline ExpandedNoteIterator& operator -= (int n) { myIndex -= n; return *this; }
+	inline ExpandedNoteIterator operator + (int n) const { return {myList, myIndex + n}; }
+	inline ExpandedNoteIterator operator - (int n) const { return {myList, myIndex - n}; }
+	inline int operator - (const ExpandedNoteIterator& it) const { return myIndex - it.myIndex; }
+
+	inline bool operator == (const ExpandedNoteIterator& it) const { return myIndex == it.myIndex && myList == it.myList; }
+	inline bool operator != (const ExpandedNoteIterator& it) const { return !(*this == it); }
+	inline bool operator < (const ExpandedNoteIterator& it) const { return myIndex < it.myIndex; }
+	inline bool operator > (const ExpandedNoteIterator& it) const { return myIndex > it.myIndex; }
+	inline bool operator <= (const ExpandedNoteIterator& it) const { return myIndex <= it.myIndex; }
+	inline bool operator >= (const ExpandedNoteIterator& it) const { return myIndex >= it.myIndex; }
+
+	/// Returns true if the iterator is not null.
+	inline explicit operator bool () const { return myList != nullptr; }
+
+	/// Returns the list of the iterator, or null if the iterator is null.
+	inline List* list() const { return myList; }
+
+	/// Returns the index of the note in the list.
+	inline int index() const { return myIndex; }
+
+private:
+	List* myList;
+	int myIndex;
+};
+
+typedef ExpandedNoteIterator<true> ExpandedNotePtr;
+
+/// The expanded notes of a chart, sorted by row and column. The fields of the notes are stored in
+/// separate arrays. The passes over the notes that run every frame (drawing, the minimap, the
+/// receptor glow) read the rows, times, columns and types, which are tightly packed in the hot
+/// arrays. The editing data (player, quantization and selection) is stored in a separate array, so
+/// it does not take cache space during those passes. The notes are accessed through iterators, and
+/// the passes that only need a single field can use the arrays directly.
+class ExpandedNoteList
+{
+public:
+	typedef ExpandedNoteIterator<false> iterator;
+	typedef ExpandedNoteIterator<true> const_iterator;
+
+	/// Returns the number of notes.
+	inline int size() const { return myRows.size(); }
+
+	/// Returns true if the list contains no notes.
+	inline bool empty() const { return myRows.empty(); }
+
+	/// Resizes the list to the given number of notes, new notes are not initialized.
+	void resize(int num);
+
+	/// Inserts the given number of notes at the given index, the new notes are not initialized.
+	void insert(int index, int num);
+
+	/// Removes the notes with indices in the range [begin, end).
+	void erase(int begin, int end);
+
+	/// Removes all notes and releases the memory.
+	void release();
+
+	/// Writes the note to the given index.
+	void set(int index, const ExpandedNote& note);
+
+	inline iterator begin() { return {this, 0}; }
+	inline iterator end() { return {this, size()}; }
+	inline const_iterator begin() const { return {this, 0}; }
+	inline const_iterator end() const { return {this, size()}; }
+
+	inline ExpandedNoteRef operator [] (int i) { return ref(i); }
+	inline ConstExpandedNoteRef operator [] (int i) const { return ref(i); }
+
+	inline ExpandedNoteRef ref(int i)
+	{
+		Info& info = myInfo[i];
+		EditInfo& edit = myEditInfo[i];
+		return {myTimes[i], myEndtimes[i], myRows[i], myEndrows[i], info.col, info.type,
+			info.isWarped, edit.player, edit.quant, edit.isSelected,
+			info.type == NOTE_MINE, info.type == NOTE_ROLL};
+	}
+
+	inline ConstExpandedNoteRef ref(int i) const
+	{
+		const Info& info = myInfo[i];
+		const EditInfo& edit = myEditInfo[i];
+		return {myTimes[i], myEndtimes[i], myRows[i], myEndrows[i], info.col, info.type,
+			info.isWarped, edit.player, edit.quant, edit.isSelected,
+			info.type == NOTE_MINE, info.type == NOTE_ROLL};
+	}
+
+	// Arrays of the fields, indexed by note.
+	inline int* rows() { return myRows.data(); }
+	inline int* endrows() { return myEndrows.data(); }
+	inline double* times() { return myTimes.data(); }
+	inline double* endtimes() { return myEndtimes.data(); }
+	inline const int* rows() const { return myRows.data(); }
+	inline const int* endrows() const { return myEndrows.data(); }
+	inline const double* times() const { return myTimes.data(); }
+	inline const double* endtimes() const { return myEndtimes.data(); }
+
+private:
+	// Fields that are read by the passes over all notes.
+	struct Info { uchar col, type, isWarped, unused; };
+
+	// Fields that are only used for editing and drawing the visible notes.
+	struct EditInfo { uchar player, quant, isSelected, unused; };
+
+	Vector<int> myRows;
+	Vector<int> myEndrows;
+	Vector<double> myTimes;
+	Vector<double> myEndtimes;
+	Vector<Info> myInfo;
+	Vector<EditInfo> myEditInfo;
+};
+
 // Encodes a single note and writes it to a bytestream.
 void EncodeNote(WriteStream& out, const Note& in);
 
@@ -79,4 +278,19 @@ void DecodeNote(ReadStream& in, Note& out);
 // Reads an encoded note from a bytestream and decodes it to out.
 void DecodeNoteWithTime(ReadStream& in, ExpandedNote& out);
 
+// Expands a note to out. The times and the warped flag are not set, see UpdateNoteTimes and
+// UpdateWarpedNotes.
+void ExpandNote(const Note& in, ExpandedNote& out);
+
+// Expands the notes of the note list to out, which is resized to the number of notes.
+void ExpandNotes(const NoteList& notes, ExpandedNoteList& out);
+
+// Updates the times of the notes in the range [begin, begin + num), from the first note on or after
+// the given row. Holds that start before the given row and end on or after it are also updated.
+void UpdateNoteTimes(ExpandedNoteList& notes, int begin, int num, const TimingData& timing,
+	int firstChangedRow);
+
+// Updates the warped flags of the notes in the range [begin, begin + num).
+void UpdateWarpedNotes(ExpandedNoteList& notes, int begin, int num, const TimingData& timing);
+
 }; // namespace Vortex
\ No newline at end of file
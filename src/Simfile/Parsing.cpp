@@ -5,14 +5,8 @@
 #include <System/File.h>
 #include <System/Debug.h>
 
-#include <Simfile/Parsing.h>
 #include <Simfile/Simfile.h>
 #include <Simfile/Chart.h>
-#include <Simfile/Tempo.h>
-#include <Simfile/Notes.h>
-#include <Simfile/SegmentGroup.h>
-
-#include <Managers/StyleMan.h>
 
 #include <algorithm>
 
@@ -26,9 +20,9 @@ namespace Vortex {
 
 namespace Sm
 {
-	bool LoadSm(LOAD_ARGS);  // Defined in LoadSm.cpp
-	bool SaveSm(SAVE_ARGS);  // Defined in SaveSm.cpp
-	bool SaveSsc(SAVE_ARGS); // Defined in SaveSm.cpp
+	bool LoadSm(LOAD_ARGS, bool deferNotes); // Defined in LoadSm.cpp
+	bool SaveSm(SAVE_ARGS, ChartCache* cache);  // Defined in SaveSm.cpp
+	bool SaveSsc(SAVE_ARGS, ChartCache* cache); // Defined in SaveSm.cpp
 };
 namespace Osu
 {
@@ -39,6 +33,11 @@ namespace Dwi
 {
 	bool LoadDwi(LOAD_ARGS); // Defined in LoadDwi.cpp
 };
+namespace Proj
+{
+	bool LoadProject(LOAD_ARGS, bool deferNotes); // Defined in Project.cpp
+	bool SaveProject(SAVE_ARGS); // Defined in Project.cpp
+};
 
 // ================================================================================================
 // Parsing utilities.
@@ -78,6 +77,167 @@ bool ParseSimfile(String& out, StringRef path)
 	return true;
 }
 
+// Characters that need more than a copy inside a value: comments, carriage returns, tabs,
+// newlines, semicolons and the end of the file.
+struct ValueSpecialChars
+{
+	bool table[256];
+	ValueSpecialChars() : table()
+	{
+		for(uchar c : {'/', '\r', '\t', '\n', ';', '\0'}) table[c] = true;
+	}
+};
+static const ValueSpecialChars ValueSpecial;
+
+bool TokenizeSimfile(StringRef path, String& buffer, Vector<SimfileTag>& outTags,
+	bool skipNoteData)
+{
+	outTags.clear();
+
+	MappedFile file;
+	if(!file.open(path)) return false;
+
+	// The output is never longer than the input, except for the terminators of an unfinished tag.
+	buffer = String((int)file.size + 2, 0);
+	char* write = buffer.begin();
+
+	enum State { SEEK_TAG, READ_TAG, READ_VAL };
+
+	State state = SEEK_TAG;
+	SimfileTag tag = {nullptr, nullptr};
+	bool pendingNewline = false;
+	char prev = 0;
+
+	// The number of colons after which the rest of the value is skipped, or -1 to copy all of it.
+	int colonsLeft = -1;
+	bool isSsc = false;
+
+	const char* read = file.data, *end = file.data + file.size;
+	while(read != end)
+	{
+		// Copy runs of plain characters inside a value in one go, which is the bulk of the note data.
+		// The chart info of an sm file is read per character, since its colons have to be counted.
+		if(state == READ_VAL && !pendingNewline && colonsLeft <= 0)
+		{
+			const char* run = read;
+			for(; read != end; ++read)
+			{
+				// A newline is copied as well, unless the next character might start a tag.
+				char c = *read;
+				if(ValueSpecial.table[(uchar)c] && (c != '\n' || read + 1 == end ||
+					ValueSpecial.table[(uchar)read[1]] || read[1] == '#')) break;
+				if(colonsLeft) *write++ = c;
+			}
+			if(read != run) prev = read[-1];
+			if(read == end) break;
+		}
+		if(*read == 0) break;
+
+		char c = *read++;
+		if(c == '/' && read != end && *read == '/')
+		{
+			while(read != end && *read && *read != '\n') ++read;
+			continue;
+		}
+		else if(c == '\r')
+		{
+			continue;
+		}
+		else if(c == '\t')
+		{
+			c = ' ';
+		}
+
+		if(state == SEEK_TAG)
+		{
+			if(c == '#')
+			{
+				tag.tag = write;
+				state = READ_TAG;
+			}
+		}
+		else if(state == READ_TAG)
+		{
+			if(c == ':')
+			{
+				*write++ = 0;
+				tag.val = write;
+				prev = 0;
+				state = READ_VAL;
+				colonsLeft = -1;
+				if(skipNoteData)
+				{
+					if(Str::iequal(tag.tag, "NOTEDATA"))
+					{
+						isSsc = true;
+					}
+					else if(Str::iequal(tag.tag, "NOTES") || Str::iequal(tag.tag, "NOTES2"))
+					{
+						colonsLeft = isSsc ? 0 : 5;
+					}
+				}
+			}
+			else
+			{
+				*write++ = c;
+			}
+		}
+		else
+		{
+			// A newline followed by a tag ends the value, even if the semicolon is missing.
+			if(pendingNewline)
+			{
+				pendingNewline = false;
+				if(c == '#')
+				{
+					*write++ = 0;
+					outTags.push_back(tag);
+					tag.tag = write;
+					state = READ_TAG;
+					continue;
+				}
+				if(colonsLeft) *write++ = '\n';
+				prev = '\n';
+			}
+
+			// Allow semicolons to be escaped.
+			if(c == ';' && prev != '\\')
+			{
+				*write++ = 0;
+				outTags.push_back(tag);
+				state = SEEK_TAG;
+			}
+			else if(c == '\n')
+			{
+				pendingNewline = true;
+			}
+			else
+			{
+				if(colonsLeft) *write++ = c;
+				if(c == ':' && colonsLeft > 0) --colonsLeft;
+				prev = c;
+			}
+		}
+	}
+
+	// Finish the last tag if the file ends before its value does.
+	if(state == READ_TAG)
+	{
+		*write++ = 0;
+		tag.val = write;
+		*write++ = 0;
+		outTags.push_back(tag);
+	}
+	else if(state == READ_VAL)
+	{
+		if(pendingNewline && colonsLeft) *write++ = '\n';
+		*write++ = 0;
+		outTags.push_back(tag);
+	}
+
+	return true;
+}
+
 static char* ZeroTerminateItem(char* start, char* end)
 {
 	while(end != start && (end[-1] == ' ' || end[-1] == '\n')) --end;
@@ -197,7 +357,7 @@ static void ClearSimfile(Simfile& sim, Path& path)
 	sim.file = path.name();
 }
 
-bool LoadSimfile(Simfile& sim, StringRef path)
+bool LoadSimfile(Simfile& sim, StringRef path, bool deferNotes)
 {
 	// Store the song directory, filename and extension.
 	Path filePath = path;
@@ -209,7 +369,7 @@ bool LoadSimfile(Simfile& sim, StringRef path)
 	Str::toLower(ext);
 	if(ext == "sm" || ext == "ssc")
 	{
-		success = Sm::LoadSm(filePath, &sim);
+		success = Sm::LoadSm(filePath, &sim, deferNotes);
 	}
 	else if(ext == "dwi")
 	{
@@ -219,6 +379,10 @@ bool LoadSimfile(Simfile& sim, StringRef path)
 	{
 		success = Osu::LoadOsu(filePath, &sim);
 	}
+	else if(ext == "avproj")
+	{
+		success = Proj::LoadProject(filePath, &sim, deferNotes);
+	}
 	else
 	{
 		Debug::blockBegin(Debug::ERROR, "could not load sim");
@@ -231,15 +395,57 @@ bool LoadSimfile(Simfile& sim, StringRef path)
 	return true;
 }
 
-bool SaveSimfile(const Simfile& sim, SimFormat format, bool backup)
+bool SaveSimfile(const Simfile& sim, SimFormat format, bool backup, ChartCache* cache)
 {
+	for(auto chart : sim.charts)
+	{
+		if(chart->hasDeferredNotes())
+		{
+			HudError("Bug: trying to save %s before its notes are loaded.", chart->description().str());
+			return false;
+		}
+	}
+
 	switch(format)
 	{
-		case SIM_SM:  return Sm::SaveSm(&sim, backup);
-		case SIM_SSC: return Sm::SaveSsc(&sim, backup);
+		case SIM_SM:  return Sm::SaveSm(&sim, backup, cache);
+		case SIM_SSC: return Sm::SaveSsc(&sim, backup, cache);
 		case SIM_OSU: return Osu::SaveOsu(&sim, backup);
+		case SIM_AVPROJ: return Proj::SaveProject(&sim, backup);
 	};
 	return false;
 }
 
+bool ReplaceSimfile(StringRef path, const void* data, size_t size, bool backup)
+{
+	Path filePath = path;
+	String tempPath = path + ".tmp";
+
+	// Write the data to a temporary file, which is only used if it is stored on disk completely.
+	FileWriter file;
+	if(!file.open(tempPath)) return false;
+	bool written = (file.write(data, 1, size) == size) && file.sync();
+	file.close();
+	if(!written)
+	{
+		File::deleteFile(tempPath);
+		Debug::blockBegin(Debug::ERROR, "could not write sim");
+		Debug::log("file: %s\n", path.str());
+		Debug::blockEnd();
+		return false;
+	}
+
+	// If a backup file is requested, rename the existing file before replacing it.
+	if(backup && (filePath.attributes() & File::ATR_EXISTS))
+	{
+		if(!File::moveFile(path, path + ".old", true))
+		{
+			Debug::blockBegin(Debug::WARNING, "could not backup sim");
+			Debug::log("file: %s\n", path.str());
+			Debug::blockEnd();
+		}
+	}
+	return File::moveFile(tempPath, path, true);
+}
+
 }; // namespace Vortex
@@ -10,6 +10,22 @@ namespace Vortex {
 /// Opens and reads a text file, removing comments, tabs, and carriage returns.
 bool ParseSimfile(String& out, StringRef path);
 
+/// A tag-value pair of an sm-style file, both strings are zero-terminated and can be modified.
+struct SimfileTag
+{
+	char* tag;
+	char* val;
+};
+
+/// Reads the tag-value pairs of an sm-style file in a single pass over the memory-mapped file. The
+/// result is the same as ParseSimfile followed by ParseNextTag, but comments, tabs and carriage
+/// returns are handled while the tags are read. The tags point into the buffer. If skipNoteData is
+/// true, the note data in the NOTES and NOTES2 tags is skipped without being copied. In sm files,
+/// the value is cut after the chart info (the fifth colon); in ssc files, which store the chart
+/// info in separate tags, the value of every NOTES tag that follows a NOTEDATA tag is left empty.
+bool TokenizeSimfile(StringRef path, String& buffer, Vector<SimfileTag>& outTags,
+	bool skipNoteData = false);
+
 /// Parses the next tag-value pair in a list of sm-style tags (e.g. #TAG:VAL;).
 bool ParseNextTag(char*& p, char*& outTag, char*& outVal);
 
@@ -34,10 +50,35 @@ bool ParseBeat(const char* str, int& outRow);
 // ================================================================================================
 // Simfile importing and exporting.
 
-/// Loads a simfile from the given path and writes the output data to song and charts.
-bool LoadSimfile(Simfile& simfile, StringRef path);
+/// Loads a simfile from the given path and writes the output data to song and charts. If deferNotes
+/// is true, the note data of sm, ssc and project charts is parsed when the chart is opened, see
+/// Chart::loadNotes.
+bool LoadSimfile(Simfile& simfile, StringRef path, bool deferNotes = false);
+
+/// Serialized charts of a previous save. Charts with the same revision as a cached chart are copied
+/// from the cache instead of being serialized again, see Chart::revision.
+struct ChartCache
+{
+	struct Entry
+	{
+		uint revision;
+		SimFormat format;
+		Difficulty difficulty; ///< The difficulty the chart was saved as.
+		String text;
+	};
+	Vector<Entry> entries;
+};
+
+/// Saves the given simfile, to the path specified in the simfile, in the given save format. Charts
+/// with deferred notes must be loaded first, see Simfile::loadNotes. Sm and ssc files are written
+/// to a temporary file first, which replaces the previous file once it is complete. If a chart cache
+/// is given, unmodified sm and ssc charts are taken from it, and it is updated with the saved charts.
+/// The result is not shown on the hud, since the simfile may be saved on a background thread.
+bool SaveSimfile(const Simfile& simfile, SimFormat format, bool backup, ChartCache* cache = nullptr);
 
-/// Saves the given simfile, to the path specified in the simfile, in the given save format.
-bool SaveSimfile(const Simfile& simfile, SimFormat format, bool backup);
+/// Writes the data of a saved simfile to a temporary file, which then replaces the file at the given
+/// path, so the previous file is left intact if writing fails. If backup is true, the previous file
+/// is kept with an ".old" extension.
+bool ReplaceSimfile(StringRef path, const void* data, size_t size, bool backup);
 
 }; // namespace Vortex
\ No newline at end of file
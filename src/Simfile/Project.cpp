@@ -0,0 +1,451 @@
+#include <Core/StringUtils.h>
+#include <Core/Utils.h>
+#include <Core/ByteStream.h>
+
+#include <System/File.h>
+#include <System/Debug.h>
+
+#include <Simfile/Simfile.h>
+#include <Simfile/Chart.h>
+#include <Simfile/Tempo.h>
+#include <Simfile/NoteList.h>
+#include <Simfile/SegmentGroup.h>
+#include <Simfile/Parsing.h>
+
+#include <Managers/StyleMan.h>
+
+#include <string.h>
+
+namespace Vortex {
+namespace Proj {
+namespace {
+
+// A project file is a binary container of the editor's own simfile data. It starts with a header
+// and a table of sections, followed by the section data. Each section starts at a multiple of
+// sixteen bytes, so the file can be used directly from a memory-mapped view. Sections of an unknown
+// type are skipped, so newer versions can add sections without breaking older files.
+
+static const char PROJECT_MAGIC[4] = {'A', 'V', 'P', 'J'};
+static const uint PROJECT_VERSION = 1;
+static const uint SECTION_ALIGNMENT = 16;
+static const uint NO_CHART = 0xFFFFFFFF;
+
+enum SectionType
+{
+	SECTION_SIMFILE = 1, // Simfile metadata and the number of charts.
+	SECTION_TEMPO   = 2, // Tempo of the simfile, or of a chart if a chart index is given.
+	SECTION_CHART   = 3, // Chart properties.
+	SECTION_NOTES   = 4, // Notes of a chart, encoded with NoteList::encode.
+};
+
+struct Header
+{
+	char magic[4];
+	uint version;
+	uint numSections;
+	uint flags;
+};
+
+struct Section
+{
+	uint type;
+	uint chart;
+	uint offset;
+	uint size;
+};
+
+// ================================================================================================
+// Exporting.
+
+static void WriteBgChanges(WriteStream& out, const Vector<BgChange>& list)
+{
+	out.writeNum(list.size());
+	for(auto& bg : list)
+	{
+		out.writeStr(bg.effect);
+		out.writeStr(bg.file);
+		out.writeStr(bg.file2);
+		out.writeStr(bg.color);
+		out.writeStr(bg.color2);
+		out.writeStr(bg.transition);
+		out.write(bg.startBeat);
+		out.write(bg.rate);
+	}
+}
+
+static void WriteSimfile(WriteStream& out, const Simfile* sim)
+{
+	out.writeNum(sim->charts.size());
+
+	out.writeStr(sim->title);
+	out.writeStr(sim->titleTr);
+	out.writeStr(sim->subtitle);
+	out.writeStr(sim->subtitleTr);
+	out.writeStr(sim->artist);
+	out.writeStr(sim->artistTr);
+	out.writeStr(sim->genre);
+	out.writeStr(sim->credit);
+
+	out.writeStr(sim->music);
+	out.writeStr(sim->banner);
+	out.writeStr(sim->background);
+	out.writeStr(sim->cdTitle);
+	out.writeStr(sim->lyricsPath);
+
+	WriteBgChanges(out, sim->fgChanges);
+	WriteBgChanges(out, sim->bgChanges[0]);
+	WriteBgChanges(out, sim->bgChanges[1]);
+
+	out.write(sim->previewStart);
+	out.write(sim->previewLength);
+	out.write<uchar>(sim->isSelectable);
+}
+
+static void WriteTempo(WriteStream& out, const Tempo* tempo)
+{
+	out.write(tempo->offset);
+
+	out.writeNum(tempo->attacks.size());
+	for(auto& attack : tempo->attacks)
+	{
+		out.write(attack.time);
+		out.write(attack.duration);
+		out.writeStr(attack.mods);
+		out.write<uchar>(attack.unit);
+	}
+
+	out.writeNum(tempo->keysounds.size());
+	for(auto& keysound : tempo->keysounds)
+	{
+		out.writeStr(keysound);
+	}
+
+	out.writeNum(tempo->misc.size());
+	for(auto& property : tempo->misc)
+	{
+		out.writeStr(property.tag);
+		out.writeStr(property.val);
+	}
+
+	out.write<uchar>(tempo->displayBpmType);
+	out.write(tempo->displayBpmRange.min);
+	out.write(tempo->displayBpmRange.max);
+
+	tempo->segments->encode(out);
+}
+
+static void WriteChart(WriteStream& out, const Chart* chart)
+{
+	out.writeStr(chart->style->id);
+	out.writeNum(chart->style->numCols);
+	out.writeNum(chart->style->numPlayers);
+
+	out.writeStr(chart->artist);
+	out.write<uchar>(chart->difficulty);
+	out.write<int>(chart->meter);
+
+	out.writeNum(chart->radar.size());
+	for(double value : chart->radar)
+	{
+		out.write(value);
+	}
+
+	// The step count is stored, so it is known before the notes are decoded.
+	out.writeNum(chart->stepCount());
+}
+
+// Writes the data of a section to the body, after padding the body to the section alignment.
+template <typename F>
+static void WriteSection(WriteStream& body, Vector<Section>& table, uint type, uint chart, F func)
+{
+	static const uchar padding[SECTION_ALIGNMENT] = {};
+	body.write(padding, (SECTION_ALIGNMENT - body.size() % SECTION_ALIGNMENT) % SECTION_ALIGNMENT);
+
+	uint offset = body.size();
+	func(body);
+	table.push_back({type, chart, offset, body.size() - offset});
+}
+
+// ================================================================================================
+// Importing.
+
+// Note data of a chart that is decoded when the chart is opened. The encoded notes are copied from
+// the project file, which is only mapped while the project is loaded.
+struct ProjDeferredNotes : public DeferredNotes
+{
+	Vector<uchar> data;
+	void load(Chart* chart) override
+	{
+		ReadStream in(data.data(), data.size());
+		chart->notes.decode(in, 0);
+	}
+	DeferredNotes* clone() const override
+	{
+		return new ProjDeferredNotes(*this);
+	}
+};
+
+static void ReadBgChanges(ReadStream& in, Vector<BgChange>& list)
+{
+	uint num = in.readNum();
+	for(uint i = 0; i < num && in.success(); ++i)
+	{
+		BgChange bg;
+		in.readStr(bg.effect);
+		in.readStr(bg.file);
+		in.readStr(bg.file2);
+		in.readStr(bg.color);
+		in.readStr(bg.color2);
+		in.readStr(bg.transition);
+		in.read(bg.startBeat);
+		in.read(bg.rate);
+		list.push_back(bg);
+	}
+}
+
+static void ReadSimfile(ReadStream& in, Simfile* sim, uint maxCharts)
+{
+	uint numCharts = in.readNum();
+	if(numCharts > maxCharts)
+	{
+		in.invalidate();
+		return;
+	}
+	for(uint i = 0; i < numCharts; ++i)
+	{
+		sim->charts.push_back(new Chart);
+	}
+
+	in.readStr(sim->title);
+	in.readStr(sim->titleTr);
+	in.readStr(sim->subtitle);
+	in.readStr(sim->subtitleTr);
+	in.readStr(sim->artist);
+	in.readStr(sim->artistTr);
+	in.readStr(sim->genre);
+	in.readStr(sim->credit);
+
+	in.readStr(sim->music);
+	in.readStr(sim->banner);
+	in.readStr(sim->background);
+	in.readStr(sim->cdTitle);
+	in.readStr(sim->lyricsPath);
+
+	ReadBgChanges(in, sim->fgChanges);
+	ReadBgChanges(in, sim->bgChanges[0]);
+	ReadBgChanges(in, sim->bgChanges[1]);
+
+	in.read(sim->previewStart);
+	in.read(sim->previewLength);
+	sim->isSelectable = (in.read<uchar>() != 0);
+}
+
+static void ReadTempo(ReadStream& in, Tempo* tempo)
+{
+	in.read(tempo->offset);
+
+	uint numAttacks = in.readNum();
+	for(uint i = 0; i < numAttacks && in.success(); ++i)
+	{
+		Attack attack;
+		in.read(attack.time);
+		in.read(attack.duration);
+		in.readStr(attack.mods);
+		attack.unit = (AttackUnit)in.read<uchar>();
+		tempo->attacks.push_back(attack);
+	}
+
+	uint numKeysounds = in.readNum();
+	for(uint i = 0; i < numKeysounds && in.success(); ++i)
+	{
+		tempo->keysounds.push_back(in.readStr());
+	}
+
+	uint numProperties = in.readNum();
+	for(uint i = 0; i < numProperties && in.success(); ++i)
+	{
+		Property property;
+		in.readStr(property.tag);
+		in.readStr(property.val);
+		tempo->misc.push_back(property);
+	}
+
+	tempo->displayBpmType = (DisplayBpm)in.read<uchar>();
+	in.read(tempo->displayBpmRange.min);
+	in.read(tempo->displayBpmRange.max);
+
+	tempo->segments->decode(in);
+}
+
+static void ReadChart(ReadStream& in, Chart* chart, int& outStepCount)
+{
+	String styleId = in.readStr();
+	int numCols = in.readNum();
+	int numPlayers = in.readNum();
+
+	in.readStr(chart->artist);
+	int difficulty = in.read<uchar>();
+	chart->difficulty = (Difficulty)min(difficulty, (int)DIFF_EDIT);
+	in.read(chart->meter);
+
+	uint numRadar = in.readNum();
+	for(uint i = 0; i < numRadar && in.success(); ++i)
+	{
+		chart->radar.push_back(in.read<double>());
+	}
+
+	outStepCount = in.readNum();
+
+	if(in.success())
+	{
+		chart->style = gStyle->findStyle(chart->description(), numCols, numPlayers, styleId);
+	}
+}
+
+static bool LoadProjectData(const uchar* data, size_t size, Simfile* sim, bool deferNotes)
+{
+	// Check the header and the section table.
+	if(size < sizeof(Header)) return false;
+	Header header;
+	memcpy(&header, data, sizeof(Header));
+	if(memcmp(header.magic, PROJECT_MAGIC, sizeof(PROJECT_MAGIC))) return false;
+	if(header.version > PROJECT_VERSION)
+	{
+		HudError("The project was saved by a newer version of ArrowVortex.");
+		return false;
+	}
+	if(header.numSections > (size - sizeof(Header)) / sizeof(Section)) return false;
+	auto table = (const Section*)(data + sizeof(Header));
+
+	Vector<int> stepCounts;
+	for(uint i = 0; i < header.numSections; ++i)
+	{
+		auto& section = table[i];
+		if(section.offset > size || section.size > size - section.offset) return false;
+		ReadStream in(data + section.offset, section.size);
+
+		// The simfile section comes first, all other sections refer to its charts.
+		Chart* chart = nullptr;
+		if(section.type != SECTION_SIMFILE && section.chart != NO_CHART)
+		{
+			if(section.chart >= (uint)sim->charts.size()) return false;
+			chart = sim->charts[section.chart];
+		}
+
+		switch(section.type)
+		{
+		case SECTION_SIMFILE:
+			if(sim->charts.size()) return false;
+			ReadSimfile(in, sim, header.numSections);
+			stepCounts.resize(sim->charts.size(), 0);
+			break;
+		case SECTION_TEMPO:
+			if(chart && !chart->tempo) chart->tempo = new Tempo;
+			ReadTempo(in, chart ? chart->tempo : sim->tempo);
+			break;
+		case SECTION_CHART:
+			if(!chart) return false;
+			ReadChart(in, chart, stepCounts[section.chart]);
+			break;
+		case SECTION_NOTES:
+			if(!chart) return false;
+			if(deferNotes)
+			{
+				auto deferred = new ProjDeferredNotes;
+				deferred->data.resize(section.size);
+				memcpy(deferred->data.data(), data + section.offset, section.size);
+				deferred->stepCount = stepCounts[section.chart];
+				delete chart->deferred;
+				chart->deferred = deferred;
+			}
+			else
+			{
+				chart->notes.decode(in, 0);
+			}
+			break;
+		};
+		if(!in.success()) return false;
+	}
+
+	return true;
+}
+
+}; // anonymous namespace.
+
+// ================================================================================================
+// Project loading and saving.
+
+bool LoadProject(StringRef path, Simfile* sim, bool deferNotes)
+{
+	MappedFile file;
+	if(!file.open(path))
+	{
+		HudError("Could not open \"%s\".", path.str());
+		return false;
+	}
+	if(!LoadProjectData((const uchar*)file.data, file.size, sim, deferNotes))
+	{
+		HudError("\"%s\" is not a valid project file.", Path(path).filename().str());
+		return false;
+	}
+	sim->format = SIM_AVPROJ;
+	return true;
+}
+
+bool SaveProject(const Simfile* sim, bool backup)
+{
+	Path path = sim->dir + sim->file + ".avproj";
+
+	// Write the sections, followed by the table that describes them.
+	WriteStream body;
+	Vector<Section> table;
+	WriteSection(body, table, SECTION_SIMFILE, NO_CHART, [&](WriteStream& out)
+	{
+		WriteSimfile(out, sim);
+	});
+	WriteSection(body, table, SECTION_TEMPO, NO_CHART, [&](WriteStream& out)
+	{
+		WriteTempo(out, sim->tempo);
+	});
+	for(uint i = 0; i < (uint)sim->charts.size(); ++i)
+	{
+		auto chart = sim->charts[i];
+		WriteSection(body, table, SECTION_CHART, i, [&](WriteStream& out)
+		{
+			WriteChart(out, chart);
+		});
+		if(chart->tempo)
+		{
+			WriteSection(body, table, SECTION_TEMPO, i, [&](WriteStream& out)
+			{
+				WriteTempo(out, chart->tempo);
+			});
+		}
+		WriteSection(body, table, SECTION_NOTES, i, [&](WriteStream& out)
+		{
+			chart->notes.encode(out, false);
+		});
+	}
+	if(!body.success()) return false;
+
+	// The header and table are a multiple of the section alignment, so the body stays aligned.
+	uint bodyOffset = sizeof(Header) + table.size() * sizeof(Section);
+	for(auto& section : table)
+	{
+		section.offset += bodyOffset;
+	}
+	Header header = {{}, PROJECT_VERSION, (uint)table.size(), 0};
+	memcpy(header.magic, PROJECT_MAGIC, sizeof(PROJECT_MAGIC));
+
+	WriteStream out;
+	out.reserve(bodyOffset + body.size());
+	out.write(&header, sizeof(Header));
+	out.write(table.data(), table.size() * sizeof(Section));
+	out.write(body.data(), body.size());
+	if(!out.success()) return false;
+
+	return ReplaceSimfile(path.str, out.data(), out.size(), backup);
+}
+
+}; // namespace Proj
+}; // namespace Vortex
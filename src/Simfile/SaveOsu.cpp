@@ -79,11 +79,7 @@ static int FindNextRow(const Vector<T>& list, int row)
 
 static int FindNextNoteRow(const NoteList& list, int row)
 {
-	const Note* it = std::lower_bound(list.begin(), list.end(), row,
-	[](const Note& a, int row)
-	{
-		return (int)a.row < row;
-	});
+	auto it = list.lowerBound(row);
 	while(it != list.end() && it->type != NOTE_STEP_OR_HOLD) ++it;
 	return (it != list.end()) ? it->row : INT_MAX;
 }
@@ -291,7 +287,6 @@ bool SaveOsu(const Simfile* sim, bool backup)
 	{
 		Path path(sim->dir + sim->file + ".osu");
 		SaveChart(path, sim, nullptr);
-		HudInfo("Saved: %s", path.filename().str());
 	}
 	else
 	{
@@ -309,7 +304,6 @@ bool SaveOsu(const Simfile* sim, bool backup)
 			path += "].osu";
 			SaveChart(path, sim, chart);
 		}
-		HudInfo("Saved: %s", sim->file.str());
 	}	
 
 	return true;
@@ -1,5 +1,6 @@
 ﻿#include <Core/StringUtils.h>
 #include <Core/Utils.h>
+#include <Core/ByteStream.h>
 
 #include <System/File.h>
 
@@ -9,9 +10,12 @@
 #include <Simfile/Notes.h>
 #include <Simfile/SegmentGroup.h>
 #include <Simfile/TimingData.h>
+#include <Simfile/Parsing.h>
 
 #include <Managers/StyleMan.h>
 #include <list>
+#include <stdarg.h>
+#include <stdio.h>
 
 namespace Vortex {
 namespace Sm {
@@ -30,12 +34,44 @@ static double ToBeat(int row)
 	return (double)row / ROWS_PER_BEAT;
 }
 
+// Holds the serialized simfile, which is written to disk in a single call once it is complete.
+struct OutputBuffer : public WriteStream
+{
+	void write(const void* ptr, int size, int count)
+	{
+		WriteStream::write(ptr, size * count);
+	}
+
+	void printf(const char* format, ...)
+	{
+		char buffer[256];
+		va_list args;
+		va_start(args, format);
+		int n = vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		if(n < (int)sizeof(buffer))
+		{
+			WriteStream::write(buffer, max(n, 0));
+		}
+		else
+		{
+			Vector<char> large(n + 1, 0);
+			va_start(args, format);
+			vsnprintf(large.data(), n + 1, format, args);
+			va_end(args);
+			WriteStream::write(large.data(), n);
+		}
+	}
+};
+
 struct ExportData
 {
 	Vector<int> diffs;
-	FileWriter file;
+	OutputBuffer out;
 	const Simfile* sim;
 	const Chart* chart;
+	ChartCache* cache;
+	Vector<ChartCache::Entry> saved;
 	bool ssc;
 };
 
@@ -73,7 +109,7 @@ static void WriteTag(ExportData& data, const char* tag, StringRef value, ForceWr
 {
 	if(ShouldWrite(data, when, value.len() != 0, sscOnly))
 	{
-		data.file.printf("#%s:%s;\n", tag, value.str());
+		data.out.printf("#%s:%s;\n", tag, value.str());
 	}
 }
 
@@ -81,7 +117,7 @@ static void WriteTag(ExportData& data, const char* tag, double value, ForceWrite
 {
 	if(ShouldWrite(data, when, value != 0, sscOnly))
 	{
-		data.file.printf("#%s:%.6f;\n", tag, value);
+		data.out.printf("#%s:%.6f;\n", tag, value);
 	}
 }
 
@@ -89,7 +125,7 @@ static void WriteTag(ExportData& data, const char* tag, int value, ForceWrite wh
 {
 	if(ShouldWrite(data, when, value != 0, sscOnly))
 	{
-		data.file.printf("#%s:%i;\n", tag, value);
+		data.out.printf("#%s:%i;\n", tag, value);
 	}
 }
 
@@ -117,25 +153,25 @@ static void WriteTag(ExportData& data, const char* tag, const T& list, Seperator
 {
 	if(ShouldWrite(data, when, list.size() != 0, sscOnly))
 	{
-		auto& file = data.file;
-		file.printf("#%s:", tag);
+		auto& out = data.out;
+		out.printf("#%s:", tag);
 		for(auto it = list.begin(); it != list.end();)
 		{
 			if(it != list.begin() && pos == START_OF_LINE)
 			{
-				file.write(&seperator, 1, 1);
+				out.write(&seperator, 1, 1);
 			}
 			func(*it);
 			if(++it != list.end() && pos == END_OF_LINE)
 			{
-				file.write(&seperator, 1, 1);
+				out.write(&seperator, 1, 1);
 			}
 			if(list.size() > 1)
 			{
-				file.write("\n", 1, 1);
+				out.write("\n", 1, 1);
 			}
 		}
-		file.write(";\n", 2, 1);
+		out.write(";\n", 2, 1);
 	}
 }
 
@@ -147,25 +183,25 @@ static void WriteSegments(ExportData& data, const char* tag, const Tempo* tempo,
 	auto end = tempo->segments->end<T>();
 	if(ShouldWrite(data, when, begin != end, sscOnly))
 	{
-		auto& file = data.file;
-		file.printf("#%s:", tag);
+		auto& out = data.out;
+		out.printf("#%s:", tag);
 		for(auto it = begin; it != end; ++it)
 		{
 			if(it != begin && pos == START_OF_LINE)
 			{
-				file.write(&seperator, 1, 1);
+				out.write(&seperator, 1, 1);
 			}
 			func(*it);
 			if(it + 1 != end && pos == END_OF_LINE)
 			{
-				file.write(&seperator, 1, 1);
+				out.write(&seperator, 1, 1);
 			}
 			if(begin + 1 < end)
 			{
-				file.write("\n", 1, 1);
+				out.write("\n", 1, 1);
 			}
 		}
-		file.write(";\n", 2, 1);
+		out.write(";\n", 2, 1);
 	}
 }
 
@@ -182,7 +218,7 @@ static void WriteBpms(ExportData& data, const Tempo* tempo)
 	WriteSegments<BpmChange>(data, "BPMS", tempo, START_OF_LINE, ',', SONG_ONLY, false,
 	[&](const BpmChange& change)
 	{
-		data.file.printf("%.6f=%.6f",
+		data.out.printf("%.6f=%.6f",
 			ToBeat(change.row), change.bpm);
 	});
 }
@@ -192,7 +228,7 @@ static void WriteStops(ExportData& data, const Tempo* tempo)
 	WriteSegments<Stop>(data, "STOPS", tempo, START_OF_LINE, ',', SONG_ONLY, false,
 	[&](const Stop& stop)
 	{
-		data.file.printf("%.6f=%.6f",
+		data.out.printf("%.6f=%.6f",
 			ToBeat(stop.row), stop.seconds);
 	});
 }
@@ -202,7 +238,7 @@ static void WriteDelays(ExportData& data, const Tempo* tempo)
 	WriteSegments<Delay>(data, "DELAYS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Delay& delay)
 	{
-		data.file.printf("%.6f=%.6f",
+		data.out.printf("%.6f=%.6f",
 			ToBeat(delay.row), delay.seconds);
 	});
 }
@@ -212,7 +248,7 @@ static void WriteWarps(ExportData& data, const Tempo* tempo)
 	WriteSegments<Warp>(data, "WARPS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Warp& warp)
 	{
-		data.file.printf("%.6f=%.6f",
+		data.out.printf("%.6f=%.6f",
 			ToBeat(warp.row), ToBeat(warp.numRows));
 	});
 }
@@ -222,7 +258,7 @@ static void WriteSpeeds(ExportData& data, const Tempo* tempo)
 	WriteSegments<Speed>(data, "SPEEDS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Speed& speed)
 	{
-		data.file.printf("%.6f=%.6f=%.6f=%i",
+		data.out.printf("%.6f=%.6f=%.6f=%i",
 			ToBeat(speed.row), speed.ratio, speed.delay, speed.unit);
 	});
 }
@@ -232,7 +268,7 @@ static void WriteScrolls(ExportData& data, const Tempo* tempo)
 	WriteSegments<Scroll>(data, "SCROLLS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Scroll& scroll)
 	{
-		data.file.printf("%.6f=%.6f",
+		data.out.printf("%.6f=%.6f",
 			ToBeat(scroll.row), scroll.ratio);
 	});
 }
@@ -242,7 +278,7 @@ static void WriteTickCounts(ExportData& data, const Tempo* tempo)
 	WriteSegments<TickCount>(data, "TICKCOUNTS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const TickCount& tick)
 	{
-		data.file.printf("%.6f=%i",
+		data.out.printf("%.6f=%i",
 			ToBeat(tick.row), tick.ticks);
 	});
 }
@@ -252,7 +288,7 @@ static void WriteTimeSignatures(ExportData& data, const Tempo* tempo)
 	WriteSegments<TimeSignature>(data, "TIMESIGNATURES", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const TimeSignature& sig)
 	{
-		data.file.printf("%.6f=%i=%i",
+		data.out.printf("%.6f=%i=%i",
 			ToBeat(sig.row), (int)ToBeat(sig.rowsPerMeasure), sig.beatNote);
 	});
 }
@@ -262,7 +298,7 @@ static void WriteLabels(ExportData& data, const Tempo* tempo)
 	WriteSegments<Label>(data, "LABELS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Label& label)
 	{
-		data.file.printf("%.6f=%s",
+		data.out.printf("%.6f=%s",
 			ToBeat(label.row), label.str.str());
 	});
 }
@@ -272,9 +308,9 @@ static void WriteAttacks(ExportData& data, const Tempo* tempo)
 	WriteTag(data, "ATTACKS", tempo->attacks, START_OF_LINE, ':', NEVER, true,
 	[&](const Attack& attack)
 	{
-		data.file.printf("TIME=%.6f:", attack.time);
-		data.file.printf((attack.unit == ATTACK_END) ? "END=%.6f:" : "LEN=%.6f:", attack.duration);
-		data.file.printf("MODS=%s", attack.mods.str());
+		data.out.printf("TIME=%.6f:", attack.time);
+		data.out.printf((attack.unit == ATTACK_END) ? "END=%.6f:" : "LEN=%.6f:", attack.duration);
+		data.out.printf("MODS=%s", attack.mods.str());
 	});
 }
 
@@ -283,7 +319,7 @@ static void WriteKeySounds(ExportData& data, const Tempo* tempo)
 	WriteTag(data, "KEYSOUNDS", tempo->keysounds, END_OF_LINE, ',', NEVER, true,
 	[&](StringRef str)
 	{
-		data.file.printf("%s", str.str());
+		data.out.printf("%s", str.str());
 	});
 }
 
@@ -292,10 +328,10 @@ static void WriteCombos(ExportData& data, const Tempo* tempo)
 	WriteSegments<Combo>(data, "COMBOS", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Combo& combo)
 	{
-		data.file.printf("%.6f=%i", ToBeat(combo.row), combo.hitCombo);
+		data.out.printf("%.6f=%i", ToBeat(combo.row), combo.hitCombo);
 		if(combo.hitCombo != combo.missCombo)
 		{
-			data.file.printf("=%i", combo.missCombo);
+			data.out.printf("=%i", combo.missCombo);
 		}
 	});
 }
@@ -305,7 +341,7 @@ static void WriteFakes(ExportData& data, const Tempo* tempo)
 	WriteSegments<Fake>(data, "FAKES", tempo, END_OF_LINE, ',', NEVER, true,
 	[&](const Fake& fake)
 	{
-		data.file.printf("%.6f=%.6f",
+		data.out.printf("%.6f=%.6f",
 			ToBeat(fake.row), ToBeat(fake.numRows));
 	});
 }
@@ -368,14 +404,14 @@ static void WriteBgChanges(ExportData& data, const char* tag, const Vector<BgCha
 	{
 		if(bg.effect.empty() && bg.file2.empty() && bg.transition.empty() && bg.color.empty() && bg.color2.empty())
 		{
-			data.file.printf("%.6f=%s=%.6f=0=0=1",
+			data.out.printf("%.6f=%s=%.6f=0=0=1",
 				bg.startBeat,
 				bg.file.str(),
 				bg.rate);
 		}
 		else
 		{
-			data.file.printf("%.6f=%s=%.6f=%d=%d=%d=%s=%s=%s=%s=%s",
+			data.out.printf("%.6f=%s=%.6f=%d=%d=%d=%s=%s=%s=%s=%s",
 				bg.startBeat,
 				bg.file.str(),
 				bg.rate,
@@ -510,8 +546,8 @@ static void WriteSections(ExportData& data)
 
 		std::list<uint> quantVec;
 
-		const Note* it = chart->notes.begin();
-		const Note* end = chart->notes.end();
+		auto it = chart->notes.begin();
+		auto end = chart->notes.end();
 
 		// Write all notes for the current player in blocks of one section.
 		for(; it != end || remainingHolds > 0; startRow += ROWS_PER_NOTE_SECTION)
@@ -545,7 +581,7 @@ static void WriteSections(ExportData& data)
 								--remainingHolds;
 							}
 						}
-						holds[it->col] = it;
+						holds[it->col] = &*it;
 						++remainingHolds;
 					}
 				}
@@ -582,18 +618,18 @@ static void WriteSections(ExportData& data)
 			}
 			for (int k = 0; k < count; ++k, m += pitch)
 			{
-				data.file.write(m, numCols, 1);
-				data.file.write("\n", 1, 1);
+				data.out.write(m, numCols, 1);
+				data.out.write("\n", 1, 1);
 			}
 
 			// Write a comma if this is not the last section.
-			if(it != end || remainingHolds > 0) data.file.write(",\n", 2, 1);
+			if(it != end || remainingHolds > 0) data.out.write(",\n", 2, 1);
 		}
 
 		// Write an ampersand if this is not the last player.
-		if(pn != numPlayers - 1) data.file.write("&\n", 2, 1);
+		if(pn != numPlayers - 1) data.out.write("&\n", 2, 1);
 	}
-	data.file.write(";\n", 2, 1);
+	data.out.write(";\n", 2, 1);
 }
 
 static void WriteChart(ExportData& data)
@@ -618,8 +654,25 @@ static void WriteChart(ExportData& data)
 		data.diffs.push_back(sd);
 	}
 
+	// If the chart was not modified since the previous save, the cached chart data is written.
+	SimFormat format = data.ssc ? SIM_SSC : SIM_SM;
+	if(data.cache && chart->revision)
+	{
+		for(auto& entry : data.cache->entries)
+		{
+			if(entry.revision == chart->revision && entry.format == format && entry.difficulty == diff)
+			{
+				data.out.write(entry.text.str(), entry.text.len(), 1);
+				data.saved.push_back({entry.revision, format, diff, String()});
+				data.saved.back().text.swap(entry.text);
+				return;
+			}
+		}
+	}
+	int begin = data.out.size();
+
 	// Write the output chart data.
-	data.file.printf("//--------------- %s - %s ----------------\n",
+	data.out.printf("//--------------- %s - %s ----------------\n",
 		chart->style->id.str(), chart->artist.str());
 
 	String chartStyle = Escape("chart style", chart->style->id.str());
@@ -636,47 +689,49 @@ static void WriteChart(ExportData& data)
 
 		if(chart->tempo) WriteTempo(data, chart->tempo);
 		
-		data.file.printf("#NOTES:\n");
+		data.out.printf("#NOTES:\n");
 	}
 	else
 	{
-		data.file.printf("#NOTES:\n");
-		data.file.printf("     %s:\n", chartStyle.str());
-		data.file.printf("     %s:\n", chartArtist.str());
-		data.file.printf("     %s:\n", GetDifficultyString(diff));
-		data.file.printf("     %i:\n", chart->meter);
-		data.file.printf("     %s:\n", RadarToString(chart->radar).str());
+		data.out.printf("#NOTES:\n");
+		data.out.printf("     %s:\n", chartStyle.str());
+		data.out.printf("     %s:\n", chartArtist.str());
+		data.out.printf("     %s:\n", GetDifficultyString(diff));
+		data.out.printf("     %i:\n", chart->meter);
+		data.out.printf("     %s:\n", RadarToString(chart->radar).str());
 	}
 
 	WriteSections(data);
+
+	// Store the chart data, so it can be reused by the next save.
+	if(data.cache && chart->revision)
+	{
+		auto text = (const char*)data.out.data() + begin;
+		data.saved.push_back({chart->revision, format, diff, String(text, data.out.size() - begin)});
+	}
 }
 
 // ================================================================================================
 // Simfile saving.
 
-bool SaveSimfile(const Simfile* sim, bool ssc, bool backup)
+bool SaveSimfile(const Simfile* sim, bool ssc, bool backup, ChartCache* cache)
 {
 	ExportData data;
 	data.ssc = ssc;
 	data.chart = nullptr;
+	data.cache = cache;
 	data.sim = sim;
 
 	Path path = sim->dir + sim->file + (ssc ? ".ssc" : ".sm");
-
-	// If a backup file is requested, rename the existing sim before saving over it.
-	if(backup && (path.attributes() & File::ATR_EXISTS))
-	{
-		if(!File::moveFile(path.str, path.str + ".old", true))
-		{
-			String name = path.filename();
-			HudError("Could not backup \"%s\".", name.str());
-		}
-	}
-
-	// Open the output file.
-	if(!data.file.open(path)) return false;
 	GiveUnicodeWarning(path, "sim");
 
+	// The size of the previous save is a good estimate of the output size.
+	FileReader prevFile;
+	bool exists = (path.attributes() & File::ATR_EXISTS) && prevFile.open(path);
+	int prevSize = exists ? (int)prevFile.size() : 0;
+	prevFile.close();
+	data.out.reserve(prevSize + prevSize / 8 + 65536);
+
 	// Start with a version tag for SSC files.
 	if(ssc) WriteTag(data, "VERSION", "0.83", ALWAYS, true);
 
@@ -723,21 +778,23 @@ bool SaveSimfile(const Simfile* sim, bool ssc, bool backup)
 		data.chart = nullptr;
 	}
 
-	HudInfo("Saved: %s", path.filename().str());
+	// Only the charts of this save are kept in the cache.
+	if(cache) cache->entries.swap(data.saved);
 
-	return true;
+	// If the editor crashes or the disk is full while saving, the previous simfile is left intact.
+	return ReplaceSimfile(path.str, data.out.data(), data.out.size(), backup);
 }
 
 }; // anonymous namespace.
 
-bool SaveSm(const Simfile* sim, bool backup)
+bool SaveSm(const Simfile* sim, bool backup, ChartCache* cache)
 {
-	return SaveSimfile(sim, false, backup);
+	return SaveSimfile(sim, false, backup, cache);
 }
 
-bool SaveSsc(const Simfile* sim, bool backup)
+bool SaveSsc(const Simfile* sim, bool backup, ChartCache* cache)
 {
-	return SaveSimfile(sim, true, backup);
+	return SaveSimfile(sim, true, backup, cache);
 }
 
 }; // namespace Sm
@@ -1,10 +1,17 @@
 #include <Simfile/Simfile.h>
 
+#include <Core/Utils.h>
+
+#include <System/Thread.h>
+
 #include <Simfile/Chart.h>
 #include <Simfile/Tempo.h>
 
 namespace Vortex {
 
+// ================================================================================================
+// Simfile.
+
 Simfile::Simfile()
 	: format(SIM_NONE)
 	, previewStart(0.0)
@@ -23,6 +30,59 @@ Simfile::~Simfile()
 	delete tempo;
 }
 
+struct SanitizeThreads : public ParallelThreads
+{
+	Chart** charts;
+	void exec(int item, int thread) override
+	{
+		charts[item]->sanitize();
+	}
+};
+
+void Simfile::copy(const Simfile* other)
+{
+	for(auto chart : charts)
+	{
+		delete chart;
+	}
+	charts.clear();
+	for(auto chart : other->charts)
+	{
+		auto copy = new Chart;
+		copy->copy(chart);
+		charts.push_back(copy);
+	}
+	tempo->copy(other->tempo);
+
+	dir = other->dir;
+	file = other->file;
+	format = other->format;
+
+	title = other->title;
+	titleTr = other->titleTr;
+	subtitle = other->subtitle;
+	subtitleTr = other->subtitleTr;
+	artist = other->artist;
+	artistTr = other->artistTr;
+	genre = other->genre;
+	credit = other->credit;
+
+	music = other->music;
+	banner = other->banner;
+	background = other->background;
+	cdTitle = other->cdTitle;
+	lyricsPath = other->lyricsPath;
+
+	fgChanges = other->fgChanges;
+	bgChanges[0] = other->bgChanges[0];
+	bgChanges[1] = other->bgChanges[1];
+
+	previewStart = other->previewStart;
+	previewLength = other->previewLength;
+
+	isSelectable = other->isSelectable;
+}
+
 void Simfile::sanitize()
 {
 	for(int i = 0; i < charts.size(); ++i)
@@ -35,7 +95,19 @@ void Simfile::sanitize()
 			charts.erase(i--);
 			delete chart;
 		}
-		else
+	}
+
+	// The charts do not share any data, so they are sanitized concurrently.
+	int numThreads = min(charts.size(), ParallelThreads::concurrency());
+	if(numThreads > 1)
+	{
+		SanitizeThreads threads;
+		threads.charts = charts.data();
+		threads.run(charts.size(), numThreads);
+	}
+	else
+	{
+		for(auto chart : charts)
 		{
 			chart->sanitize();
 		}
@@ -43,4 +115,12 @@ void Simfile::sanitize()
 	tempo->sanitize();
 }
 
+void Simfile::loadNotes()
+{
+	for(auto chart : charts)
+	{
+		chart->loadNotes();
+	}
+}
+
 }; // namespace Vortex
@@ -17,6 +17,7 @@ enum SimFormat
 	SIM_OSU,
 	SIM_OSZ,
 	SIM_DWI,
+	SIM_AVPROJ,
 
 	NUM_SIMFILE_FORMATS
 };
@@ -38,8 +39,14 @@ struct Simfile : NonCopyable
 	Simfile();
 	~Simfile();
 
+	// Copies the data of another simfile, including the data of its charts.
+	void copy(const Simfile* other);
+
 	void sanitize();
 
+	// Parses the note data of all charts that were loaded with deferred notes.
+	void loadNotes();
+
 	Vector<Chart*> charts;
 	Tempo* tempo;
 
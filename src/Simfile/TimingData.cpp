@@ -10,9 +10,13 @@
 #include <Simfile/SegmentGroup.h>
 #include <Simfile/Tempo.h>
 
-#include <Managers/TempoMan.h>
-
 #include <float.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace Vortex {
 namespace {
@@ -169,10 +173,13 @@ static WarpResult HandleWarp(Vector<Event>& out, MergedTS* it, MergedTS* end, in
 	return {row, targetTime, it};
 }
 
-static void CreateEvents(Vector<Event>& out, double time, MergedTS* it, MergedTS* end)
+// Creates events for the segments from it to end, starting at the given row and time. The indices
+// of events after which creation can be resumed without having to look back are added to resume.
+static void CreateEvents(Vector<Event>& out, Vector<int>& resume, int row, double time,
+	double spr, MergedTS* it, MergedTS* end)
 {
-	int row = 0, warp;
-	double spr = 1.0, stop, delay;
+	int warp;
+	double stop, delay;
 	while(it != end)
 	{
 		warp = 0;
@@ -208,6 +215,10 @@ static void CreateEvents(Vector<Event>& out, double time, MergedTS* it, MergedTS
 			row = result.row;
 			it = result.it;
 		}
+		else if((it - 1)->seg->row <= row)
+		{
+			resume.push_back(out.size() - 1);
+		}
 
 		if(it == end) break;
 		
@@ -270,40 +281,67 @@ static const TimeSig* MostRecentTimeSig(const Vector<TimeSig>& sigs, int row)
 	return it;
 }
 
-static const Event* MostRecentEvent(const Vector<Event>& events, int row)
+// Returns the number of trailing one bits of x, which must not have all bits set.
+static inline int TrailingOnes(uint x)
 {
-	const Event* it = events.begin(), *mid;
-	int count = events.size(), step;
-	while(count > 1)
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, ~x);
+	return (int)index;
+#else
+	return __builtin_ctz(~x);
+#endif
+}
+
+// Fills out with the sorted index of every position of an Eytzinger ordered array of n values, in
+// which position one is the root and positions 2k and 2k + 1 are the children of position k.
+static int FillEytzingerOrder(int* out, int n, int sortedIndex, int k)
+{
+	if(k <= n)
 	{
-		step = count >> 1;
-		mid = it + step;
-		if(mid->row <= row)
-		{
-			it = mid;
-			count -= step;
-		}
-		else count = step;
+		sortedIndex = FillEytzingerOrder(out, n, sortedIndex, 2 * k);
+		out[k] = sortedIndex++;
+		sortedIndex = FillEytzingerOrder(out, n, sortedIndex, 2 * k + 1);
 	}
-	return it;
+	return sortedIndex;
 }
 
-static const Event* MostRecentEvent(const Vector<Event>& events, double time)
+// Returns the position of the first key greater than value in an Eytzinger ordered array of n keys,
+// or zero if there is none. The loop only depends on the key comparisons through arithmetic, and
+// the first levels of every search share the same few cache lines.
+template <typename T>
+static int EytzingerUpperBound(const T* keys, int n, T value)
 {
-	const Event* it = events.begin(), *mid;
-	int count = events.size(), step;
-	while(count > 1)
+	int k = 1;
+	while(k <= n)
 	{
-		step = count >> 1;
-		mid = it + step;
-		if(mid->time <= time)
+		k = 2 * k + (keys[k] <= value);
+	}
+	return k >> (TrailingOnes(k) + 1);
+}
+
+// Returns the index of the last event of which the key is smaller than or equal to value, or the
+// first event if there is none. Since most lookups are close to the previous one, the last hit and
+// the event after it are checked before searching. The cursor may be left by a lookup in different
+// timing data, in which case it is only a bad guess.
+template <typename T, T Event::*Key>
+static int FindEvent(const Vector<Event>& events, const Vector<T>& keys,
+	const Vector<int>& keyEvents, int& cursor, T value)
+{
+	const Event* e = events.data();
+	int numEvents = events.size();
+	for(int i = cursor, end = min(cursor + 2, numEvents); i < end; ++i)
+	{
+		if((i == 0 || e[i].*Key <= value) && (i + 1 == numEvents || value < e[i + 1].*Key))
 		{
-			it = mid;
-			count -= step;
+			cursor = i;
+			return i;
 		}
-		else count = step;
 	}
-	return it;
+	int k = EytzingerUpperBound(keys.data(), numEvents, value);
+	int upper = k ? keyEvents[k] : numEvents;
+	cursor = max(upper - 1, 0);
+	return cursor;
 }
 
 static double TimeToBeat(const Event* it, double time)
@@ -351,15 +389,112 @@ static double BeatToMeasure(const TimeSig* sig, double beat)
 	return sig->measure + (row - sig->row) / (double)sig->rowsPerMeasure;
 }
 
+// ================================================================================================
+// Batched timing translation functions.
+
+// Returns the end of the run of values from begin that are below limit, given that the value at
+// begin is. Gallops forward before searching, which is fast for both short and long runs.
+template <typename T>
+static int FindRunEnd(const T* values, int begin, int count, T limit)
+{
+	int pos = begin, step = 1;
+	while(pos + step < count && values[pos + step] < limit)
+	{
+		pos += step;
+		step *= 2;
+	}
+	int end = min(pos + step, count);
+	return (int)(std::lower_bound(values + pos + 1, values + end, limit) - values);
+}
+
+// Converts a run of rows that all belong to the same event. The loop has no branches or lookups,
+// which allows the compiler to vectorise it.
+static void RowsToTimes(const Event* it, const int* rows, double* out, int count)
+{
+	const int eventRow = it->row;
+	const double rowTime = it->rowTime, endTime = it->endTime, spr = it->spr;
+	for(int i = 0; i < count; ++i)
+	{
+		int row = rows[i];
+		double time = endTime + (row - eventRow) * spr;
+		out[i] = (row > eventRow) ? time : rowTime;
+	}
+}
+
+// Converts a run of times that all belong to the same event, see RowsToTimes.
+static void TimesToRows(const Event* it, const double* times, int* out, int count)
+{
+	const int eventRow = it->row;
+	const double endTime = it->endTime, spr = it->spr;
+	if(spr > 0.0)
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			double rows = (times[i] - endTime) / spr;
+			out[i] = eventRow + ((rows > 0.0) ? (int)rows : 0);
+		}
+	}
+	else
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			out[i] = eventRow;
+		}
+	}
+}
+
 }; // anonymous namespace
 
 // ================================================================================================
 // Tempo list :: implementation.
 
 TimingData::TimingData()
+	: myOffset(0.0)
 {
 	events.push_back({0, 0.0, 0.0, 0.0, BEATS_PER_ROW});
 	sigs.push_back({0, 0, ROWS_PER_BEAT * 4});
+	myUpdateSearchKeys();
+}
+
+void TimingData::myUpdateSearchKeys()
+{
+	int n = events.size();
+	myKeyEvents.resize(n + 1);
+	myRowKeys.resize(n + 1);
+	myTimeKeys.resize(n + 1);
+	myKeyEvents[0] = myRowKeys[0] = 0;
+	myTimeKeys[0] = 0.0;
+	FillEytzingerOrder(myKeyEvents.data(), n, 0, 1);
+	for(int k = 1; k <= n; ++k)
+	{
+		const Event& event = events[myKeyEvents[k]];
+		myRowKeys[k] = event.row;
+		myTimeKeys[k] = event.time;
+	}
+}
+
+// The index of the most recently found event. Timing data is shared between threads, so each thread
+// keeps its own cursor.
+static thread_local int sLastEvent = 0;
+
+const TimingData::Event* TimingData::myFindEvent(int row) const
+{
+	int i = FindEvent<int, &Event::row>(events, myRowKeys, myKeyEvents, sLastEvent, row);
+	return events.begin() + i;
+}
+
+const TimingData::Event* TimingData::myFindEvent(double time) const
+{
+	int i = FindEvent<double, &Event::time>(events, myTimeKeys, myKeyEvents, sLastEvent, time);
+	return events.begin() + i;
+}
+
+static void MergeSegments(Vector<MergedTS>& out, const SegmentGroup* segments)
+{
+	Merge(out, segments->getList<BpmChange>());
+	Merge(out, segments->getList<Stop>());
+	Merge(out, segments->getList<Delay>());
+	Merge(out, segments->getList<Warp>());
 }
 
 void TimingData::update(const Tempo* tempo)
@@ -367,14 +502,14 @@ void TimingData::update(const Tempo* tempo)
 	// Create an event list from BPM changes, stops, delays and warps.
 	Vector<MergedTS> items(128);
 	auto segments = tempo->segments;
-	Merge(items, segments->getList<BpmChange>());
-	Merge(items, segments->getList<Stop>());
-	Merge(items, segments->getList<Delay>());
-	Merge(items, segments->getList<Warp>());
+	MergeSegments(items, segments);
 
 	events.clear();
-	CreateEvents(events, -tempo->offset, items.begin(), items.end());
+	myResumeEvents.clear();
+	myOffset = tempo->offset;
+	CreateEvents(events, myResumeEvents, 0, -tempo->offset, 1.0, items.begin(), items.end());
 	events.squeeze();
+	myUpdateSearchKeys();
 
 	// Create a measure list from time signatures.
 	sigs.clear();
@@ -382,25 +517,95 @@ void TimingData::update(const Tempo* tempo)
 	sigs.squeeze();
 }
 
+int TimingData::update(const Tempo* tempo, int firstChangedRow)
+{
+	// Find the last event before the changed row after which event creation can be resumed.
+	auto point = std::lower_bound(myResumeEvents.begin(), myResumeEvents.end(), firstChangedRow,
+		[&](int event, int row) { return events[event].row < row; });
+	if(point == myResumeEvents.begin() || tempo->offset != myOffset)
+	{
+		update(tempo);
+		return 0;
+	}
+	int numKept = *(point - 1) + 1;
+	myResumeEvents.truncate(point - myResumeEvents.begin());
+
+	Vector<MergedTS> items(128);
+	auto segments = tempo->segments;
+	MergeSegments(items, segments);
+
+	// Keep the old events after the resume point, so the new events can be compared to them.
+	Vector<Event> oldEvents(events.begin() + numKept, events.end());
+	events.truncate(numKept);
+
+	// Continue from the state at the end of the last kept event.
+	Event last = events.back();
+	auto it = std::upper_bound(items.begin(), items.end(), last.row,
+		[](int row, const MergedTS& item) { return row < item.seg->row; });
+	if(it != items.end())
+	{
+		int row = it->seg->row;
+		double time = last.endTime + (row - last.row) * last.spr;
+		CreateEvents(events, myResumeEvents, row, time, last.spr, it, items.end());
+	}
+	myUpdateSearchKeys();
+
+	sigs.clear();
+	CreateTimeSigs(sigs, segments->begin<TimeSignature>(), segments->end<TimeSignature>());
+	sigs.squeeze();
+
+	// Find the first row at which the new events differ from the old events.
+	auto a = oldEvents.begin(), aEnd = oldEvents.end();
+	auto b = events.begin() + numKept, bEnd = events.end();
+	for(; a != aEnd && b != bEnd; ++a, ++b)
+	{
+		if(memcmp(a, b, sizeof(Event)) != 0) return min(a->row, b->row);
+	}
+	if(a != aEnd) return a->row;
+	if(b != bEnd) return b->row;
+	return INT_MAX;
+}
+
+bool TimingData::updateOffset(const Tempo* tempo, double& outShift)
+{
+	// Without resumable events, the events were not created from timing segments.
+	if(myResumeEvents.empty()) return false;
+
+	double shift = myOffset - tempo->offset;
+	for(auto& event : events)
+	{
+		event.time += shift;
+		event.rowTime += shift;
+		event.endTime += shift;
+	}
+	for(int k = 1; k < myTimeKeys.size(); ++k)
+	{
+		myTimeKeys[k] += shift;
+	}
+	myOffset = tempo->offset;
+	outShift = shift;
+	return true;
+}
+
 double TimingData::timeToBeat(double time) const
 {
-	return TimeToBeat(MostRecentEvent(events, time), time);
+	return TimeToBeat(myFindEvent(time), time);
 }
 
 int TimingData::timeToRow(double time) const
 {
-	return TimeToRow(MostRecentEvent(events, time), time);
+	return TimeToRow(myFindEvent(time), time);
 }
 
 double TimingData::rowToTime(int row) const
 {
-	return RowToTime(MostRecentEvent(events, row), row);
+	return RowToTime(myFindEvent(row), row);
 }
 
 double TimingData::beatToTime(double beat) const
 {
 	int row = (int)ceil(beat * ROWS_PER_BEAT);
-	return BeatToTime(MostRecentEvent(events, row), beat);
+	return BeatToTime(myFindEvent(row), beat);
 }
 
 double TimingData::beatToMeasure(double beat) const
@@ -409,14 +614,53 @@ double TimingData::beatToMeasure(double beat) const
 	return BeatToMeasure(MostRecentTimeSig(sigs, row), beat);
 }
 
-// ================================================================================================
-// TemoTimeTracker.
+void TimingData::rowsToTimes(const int* rows, double* outTimes, int count, bool sorted) const
+{
+	if(!sorted)
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			outTimes[i] = RowToTime(myFindEvent(rows[i]), rows[i]);
+		}
+		return;
+	}
+
+	// Walk through the events and convert the rows of each event as a single run.
+	const Event* it = events.begin(), *last = events.end() - 1;
+	for(int i = 0; i < count;)
+	{
+		while(it != last && (it + 1)->row <= rows[i]) ++it;
+		int runEnd = (it != last) ? FindRunEnd(rows, i, count, (it + 1)->row) : count;
+		RowsToTimes(it, rows + i, outTimes + i, runEnd - i);
+		i = runEnd;
+	}
+}
 
-TempoTimeTracker::TempoTimeTracker()
-	: TempoTimeTracker(gTempo->getTimingData())
+void TimingData::timesToRows(const double* times, int* outRows, int count, bool sorted) const
 {
+	if(!sorted)
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			outRows[i] = TimeToRow(myFindEvent(times[i]), times[i]);
+		}
+		return;
+	}
+
+	// Walk through the events and convert the times of each event as a single run.
+	const Event* it = events.begin(), *last = events.end() - 1;
+	for(int i = 0; i < count;)
+	{
+		while(it != last && (it + 1)->time <= times[i]) ++it;
+		int runEnd = (it != last) ? FindRunEnd(times, i, count, (it + 1)->time) : count;
+		TimesToRows(it, times + i, outRows + i, runEnd - i);
+		i = runEnd;
+	}
 }
 
+// ================================================================================================
+// TemoTimeTracker.
+
 TempoTimeTracker::TempoTimeTracker(const TimingData& data)
 	: it(data.events.begin())
 	, end(data.events.end())
@@ -478,11 +722,6 @@ double TempoTimeTracker::lookAhead(int row) const
 // ================================================================================================
 // TemoRowTracker.
 
-TempoRowTracker::TempoRowTracker()
-	: TempoRowTracker(gTempo->getTimingData())
-{
-}
-
 TempoRowTracker::TempoRowTracker(const TimingData& data)
 	: it(data.events.begin())
 	, end(data.events.end())
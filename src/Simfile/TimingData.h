@@ -21,7 +21,17 @@ struct TimingData
 
 	TimingData();
 
+	// Recreates the events and time signatures from the given tempo.
 	void update(const Tempo* tempo);
+
+	// Recreates the events from the given tempo, which must be the tempo of the previous update with
+	// changes on or after firstChangedRow only. Events before that row are kept. Returns the first
+	// row of which the timing changed, or INT_MAX if the timing did not change.
+	int update(const Tempo* tempo, int firstChangedRow);
+
+	// Shifts the event times to the offset of the given tempo, which must be the tempo of the previous
+	// update with a changed offset only. Returns false if the events have to be recreated instead.
+	bool updateOffset(const Tempo* tempo, double& outShift);
 	
 	// Returns the row corresponding to the given time.
 	int timeToRow(double time) const;
@@ -38,8 +48,30 @@ struct TimingData
 	// Returns the measure corresponding to the given beat.
 	double beatToMeasure(double beat) const;
 
+	// Converts count rows to times. If sorted is true, the rows must be in ascending order, which
+	// lets the conversion walk through the events once instead of searching them for every row.
+	void rowsToTimes(const int* rows, double* outTimes, int count, bool sorted) const;
+
+	// Converts count times to rows. If sorted is true, the times must be in ascending order, which
+	// lets the conversion walk through the events once instead of searching them for every time.
+	void timesToRows(const double* times, int* outRows, int count, bool sorted) const;
+
 	Vector<Event> events;
 	Vector<TimeSig> sigs;
+
+private:
+	void myUpdateSearchKeys();
+	const Event* myFindEvent(int row) const;
+	const Event* myFindEvent(double time) const;
+
+	// The rows and times of the events are also stored in compact arrays in Eytzinger order, which
+	// keeps the searches for single values within a few cache lines.
+	Vector<int> myRowKeys;
+	Vector<double> myTimeKeys;
+	Vector<int> myKeyEvents;
+
+	Vector<int> myResumeEvents;
+	double myOffset;
 };
 
 // ================================================================================================
@@ -47,9 +79,6 @@ struct TimingData
 
 struct TempoTimeTracker
 {
-	// Constructs a tracker from the timing data of the active chart.
-	TempoTimeTracker();
-
 	// Constructs a tracker from the given timing data.
 	TempoTimeTracker(const TimingData& data);
 	
@@ -65,9 +94,6 @@ struct TempoTimeTracker
 
 struct TempoRowTracker
 {
-	// Constructs a tracker from the timing data of the active chart.
-	TempoRowTracker();
-
 	// Constructs a tracker from the given timing data.
 	TempoRowTracker(const TimingData& data);
 
@@ -16,6 +16,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <io.h>
 
 namespace Vortex {
 namespace {
@@ -466,6 +467,84 @@ void FileWriter::printf(const char* fmt, ...)
 	va_end(args);
 }
 
+bool FileWriter::flush()
+{
+	return file && fflush(static_cast<FILE*>(file)) == 0;
+}
+
+bool FileWriter::sync()
+{
+	FILE* fp = static_cast<FILE*>(file);
+	return fp && fflush(fp) == 0 && _commit(_fileno(fp)) == 0;
+}
+
+// ================================================================================================
+// Mapped file.
+
+MappedFile::MappedFile()
+	: data(nullptr)
+	, size(0)
+	, file(INVALID_HANDLE_VALUE)
+	, mapping(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(StringRef path)
+{
+	close();
+
+	WideString wpath = Widen(path);
+	file = CreateFileW(wpath.str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		Debug::blockBegin(Debug::ERROR, "could not open file");
+		Debug::log("file: %s\n", path.str());
+		Debug::blockEnd();
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize))
+	{
+		close();
+		return false;
+	}
+
+	// Empty files can not be mapped, but they are valid files.
+	size = (size_t)fileSize.QuadPart;
+	if(size == 0) return true;
+
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping)
+	{
+		data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if(!data)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(data) UnmapViewOfFile(data);
+	if(mapping) CloseHandle(mapping);
+	if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+
+	data = nullptr;
+	size = 0;
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+}
+
 // ================================================================================================
 // File utilities.
 
@@ -486,6 +565,13 @@ long getSize(StringRef path)
 	return size;
 }
 
+ulong getModifiedTime(StringRef path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if(!GetFileAttributesExW(Widen(path).str(), GetFileExInfoStandard, &data)) return 0;
+	return ((ulong)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
 String getText(StringRef path, bool* success)
 {
 	FILE* fp = OpenFile(path, false);
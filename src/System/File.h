@@ -108,7 +108,29 @@ struct FileWriter
 	size_t write(const void* ptr, size_t size, size_t count);
 	void printf(const char* format, ...);
 
+	/// Passes the buffered data to the operating system.
+	bool flush();
+
+	/// Flushes the written data and waits until it is stored on disk.
+	bool sync();
+
+	void* file;
+};
+
+/// Maps the contents of a file into memory, for reading.
+struct MappedFile
+{
+	MappedFile();
+	~MappedFile();
+
+	bool open(StringRef path);
+	void close();
+
+	const char* data;
+	size_t size;
+
 	void* file;
+	void* mapping;
 };
 
 namespace File
@@ -125,6 +147,10 @@ namespace File
 	/// Returns the size in bytes of a file.
 	extern long getSize(StringRef path, bool* success);
 
+	/// Returns the time at which a file or directory was last modified, or zero if it does not
+	/// exist. The value can only be compared to other modification times.
+	extern ulong getModifiedTime(StringRef path);
+
 	/// Returns a string with the contents of a file.
 	extern String getText(StringRef path, bool* success);
 
@@ -5,14 +5,27 @@
 
 #include <vector>
 
+#ifdef _WIN32
+
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
 #undef min
 #undef max
 
+#else
+
+// Other platforms use the standard library threads, so the command line tools can be built there.
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#endif
+
 namespace Vortex {
 
+#ifdef _WIN32
+
 // ================================================================================================
 // BackgroundThread.
 
@@ -199,4 +212,154 @@ void CriticalSection::unlock()
 		LeaveCriticalSection((LPCRITICAL_SECTION)criticalSectionHandle);
 }
 
+#else // _WIN32
+
+// ================================================================================================
+// BackgroundThread.
+
+#define BTDATA ((BackgroundThreadData*)data_)
+
+struct BackgroundThreadData
+{
+	BackgroundThread* owner;
+	std::thread handle;
+	std::atomic<uchar> done;
+};
+
+static void BackgroundThreadFunc(BackgroundThreadData* data)
+{
+	data->owner->exec();
+	data->done = 1;
+}
+
+BackgroundThread::BackgroundThread()
+{
+	auto data = new BackgroundThreadData;
+	terminationFlag_ = 0;
+	data->owner = this;
+	data->done = 0;
+	data_ = data;
+}
+
+BackgroundThread::~BackgroundThread()
+{
+	terminate();
+	delete BTDATA;
+}
+
+void BackgroundThread::start()
+{
+	if(!BTDATA->handle.joinable() && BTDATA->done == 0)
+	{
+		BTDATA->handle = std::thread(BackgroundThreadFunc, BTDATA);
+	}
+}
+
+void BackgroundThread::terminate()
+{
+	if(BTDATA->handle.joinable())
+	{
+		terminationFlag_ = 1;
+		waitUntilDone();
+	}
+}
+
+void BackgroundThread::waitUntilDone()
+{
+	if(BTDATA->handle.joinable())
+	{
+		BTDATA->handle.join();
+	}
+}
+
+bool BackgroundThread::isDone() const
+{
+	return BTDATA->done != 0;
+}
+
+// ================================================================================================
+// ParallelThreads.
+
+struct ParallelThreadsShared
+{
+	ParallelThreads* owner;
+	int size;
+	std::atomic<int> counter;
+};
+
+static void ParallelThreadsFunc(ParallelThreadsShared* shared, int index)
+{
+	while(true)
+	{
+		int pos = --shared->counter;
+		if(pos < 0) break;
+		int item = shared->size - 1 - pos;
+		shared->owner->exec(item, index);
+	}
+}
+
+ParallelThreads::ParallelThreads()
+{
+}
+
+ParallelThreads::~ParallelThreads()
+{
+}
+
+int ParallelThreads::concurrency()
+{
+	static int s_num_of_procs = 0;
+	if (s_num_of_procs == 0)
+	{
+		s_num_of_procs = clamp<int>((int)std::thread::hardware_concurrency(), 1, 16);
+	}
+	return s_num_of_procs;
+}
+
+void ParallelThreads::run(int numItems, int numThreads)
+{
+	if(numItems <= 0 || numThreads <= 0) return;
+
+	ParallelThreadsShared shared;
+	shared.size = numItems;
+	shared.counter = numItems;
+	shared.owner = this;
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for(int i = 0; i < numThreads; ++i)
+	{
+		threads.emplace_back(ParallelThreadsFunc, &shared, i);
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+// ================================================================================================
+// CriticalSection.
+
+CriticalSection::CriticalSection()
+	: criticalSectionHandle(new std::recursive_mutex)
+{
+}
+
+CriticalSection::~CriticalSection()
+{
+	delete (std::recursive_mutex*)criticalSectionHandle;
+}
+
+void CriticalSection::lock()
+{
+	((std::recursive_mutex*)criticalSectionHandle)->lock();
+}
+
+void CriticalSection::unlock()
+{
+	((std::recursive_mutex*)criticalSectionHandle)->unlock();
+}
+
+#endif // _WIN32
+
 }; // namespace Vortex
@@ -0,0 +1,314 @@
+// Headless BPM/offset analysis of entire song packs.
+//
+// Usage: BatchTempo <directory> [-j workers] [-f csv|json] [-o output] [-l seconds]
+//
+// Finds every simfile in the directory (recursively), decodes its music, runs the tempo detector
+// on it and writes a report that compares the best estimate to the #BPMS/#OFFSET of the simfile.
+
+#include <Core/StringUtils.h>
+#include <Core/Utils.h>
+
+#include <System/File.h>
+#include <System/Debug.h>
+#include <System/Thread.h>
+
+#include <Simfile/Parsing.h>
+
+#include <Editor/Sound.h>
+#include <Editor/FindOnsets.h>
+#include <Editor/FindTempo.h>
+
+#include <Tools/Common.h>
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+namespace Vortex {
+
+namespace {
+
+// Differences below these thresholds are reported as a match.
+static const double BpmTolerance = 0.05;
+static const double OffsetTolerance = 0.010;
+
+struct Options
+{
+	String dir;
+	String output;
+	int numWorkers;
+	bool json;
+	double maxLength;
+};
+
+struct SongReport
+{
+	String simfile;
+	String music;
+	double simBpm;
+	double simOffset;
+	int numBpmChanges;
+	TempoResult detected;
+	bool hasResult;
+	double seconds;
+	String error;
+};
+
+// ================================================================================================
+// Simfile scanning.
+
+// Returns one simfile per song directory, giving priority to ssc over sm files.
+static Vector<Path> FindSimfiles(StringRef dir)
+{
+	Vector<Path> out;
+	for(auto& file : File::findFiles(dir, true, "ssc;sm"))
+	{
+		String fileDir = file.dir();
+		auto it = std::find_if(out.begin(), out.end(),
+			[&](const Path& p) { return p.dir() == fileDir; });
+		if(it == out.end())
+		{
+			out.push_back(file);
+		}
+		else if(file.hasExt("ssc") && !it->hasExt("ssc"))
+		{
+			*it = file;
+		}
+	}
+	return out;
+}
+
+// Reads the music path, offset and BPM changes from the song header of the simfile.
+static bool ReadSongHeader(SongReport& song)
+{
+	String text;
+	if(!ParseSimfile(text, song.simfile))
+	{
+		song.error = "could not read simfile";
+		return false;
+	}
+
+	bool hasOffset = false, hasBpms = false;
+	char* p = text.begin(), *tag, *val;
+	while(ParseNextTag(p, tag, val))
+	{
+		if(Str::iequal(tag, "NOTES") || Str::iequal(tag, "NOTEDATA"))
+		{
+			break; // The remaining tags belong to charts.
+		}
+		else if(Str::iequal(tag, "MUSIC"))
+		{
+			song.music = val;
+			Str::trim(song.music);
+		}
+		else if(Str::iequal(tag, "OFFSET") && !hasOffset)
+		{
+			hasOffset = ParseVal(val, song.simOffset);
+		}
+		else if(Str::iequal(tag, "BPMS") && !hasBpms)
+		{
+			char* item[2];
+			while(ParseNextItem(val, item, 2))
+			{
+				double bpm;
+				if(ParseVal(item[1], bpm))
+				{
+					if(song.numBpmChanges == 0) song.simBpm = bpm;
+					++song.numBpmChanges;
+				}
+			}
+			hasBpms = (song.numBpmChanges > 0);
+		}
+	}
+
+	if(song.music.empty())
+	{
+		song.error = "simfile has no music";
+		return false;
+	}
+	return true;
+}
+
+// ================================================================================================
+// Song analysis.
+
+static void AnalyzeSong(SongReport& song, double maxLength)
+{
+	auto startTime = Debug::getElapsedTime();
+
+	if(!ReadSongHeader(song)) return;
+
+	// Decode the music on this thread; the samples are released when the song is done.
+	Sound sound;
+	String title, artist;
+	Path musicPath(Path(song.simfile).dir(), song.music);
+	if(!sound.load(musicPath.str.str(), false, title, artist) || sound.getNumFrames() == 0)
+	{
+		song.error = "could not load music";
+		return;
+	}
+
+	// Only the analyzed part of the music is needed for the onsets.
+	int numFrames = (int)min(maxLength * sound.getFrequency(), (double)sound.getNumFrames());
+
+	uchar terminate = 0;
+	OnsetCache onsets;
+	FindOnsets(sound.samplesL(), sound.samplesR(), sound.getFrequency(), numFrames, &terminate,
+		onsets);
+
+	Vector<TempoResult> results;
+	FindTempo(sound.samplesL(), sound.samplesR(), sound.getFrequency(), onsets, 0, numFrames, 1,
+		results);
+	if(results.size())
+	{
+		// The detector reports the first beat position, the simfile offset is its negation.
+		song.detected = results[0];
+		song.detected.offset = -results[0].offset;
+		song.hasResult = true;
+	}
+
+	song.seconds = Debug::getElapsedTime(startTime);
+}
+
+struct AnalysisThreads : public ParallelThreads
+{
+	SongReport* songs;
+	double maxLength;
+	void exec(int item, int thread) override
+	{
+		AnalyzeSong(songs[item], maxLength);
+	}
+};
+
+// ================================================================================================
+// Report output.
+
+// Returns the offset difference, ignoring differences of whole beats.
+static double OffsetDifference(const SongReport& song)
+{
+	double spb = 60.0 / song.detected.bpm;
+	double diff = song.detected.offset - song.simOffset;
+	return diff - floor(diff / spb + 0.5) * spb;
+}
+
+static const char* GetStatus(const SongReport& song)
+{
+	if(song.error.len()) return song.error.str();
+	if(!song.hasResult) return "no result";
+	if(song.numBpmChanges == 0) return "no simfile bpm";
+	if(fabs(song.detected.bpm - song.simBpm) > BpmTolerance) return "bpm mismatch";
+	if(fabs(OffsetDifference(song)) > OffsetTolerance) return "offset mismatch";
+	return "match";
+}
+
+static String WriteReport(const Vector<SongReport>& songs, bool json)
+{
+	ToolReport report("simfile,music,sim_bpm,sim_offset,bpm_changes,"
+		"detected_bpm,detected_offset,fitness,bpm_diff,offset_diff,seconds,status");
+	for(auto& song : songs)
+	{
+		report.addRow();
+		report.add(song.simfile);
+		report.add(song.music);
+		report.add(song.simBpm, 3);
+		report.add(song.simOffset, 3);
+		report.add(song.numBpmChanges);
+		if(song.hasResult)
+		{
+			report.add(song.detected.bpm, 3);
+			report.add(song.detected.offset, 3);
+			report.add(song.detected.fitness, 3);
+			report.add(song.detected.bpm - song.simBpm, 3);
+			report.add(OffsetDifference(song), 3);
+		}
+		else
+		{
+			for(int i = 0; i < 5; ++i) report.addEmpty();
+		}
+		report.add(song.seconds, 2);
+		report.add(String(GetStatus(song)));
+	}
+	return report.format(json);
+}
+
+// ================================================================================================
+// Main function.
+
+static bool ParseOptions(Options& opt, int argc, char** argv)
+{
+	opt.numWorkers = ParallelThreads::concurrency();
+	opt.json = false;
+	opt.maxLength = 600.0;
+
+	const ToolOption options[] =
+	{
+		{"-j", ToolOption::INT, &opt.numWorkers, 1, MaxToolThreads},
+		{"-f", ToolOption::FORMAT, &opt.json, 0, 0},
+		{"-o", ToolOption::STRING, &opt.output, 0, 0},
+		{"-l", ToolOption::DOUBLE, &opt.maxLength, 1, 1e9},
+	};
+	return ParseToolOptions(argc, argv, options, 4, &opt.dir);
+}
+
+static int Run(int argc, char** argv)
+{
+	Options opt;
+	if(!ParseOptions(opt, argc, argv))
+	{
+		fprintf(stderr, "usage: BatchTempo <directory> [-j workers] [-f csv|json] [-o output] "
+			"[-l seconds]\n");
+		return 1;
+	}
+
+	Vector<SongReport> songs;
+	for(auto& path : FindSimfiles(opt.dir))
+	{
+		SongReport& song = songs.append();
+		song.simfile = path.str;
+		song.simBpm = 0.0;
+		song.simOffset = 0.0;
+		song.numBpmChanges = 0;
+		song.detected = {0.0, 0.0, 0.0};
+		song.hasResult = false;
+		song.seconds = 0.0;
+	}
+	if(songs.empty())
+	{
+		HudError("No simfiles found in \"%s\".", opt.dir.str());
+		return 1;
+	}
+
+	// Each worker decodes one song at a time, which bounds the memory use to the worker count.
+	auto startTime = Debug::getElapsedTime();
+	AnalysisThreads threads;
+	threads.songs = songs.data();
+	threads.maxLength = opt.maxLength;
+	threads.run(songs.size(), min(opt.numWorkers, songs.size()));
+	HudNote("Analyzed %i songs in %.2f seconds.", songs.size(), Debug::getElapsedTime(startTime));
+
+	String report = WriteReport(songs, opt.json);
+
+	if(opt.output.empty())
+	{
+		fwrite(report.str(), 1, report.len(), stdout);
+	}
+	else
+	{
+		FileWriter file;
+		if(!file.open(opt.output))
+		{
+			HudError("Could not write \"%s\".", opt.output.str());
+			return 1;
+		}
+		file.write(report.str(), 1, report.len());
+	}
+	return 0;
+}
+
+}; // anonymous namespace
+}; // namespace Vortex
+
+int main(int argc, char** argv)
+{
+	return Vortex::Run(argc, argv);
+}
@@ -0,0 +1,200 @@
+#include <Tools/Common.h>
+
+#include <Core/StringUtils.h>
+#include <Core/Utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+namespace Vortex {
+
+// ================================================================================================
+// HUD messages are written to the standard error output.
+
+static void PrintMessage(const char* type, const char* fmt, va_list args)
+{
+	char buffer[1024];
+	vsnprintf(buffer, sizeof(buffer), fmt, args);
+	fprintf(stderr, "%s: %s\n", type, buffer);
+}
+
+void HudNote(const char* fmt, ...)
+{
+	va_list args; va_start(args, fmt); PrintMessage("note", fmt, args); va_end(args);
+}
+
+void HudInfo(const char* fmt, ...)
+{
+	va_list args; va_start(args, fmt); PrintMessage("info", fmt, args); va_end(args);
+}
+
+void HudWarning(const char* fmt, ...)
+{
+	va_list args; va_start(args, fmt); PrintMessage("warning", fmt, args); va_end(args);
+}
+
+void HudError(const char* fmt, ...)
+{
+	va_list args; va_start(args, fmt); PrintMessage("error", fmt, args); va_end(args);
+}
+
+// ================================================================================================
+// Command line options.
+
+static bool ReadOption(const ToolOption& option, const char* value)
+{
+	switch(option.type)
+	{
+	case ToolOption::INT:
+		*(int*)option.value = (int)clamp((double)atoi(value), option.minValue, option.maxValue);
+		return true;
+	case ToolOption::DOUBLE:
+		*(double*)option.value = clamp(atof(value), option.minValue, option.maxValue);
+		return true;
+	case ToolOption::STRING:
+		*(String*)option.value = value;
+		return true;
+	case ToolOption::FORMAT:
+		*(bool*)option.value = !strcmp(value, "json");
+		return !strcmp(value, "json") || !strcmp(value, "csv");
+	default:
+		return false;
+	}
+}
+
+bool ParseToolOptions(int argc, char** argv, const ToolOption* options, int numOptions,
+	String* positional)
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		const ToolOption* option = nullptr;
+		for(int j = 0; j < numOptions && !option; ++j)
+		{
+			if(!strcmp(argv[i], options[j].name)) option = options + j;
+		}
+		if(option && option->type == ToolOption::FLAG)
+		{
+			*(bool*)option->value = true;
+		}
+		else if(option)
+		{
+			if(i + 1 == argc || !ReadOption(*option, argv[++i])) return false;
+		}
+		else if(positional && positional->empty() && argv[i][0] && argv[i][0] != '-')
+		{
+			*positional = argv[i];
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return !positional || positional->len() > 0;
+}
+
+// ================================================================================================
+// Reports.
+
+ToolReport::ToolReport(const char* columns)
+{
+	myColumns = Str::split(columns, ",");
+}
+
+void ToolReport::addRow()
+{
+	myRows.append();
+}
+
+void ToolReport::add(StringRef value)
+{
+	myRows.back().push_back({value, true});
+}
+
+void ToolReport::add(int value)
+{
+	myRows.back().push_back({Str::val(value), false});
+}
+
+void ToolReport::add(double value, int decimals)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+	myRows.back().push_back({buffer, false});
+}
+
+void ToolReport::addEmpty()
+{
+	myRows.back().push_back({String(), false});
+}
+
+static void AppendQuoted(String& out, StringRef str, bool json)
+{
+	Str::append(out, '"');
+	for(const char* c = str.begin(); c != str.end(); ++c)
+	{
+		if(*c == '"') Str::append(out, json ? "\\\"" : "\"\"");
+		else if(*c == '\\' && json) Str::append(out, "\\\\");
+		else Str::append(out, *c);
+	}
+	Str::append(out, '"');
+}
+
+String ToolReport::format(bool json) const
+{
+	String out;
+	if(json)
+	{
+		Str::append(out, "[\n");
+		for(int i = 0; i < myRows.size(); ++i)
+		{
+			auto& row = myRows[i];
+			Str::append(out, "  {");
+			for(int c = 0; c < row.size() && c < myColumns.size(); ++c)
+			{
+				if(c > 0) Str::append(out, ", ");
+				AppendQuoted(out, myColumns[c], true);
+				Str::append(out, ": ");
+				if(row[c].quoted)
+				{
+					AppendQuoted(out, row[c].text, true);
+				}
+				else
+				{
+					Str::append(out, row[c].text.len() ? row[c].text : String("null"));
+				}
+			}
+			Str::append(out, (i + 1 < myRows.size()) ? "},\n" : "}\n");
+		}
+		Str::append(out, "]\n");
+	}
+	else
+	{
+		for(int c = 0; c < myColumns.size(); ++c)
+		{
+			if(c > 0) Str::append(out, ',');
+			Str::append(out, myColumns[c]);
+		}
+		Str::append(out, '\n');
+		for(auto& row : myRows)
+		{
+			for(int c = 0; c < row.size(); ++c)
+			{
+				if(c > 0) Str::append(out, ',');
+				if(row[c].quoted)
+				{
+					AppendQuoted(out, row[c].text, false);
+				}
+				else
+				{
+					Str::append(out, row[c].text);
+				}
+			}
+			Str::append(out, '\n');
+		}
+	}
+	return out;
+}
+
+}; // namespace Vortex
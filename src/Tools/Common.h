@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Core/String.h>
+#include <Core/Vector.h>
+
+namespace Vortex {
+
+// ================================================================================================
+// Command line options.
+
+/// ParallelThreads waits for its threads with WaitForMultipleObjects, which supports at most 64.
+static const int MaxToolThreads = 64;
+
+/// Describes a command line option of a tool.
+struct ToolOption
+{
+	enum Type
+	{
+		INT,    ///< Reads an int, which is clamped to [minValue, maxValue].
+		DOUBLE, ///< Reads a double, which is clamped to [minValue, maxValue].
+		STRING, ///< Reads a String.
+		FLAG,   ///< Sets a bool to true, the option has no value.
+		FORMAT, ///< Reads "csv" or "json", and sets a bool to true for json.
+	};
+
+	const char* name; ///< Name of the option, e.g. "-j".
+	Type type;
+	void* value;      ///< Points to the int, double, String or bool that receives the value.
+	double minValue;
+	double maxValue;
+};
+
+/// Parses the command line arguments of a tool. If positional is not null, the first argument that
+/// is not an option is written to it, and it is required. Returns false if an argument is unknown,
+/// a value is missing, or the positional argument is missing.
+bool ParseToolOptions(int argc, char** argv, const ToolOption* options, int numOptions,
+	String* positional = nullptr);
+
+// ================================================================================================
+// Reports.
+
+/// A table of results, which is written as CSV or as a JSON array with an object per row. The
+/// column names are used as the CSV header and as the JSON keys.
+class ToolReport
+{
+public:
+	/// The columns are given as a comma separated list, e.g. "simfile,step,ms".
+	ToolReport(const char* columns);
+
+	/// Starts a new row, the values of the row are added in column order.
+	void addRow();
+
+	/// Adds a string value, which is quoted in the output.
+	void add(StringRef value);
+
+	/// Adds an integer value.
+	void add(int value);
+
+	/// Adds a floating point value with the given number of decimals.
+	void add(double value, int decimals);
+
+	/// Adds an empty value, which is written as null in JSON.
+	void addEmpty();
+
+	/// Returns the report as CSV, or as JSON if json is true.
+	String format(bool json) const;
+
+private:
+	struct Value { String text; bool quoted; };
+	Vector<String> myColumns;
+	Vector<Vector<Value>> myRows;
+};
+
+}; // namespace Vortex
@@ -0,0 +1,663 @@
+// Stress test and speed benchmark for loading, updating and saving pathological simfiles.
+//
+// Usage: SimfileBench [-o directory] [-r repeats] [-f csv|json] [-g]
+//
+// Generates a few synthetic simfiles in the output directory, from a plain chart to gimmick charts
+// with thousands of stops, delays and warps, negative BPMs, a 50k-note marathon, a simfile with
+// twenty split timing charts and a simfile with a hundred charts. Each simfile is tokenized by both
+// the old and the memory-mapped tokenizer, loaded, its charts are sanitized, its timing data is
+// built, its notes are expanded like the editor does when a chart is opened, the expanded notes are
+// walked like the per-frame passes of the editor do, and it is saved again.
+// It is also loaded with deferred notes, like the editor does, followed by opening one chart.
+// Then, one chart is modified and the simfile is saved with the charts cached by a previous save,
+// which must give the same file as a full save. Finally, the simfile is saved as a project and
+// loaded again, and the project is exported to ssc, which must also give the same file.
+// Reports the time of each step. The saved simfile and the simfile with deferred notes are loaded
+// again and compared to the original, as are the tags of the two tokenizers; the exit code is
+// non-zero if anything differs. With -g, the simfiles are generated but not benchmarked, so they
+// can be opened in the editor. The styles are read from the settings directory, so run it from the
+// directory that contains the editor executable.
+
+#include <Core/StringUtils.h>
+#include <Core/Utils.h>
+
+#include <System/File.h>
+#include <System/Debug.h>
+
+#include <Simfile/Parsing.h>
+#include <Simfile/Chart.h>
+#include <Simfile/Tempo.h>
+#include <Simfile/Notes.h>
+#include <Simfile/SegmentGroup.h>
+#include <Simfile/TimingData.h>
+
+#include <Managers/StyleMan.h>
+
+#include <Tools/Common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+namespace Vortex {
+
+namespace {
+
+static const int NumCols = 4;
+static const int LinesPerMeasure = 16;
+static const int RowsPerLine = ROWS_PER_BEAT * 4 / LinesPerMeasure;
+
+struct BenchCase
+{
+	const char* name;
+	int numCharts;
+	int numNotes;
+	int numBpmChanges;
+	int numStops;
+	int numWarps;
+	int numNegativeBpms;
+	bool splitTiming;
+};
+
+// The stop count is used for both the stops and the delays.
+static const BenchCase sCases[] =
+{
+	{"baseline",      5,  1000,    1,    0,    0,   0, false},
+	{"gimmick",       1,  5000, 2000, 5000, 5000,   0, false},
+	{"negative-bpm",  1,  5000,  500,  500,    0, 500, false},
+	{"marathon",      1, 50000,  100,  100,    0,   0, false},
+	{"split-timing", 20,  2000,  200,  200,  100,   0, true},
+	{"many-charts", 100,  5000,   50,   50,    0,   0, false},
+};
+
+enum Step
+{
+	STEP_PARSE,
+	STEP_TOKENIZE,
+	STEP_LOAD,
+	STEP_LOAD_DEFERRED,
+	STEP_SANITIZE,
+	STEP_TIMING,
+	STEP_NOTES,
+	STEP_NOTE_PASSES,
+	STEP_SAVE,
+	STEP_SAVE_INCREMENTAL,
+	STEP_SAVE_PROJECT,
+	STEP_LOAD_PROJECT,
+
+	NUM_STEPS
+};
+
+static const char* sStepNames[NUM_STEPS] =
+{
+	"ParseSimfile",
+	"TokenizeSimfile",
+	"LoadSimfile",
+	"LoadSimfile (deferred)",
+	"Simfile::sanitize",
+	"TimingData::update",
+	"UpdateNotes",
+	"Note passes",
+	"SaveSimfile",
+	"SaveSimfile (incremental)",
+	"SaveSimfile (project)",
+	"LoadSimfile (project, deferred)",
+};
+
+struct Options
+{
+	String dir;
+	int repeats;
+	bool json;
+	bool generateOnly;
+};
+
+struct BenchResult
+{
+	int numCharts;
+	int numNotes;
+	int numSegments;
+	double ms[NUM_STEPS];
+	bool failed;
+	bool mismatch;
+};
+
+// ================================================================================================
+// Simfile synthesis.
+
+// Small deterministic random number generator, so every run benchmarks the same simfiles.
+struct Random
+{
+	uint state;
+	int next(int range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return (int)((state >> 8) % (uint)range);
+	}
+};
+
+struct RowValue
+{
+	int row;
+	double val;
+	bool operator < (const RowValue& other) const { return row < other.row; }
+};
+
+static int NumMeasures(const BenchCase& c)
+{
+	// About three quarters of the lines have a note.
+	return max(16, c.numNotes / (LinesPerMeasure * 3 / 4) + 1);
+}
+
+// Writes a list of segments as "beat=value,...", keeping the first segment on each row.
+static void WriteSegments(FileWriter& file, const char* tag, Vector<RowValue>& list)
+{
+	std::stable_sort(list.begin(), list.end());
+	file.printf("#%s:", tag);
+	int lastRow = -1;
+	for(auto& seg : list)
+	{
+		if(seg.row == lastRow) continue;
+		file.printf("%s%.3f=%.3f\n", lastRow < 0 ? "" : ",", seg.row * BEATS_PER_ROW, seg.val);
+		lastRow = seg.row;
+	}
+	file.printf(";\n");
+}
+
+static void WriteTempo(FileWriter& file, const BenchCase& c, uint seed)
+{
+	Random rng = {seed};
+	int numRows = NumMeasures(c) * ROWS_PER_BEAT * 4;
+	auto randomRow = [&]() { return rng.next(numRows / RowsPerLine) * RowsPerLine; };
+
+	Vector<RowValue> bpms, stops, delays, warps;
+	bpms.push_back({0, 150.0});
+	for(int i = 1; i < c.numBpmChanges; ++i)
+	{
+		bpms.push_back({randomRow(), 60.0 + rng.next(24000) * 0.01});
+	}
+
+	// A negative BPM is followed by a positive BPM that scrolls the chart forward again.
+	for(int i = 0; i < c.numNegativeBpms; ++i)
+	{
+		int row = max(RowsPerLine, randomRow());
+		bpms.push_back({row, -60.0 - rng.next(18000) * 0.01});
+		bpms.push_back({row + RowsPerLine * (1 + rng.next(8)), 60.0 + rng.next(24000) * 0.01});
+	}
+	for(int i = 0; i < c.numStops; ++i)
+	{
+		stops.push_back({randomRow(), 0.001 + rng.next(1000) * 0.001});
+		delays.push_back({randomRow(), 0.001 + rng.next(1000) * 0.001});
+	}
+	for(int i = 0; i < c.numWarps; ++i)
+	{
+		warps.push_back({randomRow(), (1 + rng.next(8)) * 0.25});
+	}
+
+	file.printf("#OFFSET:%.3f;\n", -0.1 - rng.next(100) * 0.001);
+	WriteSegments(file, "BPMS", bpms);
+	WriteSegments(file, "STOPS", stops);
+	WriteSegments(file, "DELAYS", delays);
+	WriteSegments(file, "WARPS", warps);
+}
+
+// Writes a stream of steps, jumps, holds, rolls and mines in 16th notes.
+static void WriteNotes(FileWriter& file, const BenchCase& c, uint seed)
+{
+	Random rng = {seed};
+	int holdLines[NumCols] = {};
+	int numMeasures = NumMeasures(c);
+	file.printf("#NOTES:\n");
+	for(int m = 0; m < numMeasures; ++m)
+	{
+		bool isLast = (m + 1 == numMeasures);
+		for(int l = 0; l < LinesPerMeasure; ++l)
+		{
+			char line[NumCols + 1] = {};
+			memset(line, '0', NumCols);
+
+			// Holds and rolls end after a few lines, and at the end of the chart at the latest.
+			for(int col = 0; col < NumCols; ++col)
+			{
+				if(holdLines[col] > 0 && (--holdLines[col] == 0 || (isLast && l + 1 == LinesPerMeasure)))
+				{
+					line[col] = '3';
+					holdLines[col] = 0;
+				}
+			}
+			if(rng.next(4) != 0 && !(isLast && l + 1 == LinesPerMeasure))
+			{
+				int numArrows = (rng.next(8) == 0) ? 2 : 1;
+				for(int i = 0; i < numArrows; ++i)
+				{
+					int col = rng.next(NumCols);
+					if(holdLines[col] > 0 || line[col] != '0') continue;
+					int kind = rng.next(32);
+					if(kind < 2)
+					{
+						line[col] = (kind == 0) ? '2' : '4';
+						holdLines[col] = 2 + rng.next(8);
+					}
+					else
+					{
+						line[col] = (kind < 4) ? 'M' : '1';
+					}
+				}
+			}
+			file.printf("%s\n", line);
+		}
+		file.printf(isLast ? ";\n" : ",\n");
+	}
+}
+
+static bool Generate(const BenchCase& c, StringRef dir)
+{
+	static const char* diffs[] = {"Beginner", "Easy", "Medium", "Hard", "Challenge", "Edit"};
+
+	Path path(dir, c.name, "ssc");
+	FileWriter file;
+	if(!file.open(path))
+	{
+		HudError("Could not write \"%s\".", path.str.str());
+		return false;
+	}
+	file.printf("#VERSION:0.83;\n");
+	file.printf("#TITLE:%s;\n", c.name);
+	file.printf("#ARTIST:SimfileBench;\n");
+	WriteTempo(file, c, 1000);
+	for(int i = 0; i < c.numCharts; ++i)
+	{
+		file.printf("\n#NOTEDATA:;\n");
+		file.printf("#STEPSTYPE:dance-single;\n");
+		file.printf("#DESCRIPTION:chart %i;\n", i + 1);
+		file.printf("#DIFFICULTY:%s;\n", diffs[min(i, 5)]);
+		file.printf("#METER:%i;\n", 1 + i % 20);
+		if(c.splitTiming) WriteTempo(file, c, 2000 + i);
+		WriteNotes(file, c, 3000 + i);
+	}
+	return true;
+}
+
+// ================================================================================================
+// Benchmark.
+
+static bool EqualNotes(const NoteList& a, const NoteList& b)
+{
+	if(a.size() != b.size()) return false;
+	for(int i = 0; i < a.size(); ++i)
+	{
+		auto& n = a.begin()[i], &m = b.begin()[i];
+		if(n.row != m.row || n.endrow != m.endrow || n.col != m.col || n.type != m.type ||
+			n.player != m.player) return false;
+	}
+	return true;
+}
+
+// Loads a simfile again and checks if it has the same charts, notes and segments.
+static bool VerifyLoaded(const Simfile& sim, StringRef path, bool deferNotes)
+{
+	Simfile saved;
+	if(!LoadSimfile(saved, path, deferNotes) || saved.charts.size() != sim.charts.size()) return false;
+	saved.sanitize();
+	saved.loadNotes();
+
+	if(saved.tempo->segments->numSegments() != sim.tempo->segments->numSegments()) return false;
+	for(int i = 0; i < sim.charts.size(); ++i)
+	{
+		auto a = sim.charts[i], b = saved.charts[i];
+		if(a->hasTempo() != b->hasTempo() || !EqualNotes(a->notes, b->notes)) return false;
+		if(a->hasTempo() && a->tempo->segments->numSegments() != b->tempo->segments->numSegments())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Checks if the memory-mapped tokenizer returns the same tags as the string based one.
+static bool VerifyTokens(StringRef path)
+{
+	String str, buffer;
+	Vector<SimfileTag> tags;
+	if(!ParseSimfile(str, path) || !TokenizeSimfile(path, buffer, tags)) return false;
+
+	int index = 0;
+	char* p = str.begin(), *tag, *val;
+	while(ParseNextTag(p, tag, val))
+	{
+		if(index == tags.size()) return false;
+		auto& t = tags[index++];
+		if(strcmp(tag, t.tag) || strcmp(val, t.val)) return false;
+	}
+	return index == tags.size();
+}
+
+// Checks if two files have the same contents.
+static bool EqualFiles(StringRef pathA, StringRef pathB)
+{
+	FileReader a, b;
+	if(!a.open(pathA) || !b.open(pathB) || a.size() != b.size()) return false;
+	Vector<char> bufA((int)a.size(), 0), bufB((int)b.size(), 0);
+	a.read(bufA.data(), 1, bufA.size());
+	b.read(bufB.data(), 1, bufB.size());
+	return memcmp(bufA.data(), bufB.data(), bufA.size()) == 0;
+}
+
+// Number of times the per-frame passes walk the notes of a chart.
+static const int NumNotePasses = 10;
+
+// Keeps the results of the note passes, so they are not optimized away.
+static volatile double sNoteChecksum = 0.0;
+
+// Walks the expanded notes like the per-frame passes of the editor: the density of the minimap,
+// the receptor glow and the note drawing of the notefield, and the statistics of the chart. The
+// passes visit every note instead of only the visible ones, to measure the throughput.
+template <typename It>
+static double RunNotePasses(It begin, It end)
+{
+	double sum = 0.0;
+	for(int pass = 0; pass < NumNotePasses; ++pass)
+	{
+		// Minimap density, which reads the times of the notes that are not mines or warped.
+		for(auto n = begin; n != end; ++n)
+		{
+			if(!(n->isMine | n->isWarped)) sum += n->time;
+		}
+
+		// Receptor glow, which reads the end times of the notes that can be hit.
+		for(auto n = begin; n != end; ++n)
+		{
+			if(!(n->isMine | n->isWarped | (n->type == NOTE_FAKE))) sum += n->endtime;
+		}
+
+		// Note drawing, which reads the positions, the type and the selection of the notes.
+		for(auto n = begin; n != end; ++n)
+		{
+			double y = n->time, by = (n->row == n->endrow) ? y : n->endtime;
+			sum += y + by + n->col + n->type + n->player + n->isSelected;
+		}
+
+		// Hold spans and jumps of the chart statistics.
+		int lastRow = -1;
+		for(auto n = begin; n != end; ++n)
+		{
+			if(n->endrow > n->row) sum += n->endrow - n->row + n->col;
+			sum += (lastRow == n->row);
+			lastRow = n->row;
+		}
+	}
+	return sum;
+}
+
+static void RunCase(const BenchCase& c, const Options& opt, BenchResult& out)
+{
+	for(int s = 0; s < NUM_STEPS; ++s) out.ms[s] = 1e9;
+	out.numCharts = out.numNotes = out.numSegments = 0;
+	out.failed = out.mismatch = false;
+
+	Path path(opt.dir, c.name, "ssc");
+	String savedName = Str::fmt("%1-saved").arg(c.name).str;
+	String cachedName = Str::fmt("%1-cached").arg(c.name).str;
+	String modifiedName = Str::fmt("%1-modified").arg(c.name).str;
+	String projectName = Str::fmt("%1-project").arg(c.name).str;
+	String exportedName = Str::fmt("%1-exported").arg(c.name).str;
+	Path projectPath(opt.dir, projectName, "avproj");
+	for(int r = 0; r < opt.repeats; ++r)
+	{
+		double times[NUM_STEPS];
+
+		// Split the simfile into tags with the string based tokenizer.
+		auto start = Debug::getElapsedTime();
+		{
+			String str;
+			char* p, *tag, *val;
+			if(ParseSimfile(str, path.str))
+			{
+				for(p = str.begin(); ParseNextTag(p, tag, val);) {}
+			}
+		}
+		times[STEP_PARSE] = Debug::getElapsedTime(start);
+
+		// Split the simfile into tags with the memory-mapped tokenizer.
+		start = Debug::getElapsedTime();
+		{
+			String buffer;
+			Vector<SimfileTag> tags;
+			TokenizeSimfile(path.str, buffer, tags);
+		}
+		times[STEP_TOKENIZE] = Debug::getElapsedTime(start);
+
+		// Load the simfile.
+		Simfile sim;
+		start = Debug::getElapsedTime();
+		if(!LoadSimfile(sim, path.str))
+		{
+			HudError("Could not load \"%s\".", path.str.str());
+			out.failed = true;
+			return;
+		}
+		times[STEP_LOAD] = Debug::getElapsedTime(start);
+
+		// Load the simfile with deferred notes and open the last chart, like the editor does.
+		start = Debug::getElapsedTime();
+		{
+			Simfile deferred;
+			LoadSimfile(deferred, path.str, true);
+			if(deferred.charts.size()) deferred.charts.back()->loadNotes();
+		}
+		times[STEP_LOAD_DEFERRED] = Debug::getElapsedTime(start);
+
+		// Sanitize the charts and the tempo, like the editor does after loading.
+		start = Debug::getElapsedTime();
+		sim.sanitize();
+		times[STEP_SANITIZE] = Debug::getElapsedTime(start);
+
+		// Build the timing data of the simfile and of each chart with split timing.
+		Vector<TimingData> timings;
+		timings.resize(sim.charts.size());
+		TimingData simTiming;
+		start = Debug::getElapsedTime();
+		simTiming.update(sim.tempo);
+		for(int i = 0; i < sim.charts.size(); ++i)
+		{
+			auto chart = sim.charts[i];
+			if(chart->hasTempo()) timings[i].update(chart->tempo);
+		}
+		times[STEP_TIMING] = Debug::getElapsedTime(start);
+
+		// Expand the notes of each chart and compute their times, like the editor does on opening.
+		// Then walk the expanded notes like the editor does every frame.
+		ExpandedNoteList notes;
+		times[STEP_NOTES] = times[STEP_NOTE_PASSES] = 0.0;
+		for(int i = 0; i < sim.charts.size(); ++i)
+		{
+			auto chart = sim.charts[i];
+			auto& timing = chart->hasTempo() ? timings[i] : simTiming;
+			start = Debug::getElapsedTime();
+			ExpandNotes(chart->notes, notes);
+			UpdateNoteTimes(notes, 0, notes.size(), timing, 0);
+			UpdateWarpedNotes(notes, 0, notes.size(), timing);
+			times[STEP_NOTES] += Debug::getElapsedTime(start);
+
+			start = Debug::getElapsedTime();
+			sNoteChecksum += RunNotePasses(notes.begin(), notes.end());
+			times[STEP_NOTE_PASSES] += Debug::getElapsedTime(start);
+		}
+
+		// Save the simfile next to the generated one.
+		sim.file = savedName;
+		start = Debug::getElapsedTime();
+		if(!SaveSimfile(sim, SIM_SSC, false))
+		{
+			out.failed = true;
+			return;
+		}
+		times[STEP_SAVE] = Debug::getElapsedTime(start);
+
+		// Fill a chart cache with a first save, then modify the first chart and save again, which
+		// only serializes the modified chart.
+		ChartCache cache;
+		for(auto chart : sim.charts) chart->markModified();
+		sim.file = cachedName;
+		SaveSimfile(sim, SIM_SSC, false, &cache);
+		if(sim.charts.size())
+		{
+			sim.charts[0]->meter += 1;
+			sim.charts[0]->markModified();
+		}
+		start = Debug::getElapsedTime();
+		if(!SaveSimfile(sim, SIM_SSC, false, &cache))
+		{
+			out.failed = true;
+			return;
+		}
+		times[STEP_SAVE_INCREMENTAL] = Debug::getElapsedTime(start);
+
+		// Save the simfile as a project.
+		sim.file = projectName;
+		start = Debug::getElapsedTime();
+		if(!SaveSimfile(sim, SIM_AVPROJ, false))
+		{
+			out.failed = true;
+			return;
+		}
+		times[STEP_SAVE_PROJECT] = Debug::getElapsedTime(start);
+
+		// Load the project with deferred notes and open the last chart, like the editor does.
+		start = Debug::getElapsedTime();
+		{
+			Simfile project;
+			LoadSimfile(project, projectPath.str, true);
+			if(project.charts.size()) project.charts.back()->loadNotes();
+		}
+		times[STEP_LOAD_PROJECT] = Debug::getElapsedTime(start);
+
+		for(int s = 0; s < NUM_STEPS; ++s)
+		{
+			out.ms[s] = min(out.ms[s], times[s] * 1000.0);
+		}
+		if(r == 0)
+		{
+			out.numCharts = sim.charts.size();
+			out.numSegments = sim.tempo->segments->numSegments();
+			for(auto chart : sim.charts)
+			{
+				out.numNotes += chart->notes.size();
+				if(chart->hasTempo()) out.numSegments += chart->tempo->segments->numSegments();
+			}
+			out.mismatch = !VerifyLoaded(sim, Path(opt.dir, savedName, "ssc").str, false) ||
+				!VerifyLoaded(sim, path.str, true) || !VerifyTokens(path.str);
+
+			// The incremental save must be identical to a full save of the modified simfile.
+			sim.file = modifiedName;
+			out.mismatch |= !SaveSimfile(sim, SIM_SSC, false) ||
+				!EqualFiles(Path(opt.dir, cachedName, "ssc").str, Path(opt.dir, modifiedName, "ssc").str);
+
+			// The project must contain the same simfile, and exporting it must give the same file.
+			Simfile project;
+			out.mismatch |= !VerifyLoaded(sim, projectPath.str, true) ||
+				!LoadSimfile(project, projectPath.str, false);
+			project.sanitize();
+			project.file = exportedName;
+			out.mismatch |= !SaveSimfile(project, SIM_SSC, false) ||
+				!EqualFiles(Path(opt.dir, exportedName, "ssc").str, Path(opt.dir, modifiedName, "ssc").str);
+		}
+	}
+}
+
+static const char* GetStatus(const BenchResult& r)
+{
+	return r.failed ? "failed" : (r.mismatch ? "mismatch" : "ok");
+}
+
+static void PrintReport(const BenchResult* results, int numCases, bool json)
+{
+	ToolReport report("simfile,charts,notes,segments,step,ms,status");
+	for(int i = 0; i < numCases; ++i)
+	{
+		for(int s = 0; s < NUM_STEPS; ++s)
+		{
+			auto& r = results[i];
+			report.addRow();
+			report.add(String(sCases[i].name));
+			report.add(r.numCharts);
+			report.add(r.numNotes);
+			report.add(r.numSegments);
+			report.add(String(sStepNames[s]));
+			report.add(r.ms[s], 3);
+			report.add(String(GetStatus(r)));
+		}
+	}
+	String out = report.format(json);
+	fwrite(out.str(), 1, out.len(), stdout);
+}
+
+// ================================================================================================
+// Main function.
+
+static bool ParseOptions(Options& opt, int argc, char** argv)
+{
+	opt.dir = "SimfileBench";
+	opt.repeats = 5;
+	opt.json = false;
+	opt.generateOnly = false;
+
+	const ToolOption options[] =
+	{
+		{"-o", ToolOption::STRING, &opt.dir, 0, 0},
+		{"-r", ToolOption::INT, &opt.repeats, 1, INT_MAX},
+		{"-f", ToolOption::FORMAT, &opt.json, 0, 0},
+		{"-g", ToolOption::FLAG, &opt.generateOnly, 0, 0},
+	};
+	if(!ParseToolOptions(argc, argv, options, 4)) return false;
+
+	if(!Str::endsWith(opt.dir, "/") && !Str::endsWith(opt.dir, "\\"))
+	{
+		Str::append(opt.dir, '/');
+	}
+	return true;
+}
+
+static int Run(int argc, char** argv)
+{
+	Options opt;
+	if(!ParseOptions(opt, argc, argv))
+	{
+		fprintf(stderr, "usage: SimfileBench [-o directory] [-r repeats] [-f csv|json] [-g]\n");
+		return 2;
+	}
+
+	const int numCases = sizeof(sCases) / sizeof(sCases[0]);
+	File::createFolder(opt.dir);
+	for(int i = 0; i < numCases; ++i)
+	{
+		if(!Generate(sCases[i], opt.dir)) return 1;
+	}
+	if(opt.generateOnly) return 0;
+
+	StyleMan::create();
+	BenchResult results[numCases];
+	int numFailures = 0;
+	for(int i = 0; i < numCases; ++i)
+	{
+		RunCase(sCases[i], opt, results[i]);
+		numFailures += results[i].failed || results[i].mismatch;
+	}
+	StyleMan::destroy();
+
+	PrintReport(results, numCases, opt.json);
+
+	fprintf(stderr, "%i simfiles, %i repeats, %i failures\n", numCases, opt.repeats, numFailures);
+
+	return (numFailures == 0) ? 0 : 1;
+}
+
+}; // anonymous namespace
+}; // namespace Vortex
+
+int main(int argc, char** argv)
+{
+	return Vortex::Run(argc, argv);
+}
@@ -0,0 +1,337 @@
+// Accuracy and speed benchmark for the tempo detection.
+//
+// Usage: TempoBench [-j threads] [-r repeats] [-f csv|json]
+//
+// Synthesizes click tracks and drum loops with a known BPM and offset, runs the onset detection and
+// tempo detection on them and reports the detected values and wall time of each case. The exit code
+// is non-zero if a case that used to be detected correctly fails, so changes to the DSP code can be
+// checked with it. Cases the detector is known to get wrong (e.g. picking double the BPM near the
+// lower boundary) are still reported, and listed as fixed when they start passing.
+//
+// Next to the Visual Studio project, it can be built headless on Linux with:
+//   g++ -std=c++14 -O2 -Isrc -Ilib src/Tools/TempoBench.cpp src/Tools/Common.cpp
+//       src/Editor/FindOnsets.cpp src/Editor/FindTempo.cpp src/Editor/Aubio.cpp src/Editor/FFT.cpp
+//       src/Core/String.cpp src/Core/StringUtils.cpp src/Core/WideString.cpp src/Core/Utils.cpp
+//       src/System/Thread.cpp -pthread -o TempoBench
+
+#include <Core/Utils.h>
+#include <Core/Vector.h>
+
+#include <System/Thread.h>
+
+#include <Editor/FindOnsets.h>
+#include <Editor/FindTempo.h>
+
+#include <Tools/Common.h>
+
+#include <stdio.h>
+#include <limits.h>
+#include <math.h>
+#include <chrono>
+
+namespace Vortex {
+
+namespace {
+
+static const int Samplerate = 44100;
+static const double PI = 3.14159265358979323846;
+
+// Detected values within these thresholds count as correct.
+static const double BpmTolerance = 0.05;
+static const double OffsetTolerance = 0.010;
+
+enum Pattern
+{
+	PATTERN_CLICKS,   // Metronome clicks on every beat, accented on the downbeat.
+	PATTERN_DRUMS,    // Kick on 1 and 3, snare on 2 and 4, hi-hats on every eighth.
+	PATTERN_OFFBEAT,  // Kick on every beat, open hi-hats on the offbeats.
+};
+
+struct BenchCase
+{
+	const char* name;
+	Pattern pattern;
+	double bpm;
+	double offset;    // Time of the first beat in seconds.
+	double swing;     // Position of the offbeat eighths within the beat, 0.5 is straight.
+	double gapStart;  // Start of a silent section in seconds.
+	double gapLength; // Length of the silent section in seconds.
+	double noise;     // Amplitude of the background noise.
+	double length;    // Length of the signal in seconds.
+	bool knownFailure; // The current detector does not get this case right.
+};
+
+static const BenchCase sCases[] =
+{
+	{"clicks-120",         PATTERN_CLICKS,  120.0, 0.000, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"clicks-137.5",       PATTERN_CLICKS,  137.5, 0.213, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"clicks-min-89.5",    PATTERN_CLICKS,   89.5, 0.250, 0.50,  0.0, 0.0, 0.00, 30.0, true},
+	{"clicks-max-204.5",   PATTERN_CLICKS,  204.5, 0.100, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"clicks-lead-in",     PATTERN_CLICKS,  110.0, 3.120, 0.50,  0.0, 3.0, 0.00, 30.0, false},
+	{"drums-128",          PATTERN_DRUMS,   128.0, 0.350, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"drums-174",          PATTERN_DRUMS,   174.0, 0.045, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"drums-min-90",       PATTERN_DRUMS,    90.0, 0.500, 0.50,  0.0, 0.0, 0.00, 30.0, true},
+	{"drums-max-204",      PATTERN_DRUMS,   204.0, 0.180, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"drums-swing-96",     PATTERN_DRUMS,    96.0, 0.120, 0.67,  0.0, 0.0, 0.00, 30.0, true},
+	{"drums-swing-160",    PATTERN_DRUMS,   160.0, 0.270, 0.60,  0.0, 0.0, 0.00, 30.0, false},
+	{"drums-gap-140",      PATTERN_DRUMS,   140.0, 0.310, 0.50, 12.0, 4.0, 0.00, 30.0, false},
+	{"drums-noise-100",    PATTERN_DRUMS,   100.0, 0.075, 0.50,  0.0, 0.0, 0.05, 30.0, false},
+	{"offbeat-150",        PATTERN_OFFBEAT, 150.0, 0.200, 0.50,  0.0, 0.0, 0.00, 30.0, false},
+	{"offbeat-swing-115",  PATTERN_OFFBEAT, 115.0, 0.410, 0.62,  0.0, 0.0, 0.00, 30.0, false},
+};
+
+struct Options
+{
+	int numThreads;
+	int repeats;
+	bool json;
+};
+
+struct CaseResult
+{
+	TempoResult detected;
+	bool hasResult;
+	double onsetTime;
+	double tempoTime;
+};
+
+// ================================================================================================
+// Signal synthesis.
+
+struct Noise
+{
+	unsigned int state = 0x12345678;
+	double next()
+	{
+		state = state * 1664525u + 1013904223u;
+		return (double)(state >> 8) / (double)(1 << 23) - 1.0;
+	}
+};
+
+static void AddTone(Vector<double>& signal, double time, double freq, double amp, double decay)
+{
+	int begin = (int)(time * Samplerate);
+	int end = min(signal.size(), begin + (int)(decay * 5.0 * Samplerate));
+	for(int i = max(begin, 0); i < end; ++i)
+	{
+		double t = (double)(i - begin) / Samplerate;
+		signal[i] += amp * exp(-t / decay) * sin(2.0 * PI * freq * t);
+	}
+}
+
+static void AddKick(Vector<double>& signal, double time)
+{
+	int begin = (int)(time * Samplerate);
+	int end = min(signal.size(), begin + (int)(0.4 * Samplerate));
+	double phase = 0.0;
+	for(int i = max(begin, 0); i < end; ++i)
+	{
+		double t = (double)(i - begin) / Samplerate;
+		phase += 2.0 * PI * (50.0 + 100.0 * exp(-t / 0.03)) / Samplerate;
+		signal[i] += 0.9 * exp(-t / 0.08) * sin(phase);
+	}
+}
+
+static void AddNoiseHit(Vector<double>& signal, Noise& noise, double time, double amp,
+	double decay, bool highpass)
+{
+	int begin = (int)(time * Samplerate);
+	int end = min(signal.size(), begin + (int)(decay * 5.0 * Samplerate));
+	double prev = 0.0;
+	for(int i = max(begin, 0); i < end; ++i)
+	{
+		double t = (double)(i - begin) / Samplerate;
+		double v = noise.next();
+		double s = highpass ? (v - prev) * 0.5 : v;
+		prev = v;
+		signal[i] += amp * exp(-t / decay) * s;
+	}
+}
+
+static void Synthesize(const BenchCase& c, Vector<short>& out)
+{
+	Vector<double> signal;
+	signal.resize((int)(c.length * Samplerate), 0.0);
+	Noise noise;
+
+	double spb = 60.0 / c.bpm;
+	int firstBeat = (int)ceil(-c.offset / spb);
+	for(int beat = firstBeat; c.offset + beat * spb < c.length; ++beat)
+	{
+		double time = c.offset + beat * spb;
+		double offbeat = time + spb * c.swing;
+		switch(c.pattern)
+		{
+		case PATTERN_CLICKS:
+			AddTone(signal, time, (beat % 4 == 0) ? 2000.0 : 1000.0, 0.8, 0.01);
+			break;
+		case PATTERN_DRUMS:
+			if(beat % 2 == 0) AddKick(signal, time);
+			if(beat % 2 != 0)
+			{
+				AddNoiseHit(signal, noise, time, 0.6, 0.05, false);
+				AddTone(signal, time, 200.0, 0.4, 0.04);
+			}
+			AddNoiseHit(signal, noise, time, 0.25, 0.015, true);
+			AddNoiseHit(signal, noise, offbeat, 0.2, 0.015, true);
+			break;
+		case PATTERN_OFFBEAT:
+			AddKick(signal, time);
+			AddNoiseHit(signal, noise, offbeat, 0.3, 0.06, true);
+			break;
+		};
+	}
+
+	if(c.noise > 0.0)
+	{
+		for(auto& v : signal) v += c.noise * noise.next();
+	}
+
+	int gapBegin = (int)(c.gapStart * Samplerate);
+	int gapEnd = min(signal.size(), (int)((c.gapStart + c.gapLength) * Samplerate));
+	for(int i = gapBegin; i < gapEnd; ++i) signal[i] = 0.0;
+
+	out.resize(signal.size());
+	for(int i = 0; i < signal.size(); ++i)
+	{
+		out[i] = (short)clamp((int)(signal[i] * 16384.0), -32768, 32767);
+	}
+}
+
+// ================================================================================================
+// Benchmark.
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunCase(const BenchCase& c, const Options& opt, CaseResult& out)
+{
+	Vector<short> samples;
+	Synthesize(c, samples);
+
+	out.hasResult = false;
+	out.onsetTime = out.tempoTime = 1e9;
+	for(int r = 0; r < opt.repeats; ++r)
+	{
+		auto start = std::chrono::steady_clock::now();
+		uchar terminate = 0;
+		OnsetCache onsets;
+		FindOnsets(samples.data(), samples.data(), Samplerate, samples.size(), &terminate, onsets);
+		out.onsetTime = min(out.onsetTime, Seconds(start));
+
+		start = std::chrono::steady_clock::now();
+		Vector<TempoResult> results;
+		FindTempo(samples.data(), samples.data(), Samplerate, onsets, 0, samples.size(),
+			opt.numThreads, results);
+		out.tempoTime = min(out.tempoTime, Seconds(start));
+
+		if(results.size())
+		{
+			out.detected = results[0];
+			out.hasResult = true;
+		}
+	}
+}
+
+// Returns the offset difference, ignoring differences of whole beats.
+static double OffsetDifference(const BenchCase& c, const CaseResult& r)
+{
+	double spb = 60.0 / c.bpm;
+	double diff = r.detected.offset - c.offset;
+	return diff - floor(diff / spb + 0.5) * spb;
+}
+
+static bool IsCorrect(const BenchCase& c, const CaseResult& r)
+{
+	return r.hasResult
+		&& fabs(r.detected.bpm - c.bpm) <= BpmTolerance
+		&& fabs(OffsetDifference(c, r)) <= OffsetTolerance;
+}
+
+static const char* GetStatus(const BenchCase& c, const CaseResult& r)
+{
+	if(IsCorrect(c, r)) return c.knownFailure ? "fixed" : "correct";
+	return c.knownFailure ? "known failure" : "regression";
+}
+
+static void PrintReport(const CaseResult* results, int numCases, bool json)
+{
+	ToolReport report("case,bpm,offset,detected_bpm,detected_offset,fitness,bpm_diff,offset_diff,"
+		"onset_seconds,tempo_seconds,status");
+	for(int i = 0; i < numCases; ++i)
+	{
+		auto& c = sCases[i];
+		auto& r = results[i];
+		report.addRow();
+		report.add(String(c.name));
+		report.add(c.bpm, 3);
+		report.add(c.offset, 3);
+		report.add(r.detected.bpm, 3);
+		report.add(r.detected.offset, 3);
+		report.add(r.detected.fitness, 3);
+		report.add(r.detected.bpm - c.bpm, 3);
+		report.add(OffsetDifference(c, r), 4);
+		report.add(r.onsetTime, 4);
+		report.add(r.tempoTime, 4);
+		report.add(String(GetStatus(c, r)));
+	}
+	String out = report.format(json);
+	fwrite(out.str(), 1, out.len(), stdout);
+}
+
+static bool ParseOptions(Options& opt, int argc, char** argv)
+{
+	opt.numThreads = ParallelThreads::concurrency();
+	opt.repeats = 1;
+	opt.json = false;
+
+	const ToolOption options[] =
+	{
+		{"-j", ToolOption::INT, &opt.numThreads, 1, MaxToolThreads},
+		{"-r", ToolOption::INT, &opt.repeats, 1, INT_MAX},
+		{"-f", ToolOption::FORMAT, &opt.json, 0, 0},
+	};
+	return ParseToolOptions(argc, argv, options, 3);
+}
+
+static int Run(int argc, char** argv)
+{
+	Options opt;
+	if(!ParseOptions(opt, argc, argv))
+	{
+		fprintf(stderr, "usage: TempoBench [-j threads] [-r repeats] [-f csv|json]\n");
+		return 2;
+	}
+
+	const int numCases = sizeof(sCases) / sizeof(sCases[0]);
+	CaseResult results[numCases];
+
+	int numCorrect = 0, numRegressions = 0;
+	double onsetTime = 0.0, tempoTime = 0.0;
+	for(int i = 0; i < numCases; ++i)
+	{
+		RunCase(sCases[i], opt, results[i]);
+		bool correct = IsCorrect(sCases[i], results[i]);
+		numCorrect += correct;
+		numRegressions += (!correct && !sCases[i].knownFailure);
+		onsetTime += results[i].onsetTime;
+		tempoTime += results[i].tempoTime;
+	}
+
+	PrintReport(results, numCases, opt.json);
+
+	fprintf(stderr, "%i/%i cases correct, %i regressions, onsets %.3f s, tempo %.3f s\n",
+		numCorrect, numCases, numRegressions, onsetTime, tempoTime);
+
+	return (numRegressions == 0) ? 0 : 1;
+}
+
+}; // anonymous namespace
+}; // namespace Vortex
+
+int main(int argc, char** argv)
+{
+	return Vortex::Run(argc, argv);
+}
@@ -0,0 +1,305 @@
+// Speed benchmark for the row/time conversions of the timing data.
+//
+// Usage: TimingBench [-n values] [-r repeats] [-f csv|json]
+//
+// Builds the timing data of a few synthetic tempos, from a single BPM to gimmick charts with
+// thousands of BPM changes, stops, delays and warps, and converts a list of rows (or times) with
+// each of the available methods: a search per value, the tempo tracker, and the batched
+// conversions on sorted and unsorted input. Reports the time per value of each method. The exit
+// code is non-zero if a batched conversion gives a different result than the search per value.
+
+#include <Core/Utils.h>
+#include <Core/Vector.h>
+
+#include <Simfile/Tempo.h>
+#include <Simfile/SegmentGroup.h>
+#include <Simfile/TimingData.h>
+
+#include <Tools/Common.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#include <chrono>
+
+namespace Vortex {
+
+namespace {
+
+static const int ChartRows = ROWS_PER_BEAT * 4 * 400;
+
+struct BenchTempo
+{
+	const char* name;
+	int numBpmChanges;
+	int numStops;
+	int numWarps;
+};
+
+static const BenchTempo sTempos[] =
+{
+	{"single-bpm",      1,    0,   0},
+	{"bpm-changes",   100,    0,   0},
+	{"stops",         100,  400,   0},
+	{"gimmick",      2000, 2000, 500},
+};
+
+enum Method
+{
+	METHOD_SEARCH,
+	METHOD_SEARCH_UNSORTED,
+	METHOD_TRACKER,
+	METHOD_BATCH_UNSORTED,
+	METHOD_BATCH_SORTED,
+	METHOD_TIME_SEARCH,
+	METHOD_TIME_BATCH_SORTED,
+
+	NUM_METHODS
+};
+
+static const char* sMethodNames[NUM_METHODS] =
+{
+	"rowToTime sorted",
+	"rowToTime unsorted",
+	"TempoTimeTracker",
+	"rowsToTimes unsorted",
+	"rowsToTimes sorted",
+	"timeToRow sorted",
+	"timesToRows sorted",
+};
+
+struct Options
+{
+	int numValues;
+	int repeats;
+	bool json;
+};
+
+struct BenchResult
+{
+	int numEvents;
+	double nsPerValue[NUM_METHODS];
+	bool mismatch[NUM_METHODS];
+};
+
+// ================================================================================================
+// Tempo synthesis.
+
+// Small deterministic random number generator, so every run benchmarks the same tempos.
+struct Random
+{
+	uint state;
+	int next(int range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return (int)((state >> 8) % (uint)range);
+	}
+};
+
+static void Synthesize(const BenchTempo& t, Tempo& out)
+{
+	Random rng = {12345};
+	out.offset = -0.1;
+	out.segments->insert(BpmChange(0, 150.0));
+	for(int i = 1; i < t.numBpmChanges; ++i)
+	{
+		out.segments->insert(BpmChange(rng.next(ChartRows), 60.0 + rng.next(24000) * 0.01));
+	}
+	for(int i = 0; i < t.numStops; ++i)
+	{
+		double seconds = rng.next(1000) * 0.001;
+		int row = rng.next(ChartRows);
+		if(i & 1)
+		{
+			out.segments->insert(Stop(row, seconds));
+		}
+		else
+		{
+			out.segments->insert(Delay(row, seconds));
+		}
+	}
+	for(int i = 0; i < t.numWarps; ++i)
+	{
+		out.segments->insert(Warp(rng.next(ChartRows), 1 + rng.next(ROWS_PER_BEAT * 2)));
+	}
+	out.sanitize();
+}
+
+// ================================================================================================
+// Benchmark.
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunMethod(Method method, const TimingData& timing, const Vector<int>& sortedRows,
+	const Vector<int>& unsortedRows, const Vector<double>& sortedTimes, Vector<double>& outTimes,
+	Vector<int>& outRows)
+{
+	int n = sortedRows.size();
+	switch(method)
+	{
+	case METHOD_SEARCH:
+		for(int i = 0; i < n; ++i) outTimes[i] = timing.rowToTime(sortedRows[i]);
+		break;
+	case METHOD_SEARCH_UNSORTED:
+		for(int i = 0; i < n; ++i) outTimes[i] = timing.rowToTime(unsortedRows[i]);
+		break;
+	case METHOD_TRACKER: {
+		TempoTimeTracker tracker(timing);
+		for(int i = 0; i < n; ++i) outTimes[i] = tracker.advance(sortedRows[i]);
+		break; }
+	case METHOD_BATCH_UNSORTED:
+		timing.rowsToTimes(unsortedRows.data(), outTimes.data(), n, false);
+		break;
+	case METHOD_BATCH_SORTED:
+		timing.rowsToTimes(sortedRows.data(), outTimes.data(), n, true);
+		break;
+	case METHOD_TIME_SEARCH:
+		for(int i = 0; i < n; ++i) outRows[i] = timing.timeToRow(sortedTimes[i]);
+		break;
+	case METHOD_TIME_BATCH_SORTED:
+		timing.timesToRows(sortedTimes.data(), outRows.data(), n, true);
+		break;
+	};
+}
+
+static void RunTempo(const BenchTempo& t, const Options& opt, BenchResult& out)
+{
+	Tempo tempo;
+	Synthesize(t, tempo);
+	TimingData timing;
+	timing.update(&tempo);
+	out.numEvents = timing.events.size();
+
+	// Rows are spread over the chart, with runs of notes on the same row like in real charts.
+	Random rng = {54321};
+	Vector<int> sortedRows, unsortedRows;
+	sortedRows.resize(opt.numValues);
+	for(int i = 0; i < opt.numValues; ++i)
+	{
+		sortedRows[i] = rng.next(ChartRows);
+	}
+	std::sort(sortedRows.begin(), sortedRows.end());
+	unsortedRows = sortedRows;
+	for(int i = unsortedRows.size() - 1; i > 0; --i)
+	{
+		swapValues(unsortedRows[i], unsortedRows[rng.next(i + 1)]);
+	}
+
+	// The reference results are computed with a search per value.
+	Vector<double> refTimes, sortedTimes, unsortedRefTimes;
+	Vector<int> refRows;
+	refTimes.resize(opt.numValues);
+	unsortedRefTimes.resize(opt.numValues);
+	refRows.resize(opt.numValues);
+	for(int i = 0; i < opt.numValues; ++i)
+	{
+		refTimes[i] = timing.rowToTime(sortedRows[i]);
+		unsortedRefTimes[i] = timing.rowToTime(unsortedRows[i]);
+	}
+	sortedTimes = refTimes;
+	std::sort(sortedTimes.begin(), sortedTimes.end());
+	for(int i = 0; i < opt.numValues; ++i)
+	{
+		refRows[i] = timing.timeToRow(sortedTimes[i]);
+	}
+
+	Vector<double> times;
+	Vector<int> rows;
+	times.resize(opt.numValues);
+	rows.resize(opt.numValues);
+	for(int m = 0; m < NUM_METHODS; ++m)
+	{
+		double best = 1e9;
+		for(int r = 0; r < opt.repeats; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			RunMethod((Method)m, timing, sortedRows, unsortedRows, sortedTimes, times, rows);
+			best = min(best, Seconds(start));
+		}
+		out.nsPerValue[m] = best * 1e9 / opt.numValues;
+
+		bool isTime = (m == METHOD_TIME_SEARCH || m == METHOD_TIME_BATCH_SORTED);
+		bool isUnsorted = (m == METHOD_SEARCH_UNSORTED || m == METHOD_BATCH_UNSORTED);
+		const Vector<double>& ref = isUnsorted ? unsortedRefTimes : refTimes;
+		out.mismatch[m] = isTime
+			? memcmp(rows.data(), refRows.data(), sizeof(int) * opt.numValues) != 0
+			: memcmp(times.data(), ref.data(), sizeof(double) * opt.numValues) != 0;
+	}
+}
+
+static void PrintReport(const BenchResult* results, int numTempos, bool json)
+{
+	ToolReport report("tempo,events,method,ns_per_value,status");
+	for(int i = 0; i < numTempos; ++i)
+	{
+		for(int m = 0; m < NUM_METHODS; ++m)
+		{
+			auto& r = results[i];
+			report.addRow();
+			report.add(String(sTempos[i].name));
+			report.add(r.numEvents);
+			report.add(String(sMethodNames[m]));
+			report.add(r.nsPerValue[m], 2);
+			report.add(String(r.mismatch[m] ? "mismatch" : "ok"));
+		}
+	}
+	String out = report.format(json);
+	fwrite(out.str(), 1, out.len(), stdout);
+}
+
+static bool ParseOptions(Options& opt, int argc, char** argv)
+{
+	opt.numValues = 1000000;
+	opt.repeats = 5;
+	opt.json = false;
+
+	const ToolOption options[] =
+	{
+		{"-n", ToolOption::INT, &opt.numValues, 1, INT_MAX},
+		{"-r", ToolOption::INT, &opt.repeats, 1, INT_MAX},
+		{"-f", ToolOption::FORMAT, &opt.json, 0, 0},
+	};
+	return ParseToolOptions(argc, argv, options, 3);
+}
+
+static int Run(int argc, char** argv)
+{
+	Options opt;
+	if(!ParseOptions(opt, argc, argv))
+	{
+		fprintf(stderr, "usage: TimingBench [-n values] [-r repeats] [-f csv|json]\n");
+		return 2;
+	}
+
+	const int numTempos = sizeof(sTempos) / sizeof(sTempos[0]);
+	BenchResult results[numTempos];
+
+	int numMismatches = 0;
+	for(int i = 0; i < numTempos; ++i)
+	{
+		RunTempo(sTempos[i], opt, results[i]);
+		for(int m = 0; m < NUM_METHODS; ++m)
+		{
+			numMismatches += results[i].mismatch[m];
+		}
+	}
+
+	PrintReport(results, numTempos, opt.json);
+
+	fprintf(stderr, "%i tempos, %i values, %i mismatches\n", numTempos, opt.numValues,
+		numMismatches);
+
+	return (numMismatches == 0) ? 0 : 1;
+}
+
+}; // anonymous namespace
+}; // namespace Vortex
+
+int main(int argc, char** argv)
+{
+	return Vortex::Run(argc, argv);
+}